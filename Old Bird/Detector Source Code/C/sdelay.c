@@ -209,16 +209,20 @@ static void mdlOutputs(SimStruct *S, int_T tid)
 
 	if (COL_MAJOR)
 	{
-		/* Former inputs are saved in state vector */
+		/* Channels are stored as columns, so loop over channels in the outer
+		   loop and samples in the inner loops, which then run through
+		   contiguous memory */
 		m = MIN(n, delay);
-		for (i=0; i < m; i++)
 		for (channel=0; channel < numChannels; channel++)
-			OUTPUT_C(channel,i) = FORMER_INPUT(channel,i);
+		{
+			/* Former inputs are saved in state vector */
+			for (i=0; i < m; i++)
+				OUTPUT_C(channel,i) = FORMER_INPUT(channel,i);
 
-		/* If state vector is used up, continue with current inputs */
-		for ( ; i < n; i++)
-		for (channel=0; channel < numChannels; channel++)
-			OUTPUT_C(channel,i) = INPUT_C(channel,i-delay);
+			/* If state vector is used up, continue with current inputs */
+			for ( ; i < n; i++)
+				OUTPUT_C(channel,i) = INPUT_C(channel,i-delay);
+		}
 	}
 
 	else /* ROW MAJOR */
@@ -263,19 +267,20 @@ static void mdlUpdate(SimStruct *S, int_T tid)
 
 	if (COL_MAJOR)
 	{
-		/* Save last inputs */
+		/* Save last inputs, looping over channels in the outer loop as
+		   in mdlOutputs */
 		if (delay <= n)
 		{
 			SET_FORMER_INDEX (0);
 
-			for (i=0; i < delay; i++)
 			for (channel=0; channel < numChannels; channel++)
+			for (i=0; i < delay; i++)
 				RAW_FORMER_INPUT(channel,i) = INPUT_C (channel, n-delay+i);
 		}
 		else
 		{
-			for (i=0; i < n; i++)
 			for (channel=0; channel < numChannels; channel++)
+			for (i=0; i < n; i++)
 				FORMER_INPUT(channel,i) = INPUT_C (channel, i);
 
 			SET_FORMER_INDEX ((formerIndex + n) % delay);
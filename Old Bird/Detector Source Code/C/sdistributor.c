@@ -55,17 +55,12 @@ enum{
 #define OUTPUT_PHASE(i)		((long)  floor(0.5+ mxGetPr(ssGetSFcnParam (S, kOUTPUT_PHASES))[i]))
 #define NUM_OUTPUT_PHASES	(mxGetN(ssGetSFcnParam(S, kOUTPUT_PHASES)))	
 
-/* Pointer work vector */
-enum{
-	kYS,				/* Output vector pointers		*/
-	kPHASES,			/* Output phases				*/
-	kNUMPWORKITEMS
-};
-
-#define GET_YS					(ssGetPWorkValue (S, kYS))
-#define SET_YS(x)				(ssSetPWorkValue (S, kYS, (x)))
-#define GET_PHASES				(ssGetPWorkValue (S, kPHASES))
-#define SET_PHASES(x)			(ssSetPWorkValue (S, kPHASES, (x)))
+/* Work vectors, sized in mdlInitializeSizes so that Simulink allocates
+   them with the block's other work vectors:
+		pointer work vector		Output vector pointers, one per output phase
+		integer work vector		Output phases, one per output phase		*/
+#define GET_YS					((real_T**) ssGetPWork (S))
+#define GET_PHASES				(ssGetIWork (S))
 
 /* Macros */
 #define MIN(x,y)				((x)<(y) ? (x) : (y))
@@ -74,6 +69,7 @@ enum{
 
 /* Prototypes */
 static void mdlCheckParameters (SimStruct *S);
+static int_T isFullPhaseSet (int_T *pPhases, int_T numPhases, int_T factor);
 
 
 /*====================*
@@ -116,9 +112,9 @@ static void mdlInitializeSizes(SimStruct *S)
     ssSetNumSampleTimes(   S, 1);   /* number of sample times                */
     ssSetNumRWork(         S, 0);   
 									/* number of real work vector elements   */
-    ssSetNumIWork(         S, 0);
+    ssSetNumIWork(         S, NUM_OUTPUT_PHASES);
 									/* number of integer work vector elements*/
-    ssSetNumPWork(         S, kNUMPWORKITEMS);   
+    ssSetNumPWork(         S, NUM_OUTPUT_PHASES);   
 									/* number of pointer work vector elements*/
     ssSetNumModes(         S, 0);   /* number of mode work vector elements   */
     ssSetNumNonsampledZCs( S, 0);   /* number of nonsampled zero crossings   */
@@ -160,30 +156,13 @@ static void mdlInitializeSampleTimes(SimStruct *S)
 #define MDL_INITIALIZE_CONDITIONS
 static void mdlInitializeConditions(SimStruct *S)
 {
-	real_T				**ppys;
 	int_T				i, *pPhases;
 
-	ppys = (real_T**) malloc (NUM_OUTPUT_PHASES * sizeof (real_T*));
-	if (ppys == NULL)
-	{
-		ssSetErrorStatus (S, ERROR_STRING ("Out of memory"));
-		return;
-	}
-
-	SET_YS (ppys);
-
-	pPhases = (int_T*) malloc (NUM_OUTPUT_PHASES * sizeof (int_T));
-	if (pPhases == NULL)
-	{
-		ssSetErrorStatus (S, ERROR_STRING ("Out of memory"));
-		return;
-	}
+	pPhases = GET_PHASES;
 
 	/* Renumber phases from 0 to factor-1 (instead of 1 to factor) */
 	for (i=0; i < NUM_OUTPUT_PHASES; i++)
 		pPhases[i] = OUTPUT_PHASE(i)-1;
-
-	SET_PHASES (pPhases);
 }
 
 
@@ -195,6 +174,12 @@ static void mdlInitializeConditions(SimStruct *S)
  * block. The outputs are placed in the y variable.
  */
 
+/* Deinterleaves input into a full set of output phases */
+#define DEINTERLEAVE(factor)					\
+	for (i=0; i < n; i++)						\
+		for (j=0; j < (factor); j++)			\
+			ppys [j] [i] = *uPtrs [(factor) * i + j]
+
 static void mdlOutputs(SimStruct *S, int_T tid)
 {
 	int_T				i, n, j, factor, numPhases;
@@ -214,9 +199,25 @@ static void mdlOutputs(SimStruct *S, int_T tid)
 	uPtrs = ssGetInputPortRealSignalPtrs (S, 0);
 
 
-	for (i=0; i < n; i++)
-		for (j=0; j < numPhases; j++)
-			ppys [j] [i] = *uPtrs [factor * i + pPhases[j]];
+	if (isFullPhaseSet (pPhases, numPhases, factor))
+	{
+		/* Common factors get their own copies of the deinterleaving
+		   loop with a constant factor, so the compiler can unroll the
+		   inner loop and keep the input loads contiguous. */
+		switch (factor)
+		{
+			case 2:		DEINTERLEAVE (2);		break;
+			case 4:		DEINTERLEAVE (4);		break;
+			case 8:		DEINTERLEAVE (8);		break;
+			default:	DEINTERLEAVE (factor);	break;
+		}
+	}
+	else
+	{
+		for (i=0; i < n; i++)
+			for (j=0; j < numPhases; j++)
+				ppys [j] [i] = *uPtrs [factor * i + pPhases[j]];
+	}
 }
 
 
@@ -230,8 +231,7 @@ static void mdlOutputs(SimStruct *S, int_T tid)
  */
 static void mdlTerminate(SimStruct *S)
 {
-	free (GET_PHASES);
-	free (GET_YS);
+	/* The work vectors are freed by Simulink */
 }
 
 # if defined(MATLAB_MEX_FILE)
@@ -320,6 +320,28 @@ static void mdlCheckParameters (SimStruct *S)
 
 
 
+/* Function: isFullPhaseSet ===================================================
+ * Abstract:
+ *
+ * Returns nonzero if and only if the specified (zero-based) phases are
+ * all of the phases from 0 to factor-1, in increasing order.
+ */
+static int_T isFullPhaseSet (int_T *pPhases, int_T numPhases, int_T factor)
+{
+	int_T		j;
+
+	if (numPhases != factor)
+		return 0;
+
+	for (j=0; j < numPhases; j++)
+		if (pPhases [j] != j)
+			return 0;
+
+	return 1;
+}
+
+
+
 /*=============================*
  * Required S-function trailer *
  *=============================*/
@@ -215,15 +215,19 @@ static void mdlOutputs(SimStruct *S, int_T tid)
 
 	if (COL_MAJOR)
 	{
-		/* Former inputs are saved in state vector */
-		for (i=0; i < overlap; i++)
+		/* Channels are stored as columns, so loop over channels in the outer
+		   loop and samples in the inner loops, which then run through
+		   contiguous memory */
 		for (channel=0; channel < numChannels; channel++)
-			OUTPUT_C(channel,i) = FORMER_INPUT(channel,i);
+		{
+			/* Former inputs are saved in state vector */
+			for (i=0; i < overlap; i++)
+				OUTPUT_C(channel,i) = FORMER_INPUT(channel,i);
 
-		/* If state vector is used up, continue with current inputs */
-		for ( ; i < n; i++)
-		for (channel=0; channel < numChannels; channel++)
-			OUTPUT_C(channel,i) = INPUT_C(channel,i-overlap);
+			/* If state vector is used up, continue with current inputs */
+			for ( ; i < n; i++)
+				OUTPUT_C(channel,i) = INPUT_C(channel,i-overlap);
+		}
 	}
 
 	else /* ROW MAJOR */
@@ -270,19 +274,20 @@ static void mdlUpdate(SimStruct *S, int_T tid)
 
 	if (COL_MAJOR)
 	{
-		/* Save last inputs */
+		/* Save last inputs, looping over channels in the outer loop as
+		   in mdlOutputs */
 		if (overlap <= n)
 		{
 			SET_FORMER_INDEX (0);
 
-			for (i=0; i < overlap; i++)
 			for (channel=0; channel < numChannels; channel++)
+			for (i=0; i < overlap; i++)
 				RAW_FORMER_INPUT(channel,i) = INPUT_C(channel,n-overlap+i);
 		}
 		else
 		{
-			for (i=0; i < n; i++)
 			for (channel=0; channel < numChannels; channel++)
+			for (i=0; i < n; i++)
 				FORMER_INPUT(channel,i) = INPUT_C(channel,i);
 
 			SET_FORMER_INDEX ((formerIndex + n) % overlap);
@@ -222,7 +222,7 @@ static void mdlOutputs(SimStruct *S, int_T tid)
 	int_T				i, n, m, integrationTime, formerIndex, channel, numChannels;
 	real_T				*x, *y; 
 	InputRealPtrsType	uPtrs;
-	real_T				normalizationFactor;
+	real_T				normalizationFactor, value;
 
 	x = ssGetRealDiscStates (S);
 	uPtrs = ssGetInputPortRealSignalPtrs (S, 0);
@@ -244,21 +244,31 @@ static void mdlOutputs(SimStruct *S, int_T tid)
 
 	if (COL_MAJOR)
 	{
-		/* Former inputs are saved in state vector */
+		/* Channels are stored as columns, so loop over channels in the outer
+		   loop and samples in the inner loops, which then run through
+		   contiguous memory */
 		m = MIN(n, integrationTime);
-		for (i=0; i < m; i++)
 		for (channel=0; channel < numChannels; channel++)
 		{
-			SET_VALUE (channel, GET_VALUE(channel) + INPUT_C(channel,i) - FORMER_INPUT(channel,i));
-			OUTPUT_C(channel,i) = GET_VALUE(channel) * normalizationFactor;
-		}
-
-		/* If state vector is used up, continue with current inputs */
-		for ( ; i < n; i++)
-		for (channel=0; channel < numChannels; channel++)
-		{
-			SET_VALUE (channel, GET_VALUE(channel) + INPUT_C(channel,i) - INPUT_C(channel,i-integrationTime));
-			OUTPUT_C(channel,i) = GET_VALUE(channel) * normalizationFactor;
+			/* Keep the running sum of this channel in a local variable
+			   while we loop over its samples */
+			value = GET_VALUE(channel);
+
+			/* Former inputs are saved in state vector */
+			for (i=0; i < m; i++)
+			{
+				value = value + INPUT_C(channel,i) - FORMER_INPUT(channel,i);
+				OUTPUT_C(channel,i) = value * normalizationFactor;
+			}
+
+			/* If state vector is used up, continue with current inputs */
+			for ( ; i < n; i++)
+			{
+				value = value + INPUT_C(channel,i) - INPUT_C(channel,i-integrationTime);
+				OUTPUT_C(channel,i) = value * normalizationFactor;
+			}
+
+			SET_VALUE (channel, value);
 		}
 	}
 
@@ -315,19 +325,20 @@ static void mdlUpdate(SimStruct *S, int_T tid)
 
 	if (COL_MAJOR)
 	{
-		/* Save last inputs */
+		/* Save last inputs, looping over channels in the outer loop as
+		   in mdlOutputs */
 		if (integrationTime <= n)
 		{
 			SET_FORMER_INDEX (0);
 
-			for (i=0; i < integrationTime; i++)
 			for (channel=0; channel < numChannels; channel++)
+			for (i=0; i < integrationTime; i++)
 				RAW_FORMER_INPUT(channel,i) = INPUT_C(channel, n-integrationTime+i);
 		}
 		else
 		{
-			for (i=0; i < n; i++)
 			for (channel=0; channel < numChannels; channel++)
+			for (i=0; i < n; i++)
 				FORMER_INPUT(channel,i) = INPUT_C(channel, i);
 
 			SET_FORMER_INDEX ((formerIndex + n) % integrationTime);
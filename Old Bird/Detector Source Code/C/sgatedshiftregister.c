@@ -9,7 +9,17 @@
  * The input vector has width n.
  *
  * Simulink state elements carry the contents of the shift register.
- * The states are organized as a circular buffer.
+ * The states are organized as a circular buffer whose length is the
+ * smallest power of two that is at least the length of the shift
+ * register, so that positions in it can be computed with a mask
+ * instead of a modulus.  The register comprises the most recent
+ * "Length of shift register" values written to the buffer.
+ *
+ * The gate is typically nonzero only rarely (in the Overload Check
+ * Valve, for example, it is an edge detector output), so rather than
+ * testing it and outputting the oldest register value one sample at
+ * a time, the block scans for the next nonzero gate value and fills
+ * the output up to it with the oldest register value in bulk.
  *
  * Parameters are:
  *		Size of buffer
@@ -61,12 +71,12 @@ enum{
 
 /* Integer work vector */
 enum{
-	kFORMER_INDEX,			/* Position of circular buffer		*/
+	kWRITE_INDEX,			/* Position of next write to circular buffer	*/
 	kNUMIWORKITEMS
 };
 
-#define GET_FORMER_INDEX		(ssGetIWorkValue (S, kFORMER_INDEX))
-#define SET_FORMER_INDEX(x)		(ssSetIWorkValue (S, kFORMER_INDEX, (x)))
+#define GET_WRITE_INDEX			(ssGetIWorkValue (S, kWRITE_INDEX))
+#define SET_WRITE_INDEX(x)		(ssSetIWorkValue (S, kWRITE_INDEX, (x)))
 
 /* States */
 #define RAW_FORMER_INPUT(channel,i)		(x[numChannels*(i)+(channel)])
@@ -78,6 +88,7 @@ enum{
 
 /* Prototypes */
 static void mdlCheckParameters (SimStruct *S);
+static long getRingSize (long regSize);
 
 
 /*====================*
@@ -104,7 +115,7 @@ static void mdlInitializeSizes(SimStruct *S)
 #endif
 
     ssSetNumContStates(    S, 0);   /* number of continuous states           */
-    ssSetNumDiscStates(    S, REG_SIZE * NUM_CHANNELS);   
+    ssSetNumDiscStates(    S, getRingSize (REG_SIZE) * NUM_CHANNELS);   
 									/* number of discrete states             */
 	if (!ssSetNumInputPorts  (S, 2)) return;
 	if (!ssSetNumOutputPorts (S, 1)) return;
@@ -167,10 +178,10 @@ static void mdlInitializeConditions(SimStruct *S)
 
 	x = ssGetRealDiscStates (S);
 
-	SET_FORMER_INDEX (0);
+	SET_WRITE_INDEX (0);
 
 	/* Prehistory inputs are zero */
-	m = REG_SIZE;
+	m = getRingSize (REG_SIZE);
 	numChannels = NUM_CHANNELS;
 	for (i=0; i < m; i++)
 	for (channel=0; channel < numChannels; channel++)
@@ -186,7 +197,7 @@ static void mdlInitializeConditions(SimStruct *S)
  * block. The outputs are placed in the y variable.
  */
 
-#define FORMER_INPUT(channel,i)		(RAW_FORMER_INPUT((channel),(GET_FORMER_INDEX + (i)) % reg_size))
+#define OLDEST_INPUT(channel)		(RAW_FORMER_INPUT((channel),(writeIndex - reg_size) & mask))
 #define INPUT_R(channel,i)			(*uPtrs[numChannels*(i)+(channel)])
 #define OUTPUT_R(channel,i)			(y     [numChannels*(i)+(channel)])
 #define INPUT_C(channel,i)			(*uPtrs[(i)+n*(channel)])
@@ -195,8 +206,8 @@ static void mdlInitializeConditions(SimStruct *S)
 
 static void mdlOutputs(SimStruct *S, int_T tid)
 {
-	int_T				i, n, reg_size, channel, numChannels;
-	real_T				*x, *y; 
+	int_T				i, j, end, n, reg_size, mask, writeIndex, channel, numChannels;
+	real_T				*x, *y, value; 
 	InputRealPtrsType	uPtrs, gPtrs;
 
 	x = ssGetRealDiscStates (S);
@@ -206,49 +217,64 @@ static void mdlOutputs(SimStruct *S, int_T tid)
 
 	n = BUFFER_SIZE;
 	reg_size = REG_SIZE;
+	mask = getRingSize (reg_size) - 1;
 	numChannels = NUM_CHANNELS;
+	writeIndex = GET_WRITE_INDEX;
 
-	if (COL_MAJOR)
+	/* Simulate operation of shift register */
+	for (i=0; ; i++)
 	{
-		/* Simulate operation of shift register */
-		for (i=0; i < n; i++)
+		/* Find next nonzero gate value */
+		for (end=i; end < n && GATE (end) == 0.0; end++)
+			;
+
+		/* Output oldest value up to it */
+		if (COL_MAJOR)
 		{
-			/* Shift new input into shift register */
-			if (GATE (i) != 0.0)
+			for (channel=0; channel < numChannels; channel++)
 			{
-				SET_FORMER_INDEX ((GET_FORMER_INDEX + 1) % reg_size);
-	
-				for (channel=0; channel < numChannels; channel++)
-					FORMER_INPUT(channel,reg_size-1)=INPUT_C(channel,i);
+				value = OLDEST_INPUT(channel);
+				for (j=i; j < end; j++)
+					OUTPUT_C(channel,j) = value;
 			}
+		}
 
-			/* Output oldest value */
+		else /* ROW MAJOR */
+		{
+			for (j=i; j < end; j++)
 			for (channel=0; channel < numChannels; channel++)
-				OUTPUT_C(channel,i) = FORMER_INPUT(channel,0);
-			
+				OUTPUT_R(channel,j) = OLDEST_INPUT(channel);
 		}
-	}
 
-	else /* ROW MAJOR */
-	{
-		/* Simulate operation of shift register */
-		for (i=0; i < n; i++)
+		if (end == n)
+			break;
+
+		/* Shift new input into shift register, and output oldest value */
+		i = end;
+		if (COL_MAJOR)
 		{
-			/* Shift new input into shift register */
-			if (GATE (i) != 0.0)
-			{
-				SET_FORMER_INDEX ((GET_FORMER_INDEX + 1) % reg_size);
-	
-				for (channel=0; channel < numChannels; channel++)
-					FORMER_INPUT(channel,reg_size-1)=INPUT_R(channel,i);
-			}
+			for (channel=0; channel < numChannels; channel++)
+				RAW_FORMER_INPUT(channel,writeIndex) = INPUT_C(channel,i);
+
+			writeIndex = (writeIndex + 1) & mask;
+
+			for (channel=0; channel < numChannels; channel++)
+				OUTPUT_C(channel,i) = OLDEST_INPUT(channel);
+		}
+
+		else /* ROW MAJOR */
+		{
+			for (channel=0; channel < numChannels; channel++)
+				RAW_FORMER_INPUT(channel,writeIndex) = INPUT_R(channel,i);
+
+			writeIndex = (writeIndex + 1) & mask;
 
-			/* Output oldest value */
 			for (channel=0; channel < numChannels; channel++)
-				OUTPUT_R(channel,i) = FORMER_INPUT(channel,0);
-			
+				OUTPUT_R(channel,i) = OLDEST_INPUT(channel);
 		}
 	}
+
+	SET_WRITE_INDEX (writeIndex);
 }
 
 
@@ -341,6 +367,25 @@ static void mdlCheckParameters (SimStruct *S)
 
 
 
+/* Function: getRingSize ======================================================
+ * Abstract:
+ *
+ * Returns the length of the circular buffer for a shift register of the
+ * specified length, i.e. the smallest power of two that is at least that
+ * length.
+ */
+static long getRingSize (long regSize)
+{
+	long		size;
+
+	for (size=1; size < regSize; size *= 2)
+		;
+
+	return size;
+}
+
+
+
 /*=============================*
  * Required S-function trailer *
  *=============================*/
@@ -211,205 +211,159 @@ static void mdlInitializeConditions(SimStruct *S)
  * block. The outputs are placed in the y variable.
  */
 
-#define CHECK_RESET_R(channel,i)		(*resetPtrs [numChannels*(i) + (channel)] != 0.0)
-#define CHECK_SET_R(channel,i)			(*setPtrs   [numChannels*(i) + (channel)] != 0.0)
-#define OUTPUT_R(channel,i)				(y          [numChannels*(i) + (channel)])
-#define CHECK_RESET_C(channel,i)		(*resetPtrs [(i) + n*(channel)] != 0.0)
-#define CHECK_SET_C(channel,i)			(*setPtrs   [(i) + n*(channel)] != 0.0)
-#define OUTPUT_C(channel,i)				(y          [(i) + n*(channel)])
-
-static void mdlOutputs(SimStruct *S, int_T tid)
+#define CHECK_RESET(i)		(*resetPtrs [offset + stride*(i)] != 0.0)
+#define CHECK_SET(i)		(*setPtrs   [offset + stride*(i)] != 0.0)
+#define OUTPUT(i)			(y          [offset + stride*(i)])
+
+/* Processes the samples of one channel, which are at indices
+   offset + stride*i of the inputs and output for 0 <= i < n.
+
+   Rather than testing the set and reset inputs and the output pulse
+   duration limits at every sample, this jumps from one set or reset
+   event to the next.  Between events the output is constant except
+   where a limit is reached, and the position at which a limit is
+   reached follows from the output count, so the output is filled in
+   runs and the count advanced by the length of each run.  Most input
+   samples are quiet, so most of the time goes to the event scan and
+   the fills. */
+static void processChannel (
+	InputRealPtrsType resetPtrs, InputRealPtrsType setPtrs, real_T *y,
+	int_T offset, int_T stride, int_T n, int_T minLimit, int_T maxLimit,
+	real_T *pState, int_T *pCount)
 {
-	int_T				i, n, channel, numChannels, minLimit, maxLimit;
-	real_T				*x, *y; 
-	InputRealPtrsType	resetPtrs, setPtrs;
-
-	x = ssGetRealDiscStates (S);
-	resetPtrs = ssGetInputPortRealSignalPtrs (S, 0);
-	setPtrs   = ssGetInputPortRealSignalPtrs (S, 1);
-	y = ssGetOutputPortSignal (S, 0);
+	int_T		i, j, end, count;
+	real_T		state;
 
-	numChannels = NUM_CHANNELS;
-	n = BUFFER_SIZE;
-	minLimit = MIN_LIMIT;
-	maxLimit = MAX_LIMIT;
-
-	/* Simulink state element holds previous final state	*/
-	for (channel=0; channel < numChannels; channel++)
-		SET_STATE(channel, x[channel]);	
-
-	/* ...and previous output count							*/
-	for (channel=0; channel < numChannels; channel++)
-		SET_COUNT(channel, (int_T) floor(0.5+x[numChannels + channel]));	
+	state = *pState;
+	count = *pCount;
 
-	if (COL_MAJOR)
+	for (i=0; i < n; )
 	{
-		if (maxLimit != 0 && minLimit != 0)
-		{
-			for (i=0; i < n; i++)
-				for (channel=0; channel < numChannels; channel++)
-				{
-					if (CHECK_RESET_C (channel,i) || GET_COUNT(channel) >= maxLimit)
-						SET_STATE(channel,0.0);
-					else if (CHECK_SET_C (channel,i))
-						SET_STATE(channel,1.0);
-					
-					if (!GET_STATE(channel) && 
-						(GET_COUNT(channel) == 0 || GET_COUNT(channel) >= minLimit))
-					{
-						OUTPUT_C(channel,i) = 0.0;
-						SET_COUNT(channel, 0);
-					}
-					else
-					{
-						OUTPUT_C(channel,i) = 1.0;
-						SET_COUNT(channel,GET_COUNT(channel)+1);
-					}
-				}
-		}
-		else if (maxLimit != 0 && minLimit == 0)
-		{
-			for (i=0; i < n; i++)
-				for (channel=0; channel < numChannels; channel++)
-				{
-					if (CHECK_RESET_C (channel,i) || GET_COUNT(channel) >= maxLimit)
-						SET_STATE(channel,0.0);
-					else if (CHECK_SET_C (channel,i))
-						SET_STATE(channel,1.0);
-					
-					if (!GET_STATE(channel))
-					{
-						OUTPUT_C(channel,i) = 0.0;
-						SET_COUNT(channel, 0);
-					}
-					else
-					{
-						OUTPUT_C(channel,i) = 1.0;
-						SET_COUNT(channel,GET_COUNT(channel)+1);
-					}
-				}
-		}
-		else if (maxLimit == 0 && minLimit != 0)
+		/* Find next set or reset event */
+		for (end=i; end < n && !CHECK_RESET(end) && !CHECK_SET(end); end++)
+			;
+
+		/* Fill output up to event */
+		if (maxLimit == 0 && minLimit == 0)
 		{
-			for (i=0; i < n; i++)
-				for (channel=0; channel < numChannels; channel++)
-				{
-					if (CHECK_RESET_C (channel,i))
-						SET_STATE(channel,0.0);
-					else if (CHECK_SET_C (channel,i))
-						SET_STATE(channel,1.0);
-					
-					if (!GET_STATE(channel) && 
-						(GET_COUNT(channel) == 0 || GET_COUNT(channel) >= minLimit))
-					{
-						OUTPUT_C(channel,i) = 0.0;
-						SET_COUNT(channel, 0);
-					}
-					else
-					{
-						OUTPUT_C(channel,i) = 1.0;
-						SET_COUNT(channel,GET_COUNT(channel)+1);
-					}
-				}
+			/* No output pulse duration limits, so output holds state */
+			for ( ; i < end; i++)
+				OUTPUT(i) = state;
 		}
-		else /* No output pulse duration limits */
+		else
 		{
-			for (i=0; i < n; i++)
-				for (channel=0; channel < numChannels; channel++)
+			if (state)
+			{
+				/* Output stays high until maximum duration is reached */
+				j = end;
+				if (maxLimit != 0 && j - i > maxLimit - count)
+					j = i + (count < maxLimit ? maxLimit - count : 0);
+
+				count += j - i;
+				for ( ; i < j; i++)
+					OUTPUT(i) = 1.0;
+
+				if (i < end)
+					state = 0.0;
+			}
+
+			if (!state && i < end)
+			{
+				/* Output stays high until minimum duration is reached */
+				if (count != 0 && count < minLimit)
 				{
-					if (CHECK_RESET_C (channel,i))
-						SET_STATE(channel,0.0);
-					else if (CHECK_SET_C (channel,i))
-						SET_STATE(channel,1.0);
-					
-					OUTPUT_C(channel,i) = GET_STATE(channel);
-				}
-		}
-	}
+					j = end;
+					if (j - i > minLimit - count)
+						j = i + minLimit - count;
 
-	else /* ROW MAJOR */
-	{
-		if (maxLimit != 0 && minLimit != 0)
-		{
-			for (i=0; i < n; i++)
-				for (channel=0; channel < numChannels; channel++)
-				{
-					if (CHECK_RESET_R (channel,i) || GET_COUNT(channel) >= maxLimit)
-						SET_STATE(channel,0.0);
-					else if (CHECK_SET_R (channel,i))
-						SET_STATE(channel,1.0);
-					
-					if (!GET_STATE(channel) && 
-						(GET_COUNT(channel) == 0 || GET_COUNT(channel) >= minLimit))
-					{
-						OUTPUT_R(channel,i) = 0.0;
-						SET_COUNT(channel, 0);
-					}
-					else
-					{
-						OUTPUT_R(channel,i) = 1.0;
-						SET_COUNT(channel,GET_COUNT(channel)+1);
-					}
+					count += j - i;
+					for ( ; i < j; i++)
+						OUTPUT(i) = 1.0;
 				}
-		}
-		else if (maxLimit != 0 && minLimit == 0)
-		{
-			for (i=0; i < n; i++)
-				for (channel=0; channel < numChannels; channel++)
+
+				if (i < end)
 				{
-					if (CHECK_RESET_R (channel,i) || GET_COUNT(channel) >= maxLimit)
-						SET_STATE(channel,0.0);
-					else if (CHECK_SET_R (channel,i))
-						SET_STATE(channel,1.0);
-					
-					if (!GET_STATE(channel))
-					{
-						OUTPUT_R(channel,i) = 0.0;
-						SET_COUNT(channel, 0);
-					}
-					else
-					{
-						OUTPUT_R(channel,i) = 1.0;
-						SET_COUNT(channel,GET_COUNT(channel)+1);
-					}
+					count = 0;
+					for ( ; i < end; i++)
+						OUTPUT(i) = 0.0;
 				}
+			}
 		}
-		else if (maxLimit == 0 && minLimit != 0)
+
+		if (i == n)
+			break;
+
+		/* Process event sample */
+		if (maxLimit == 0 && minLimit == 0)
 		{
-			for (i=0; i < n; i++)
-				for (channel=0; channel < numChannels; channel++)
-				{
-					if (CHECK_RESET_R (channel,i))
-						SET_STATE(channel,0.0);
-					else if (CHECK_SET_R (channel,i))
-						SET_STATE(channel,1.0);
-					
-					if (!GET_STATE(channel) && 
-						(GET_COUNT(channel) == 0 || GET_COUNT(channel) >= minLimit))
-					{
-						OUTPUT_R(channel,i) = 0.0;
-						SET_COUNT(channel, 0);
-					}
-					else
-					{
-						OUTPUT_R(channel,i) = 1.0;
-						SET_COUNT(channel,GET_COUNT(channel)+1);
-					}
-				}
+			if (CHECK_RESET (i))
+				state = 0.0;
+			else if (CHECK_SET (i))
+				state = 1.0;
+
+			OUTPUT(i) = state;
 		}
-		else /* No output pulse duration limits */
+		else
 		{
-			for (i=0; i < n; i++)
-				for (channel=0; channel < numChannels; channel++)
-				{
-					if (CHECK_RESET_R (channel,i))
-						SET_STATE(channel,0.0);
-					else if (CHECK_SET_R (channel,i))
-						SET_STATE(channel,1.0);
-					
-					OUTPUT_R(channel,i) = GET_STATE(channel);
-				}
+			if (CHECK_RESET (i) || (maxLimit != 0 && count >= maxLimit))
+				state = 0.0;
+			else if (CHECK_SET (i))
+				state = 1.0;
+
+			/* With minLimit zero, count >= minLimit always holds */
+			if (!state && (count == 0 || count >= minLimit))
+			{
+				OUTPUT(i) = 0.0;
+				count = 0;
+			}
+			else
+			{
+				OUTPUT(i) = 1.0;
+				count++;
+			}
 		}
+
+		i++;
+	}
+
+	*pState = state;
+	*pCount = count;
+}
+
+static void mdlOutputs(SimStruct *S, int_T tid)
+{
+	int_T				n, channel, numChannels, minLimit, maxLimit, count;
+	real_T				*x, *y, state;
+	InputRealPtrsType	resetPtrs, setPtrs;
+
+	x = ssGetRealDiscStates (S);
+	resetPtrs = ssGetInputPortRealSignalPtrs (S, 0);
+	setPtrs   = ssGetInputPortRealSignalPtrs (S, 1);
+	y = ssGetOutputPortSignal (S, 0);
+
+	numChannels = NUM_CHANNELS;
+	n = BUFFER_SIZE;
+	minLimit = MIN_LIMIT;
+	maxLimit = MAX_LIMIT;
+
+	for (channel=0; channel < numChannels; channel++)
+	{
+		/* Simulink state elements hold previous final state and
+		   previous output count */
+		state = x[channel];
+		count = (int_T) floor(0.5+x[numChannels + channel]);
+
+		/* Channels are processed one at a time, so with column-major
+		   storage each channel's samples are contiguous */
+		if (COL_MAJOR)
+			processChannel (resetPtrs, setPtrs, y, n*channel, 1, n,
+							minLimit, maxLimit, &state, &count);
+		else /* ROW MAJOR */
+			processChannel (resetPtrs, setPtrs, y, channel, numChannels, n,
+							minLimit, maxLimit, &state, &count);
+
+		SET_STATE(channel, state);
+		SET_COUNT(channel, count);
 	}
 }
 
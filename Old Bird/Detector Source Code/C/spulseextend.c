@@ -0,0 +1,416 @@
+/*
+ * spulseextend.c: Buffered Pulse Extend
+ *
+ * Takes buffered input stream, "x", and extends the ends
+ * (1-0 transitions) of pulses by a number of samples (LAG),
+ * outputting "y".  More generally, each output sample is the
+ * maximum of the current input sample and the LAG input
+ * samples preceding it, so that the block also works for
+ * non-boolean gates.  "Prehistory" inputs are assumed to
+ * be zero.
+ *
+ * The input vector has width n.
+ *
+ * The maximum is maintained for each channel with a monotonic
+ * wedge, i.e. a deque of the input samples that can still become
+ * the maximum of the window: each is larger than all of the
+ * samples following it.  Each input sample enters and leaves
+ * the wedge at most once, so the cost per sample does not depend
+ * on LAG.  For boolean pulses the wedge never holds more than two
+ * samples, the most recent nonzero one and the most recent zero
+ * one, and so acts as a countdown register.
+ *
+ * The RWork vector holds the values of the samples of the wedges,
+ * and the IWork vector their times and the position and size of
+ * each wedge in its circular buffer.  Simulink state elements
+ * carry over the final wedges, with sample times relative to
+ * the start of the next input buffer.
+ *
+ * Parameters are:
+ *		Size of buffer
+ *      Lag
+ *      Number of channels
+ *      Multichannel order (1= column major, 0 = row major)
+ */
+
+
+/*
+ * You must specify the S_FUNCTION_NAME as the name of your S-function.
+ */
+
+#define S_FUNCTION_NAME spulseextend
+#define S_FUNCTION_LEVEL 2
+
+/*
+ * Need to include simstruc.h for the definition of the SimStruct and
+ * its associated macro definitions.
+ */
+#include "simstruc.h"
+#include <math.h>
+
+
+
+/* Simulink block parameters */
+enum{
+	kBUFFER_SIZE,			/* Input width					*/
+	kLAG,					/* Pulse extension				*/
+	kNUM_CHANNELS,			/* Number of channels			*/
+	kCOL_MAJOR,				/* Nonzero if multi channels are stored as columns	*/
+	kNUM_PARAMETERS
+};
+
+#define BUFFER_SIZE			((long)  floor(0.5+*mxGetPr(ssGetSFcnParam (S, kBUFFER_SIZE))))
+#define LAG					((long)  floor(0.5+*mxGetPr(ssGetSFcnParam (S, kLAG))))
+#define NUM_CHANNELS		((long)  floor(0.5+*mxGetPr(ssGetSFcnParam (S, kNUM_CHANNELS))))
+#define COL_MAJOR			((long)  floor(0.5+*mxGetPr(ssGetSFcnParam (S, kCOL_MAJOR))))
+
+/* Work vectors.  Each channel has a circular buffer of
+   capacity LAG+1 for its wedge. */
+#define WEDGE_VALUE(channel,k)	(rWork[capacity*(channel)+(k)])
+#define WEDGE_TIME(channel,k)	(iWork[capacity*(channel)+(k)])
+#define WEDGE_HEAD(channel)		(iWork[capacity*numChannels+(channel)])
+#define WEDGE_SIZE(channel)		(iWork[capacity*numChannels+numChannels+(channel)])
+
+/* States.  Each channel has a wedge size followed by
+   LAG+1 (value, time) pairs, of which the first size are used. */
+#define STATE_SIZE(channel)		(x[(2*capacity+1)*(channel)])
+#define STATE_VALUE(channel,k)	(x[(2*capacity+1)*(channel)+1+2*(k)])
+#define STATE_TIME(channel,k)	(x[(2*capacity+1)*(channel)+2+2*(k)])
+
+/* Macros */
+#define RETURN_IF_ERROR			if (ssGetErrorStatus (S) != NULL) return;
+#define ERROR_STRING(a)			a
+
+/* Prototypes */
+static void mdlCheckParameters (SimStruct *S);
+
+
+/*====================*
+ * S-function methods *
+ *====================*/
+
+/* Function: mdlInitializeSizes ===============================================
+ * Abstract:
+ *
+ * The sizes information is used by SIMULINK to determine the S-function
+ * block's characteristics (number of inputs, outputs, states, etc.).
+ *
+ */
+static void mdlInitializeSizes(SimStruct *S)
+{
+
+	ssSetNumSFcnParams (S, kNUM_PARAMETERS);  /* Number of expected parameters */
+
+#if defined(MATLAB_MEX_FILE)
+	if (ssGetNumSFcnParams (S) != ssGetSFcnParamsCount (S))
+		return;
+
+	mdlCheckParameters (S);		RETURN_IF_ERROR;
+#endif
+
+    ssSetNumContStates(    S, 0);   /* number of continuous states           */
+    ssSetNumDiscStates(    S, (2 * (LAG + 1) + 1) * NUM_CHANNELS);
+									/* number of discrete states             */
+	if (!ssSetNumInputPorts  (S, 1)) return;
+	if (!ssSetNumOutputPorts (S, 1)) return;
+
+    ssSetInputPortWidth(   S, 0, BUFFER_SIZE * NUM_CHANNELS);
+									/* number of inputs                      */
+    ssSetOutputPortWidth(  S, 0, BUFFER_SIZE * NUM_CHANNELS);
+									/* number of outputs                     */
+    ssSetInputPortDirectFeedThrough(S, 0, 1);
+									/* direct feedthrough flag               */
+    ssSetNumSampleTimes(   S, 1);   /* number of sample times                */
+    ssSetNumRWork(         S, (LAG + 1) * NUM_CHANNELS);
+									/* number of real work vector elements   */
+    ssSetNumIWork(         S, (LAG + 3) * NUM_CHANNELS);
+									/* number of integer work vector elements*/
+    ssSetNumPWork(         S, 0);   /* number of pointer work vector elements*/
+    ssSetNumModes(         S, 0);   /* number of mode work vector elements   */
+    ssSetNumNonsampledZCs( S, 0);   /* number of nonsampled zero crossings   */
+#if 1
+    ssSetOptions(          S, 0);	/* general options (SS_OPTION_xx)        */
+#else
+	/* We don't ever call mexErrMsgTxt, any mex... functions,
+	   or otherwise cause a "long jump"
+	 */
+	ssSetOptions (S, SS_OPTION_EXCEPTION_FREE_CODE);
+#endif
+}
+
+
+
+/* Function: mdlInitializeSampleTimes =========================================
+ * Abstract:
+ *
+ * This function is used to specify the sample time(s) for your S-function.
+ * You must register the same number of sample times as specified in
+ * ssSetNumSampleTimes.
+ */
+static void mdlInitializeSampleTimes(SimStruct *S)
+{
+    ssSetSampleTime(S, 0, INHERITED_SAMPLE_TIME);
+    ssSetOffsetTime(S, 0, FIXED_IN_MINOR_STEP_OFFSET);
+}
+
+
+
+/* Function: mdlInitializeConditions ==========================================
+ * Abstract:
+ *
+ * In this function, you should initialize the continuous and discrete
+ * states for your S-function block.  The initial states are placed
+ * in the x0 variable.  You can also perform any other initialization
+ * activities that your S-function may require.
+ */
+#define MDL_INITIALIZE_CONDITIONS
+static void mdlInitializeConditions(SimStruct *S)
+{
+	long		channel, numChannels, capacity;
+	real_T		*x;
+
+	x = ssGetRealDiscStates (S);
+
+	numChannels = NUM_CHANNELS;
+	capacity = LAG + 1;
+
+	/* Prehistory inputs are zero, so each wedge initially holds
+	   only the last of them */
+	for (channel=0; channel < numChannels; channel++)
+	{
+		STATE_SIZE(channel) = 1;
+		STATE_VALUE(channel,0) = 0.0;
+		STATE_TIME(channel,0) = -1;
+	}
+}
+
+
+
+/* Function: mdlOutputs =======================================================
+ * Abstract:
+ *
+ * In this function, you compute the outputs of your S-function
+ * block. The outputs are placed in the y variable.
+ */
+
+#define INPUT_R(channel,i)			(*uPtrs[numChannels*(i)+(channel)])
+#define OUTPUT_R(channel,i)			(y     [numChannels*(i)+(channel)])
+#define INPUT_C(channel,i)			(*uPtrs[(i)+n*(channel)])
+#define OUTPUT_C(channel,i)			(y     [(i)+n*(channel)])
+
+/* Advances the wedge of a channel by one input sample, "value",
+   at time i, and outputs the maximum of the window ending there */
+#define ADVANCE(channel,i,value,output)												\
+{																					\
+	head = WEDGE_HEAD(channel);														\
+	size = WEDGE_SIZE(channel);														\
+																					\
+	/* Drop the oldest sample if it is leaving the window */						\
+	if (size > 0 && WEDGE_TIME(channel,head) < (i) - lag)							\
+	{																				\
+		head = (head + 1) % capacity;												\
+		size--;																		\
+	}																				\
+																					\
+	/* Drop samples that can no longer be the maximum */							\
+	while (size > 0 && WEDGE_VALUE(channel, (head + size - 1) % capacity) <= (value))	\
+		size--;																		\
+																					\
+	k = (head + size) % capacity;													\
+	WEDGE_VALUE(channel,k) = (value);												\
+	WEDGE_TIME(channel,k) = (i);													\
+	size++;																			\
+																					\
+	output = WEDGE_VALUE(channel,head);												\
+																					\
+	WEDGE_HEAD(channel) = head;														\
+	WEDGE_SIZE(channel) = size;														\
+}
+
+static void mdlOutputs(SimStruct *S, int_T tid)
+{
+	int_T				i, k, n, lag, capacity, head, size, channel, numChannels;
+	int_T				*iWork;
+	real_T				*x, *y, *rWork;
+	InputRealPtrsType	uPtrs;
+
+	x = ssGetRealDiscStates (S);
+	uPtrs = ssGetInputPortRealSignalPtrs (S, 0);
+	y = ssGetOutputPortSignal (S, 0);
+	rWork = ssGetRWork (S);
+	iWork = ssGetIWork (S);
+
+	n = BUFFER_SIZE;
+	lag = LAG;
+	capacity = lag + 1;
+	numChannels = NUM_CHANNELS;
+
+	/* Simulink state elements hold previous final wedges */
+	for (channel=0; channel < numChannels; channel++)
+	{
+		size = (int_T) floor(0.5+STATE_SIZE(channel));
+		for (k=0; k < size; k++)
+		{
+			WEDGE_VALUE(channel,k) = STATE_VALUE(channel,k);
+			WEDGE_TIME(channel,k) = (int_T) floor(0.5+STATE_TIME(channel,k));
+		}
+		WEDGE_HEAD(channel) = 0;
+		WEDGE_SIZE(channel) = size;
+	}
+
+	if (COL_MAJOR)
+	{
+		/* Channels are stored as columns, so loop over channels in the outer
+		   loop and samples in the inner loops, which then run through
+		   contiguous memory */
+		for (channel=0; channel < numChannels; channel++)
+			for (i=0; i < n; i++)
+				ADVANCE(channel, i, INPUT_C(channel,i), OUTPUT_C(channel,i));
+	}
+
+	else /* ROW MAJOR */
+	{
+		for (i=0; i < n; i++)
+			for (channel=0; channel < numChannels; channel++)
+				ADVANCE(channel, i, INPUT_R(channel,i), OUTPUT_R(channel,i));
+	}
+}
+
+
+
+/* Function: mdlUpdate ========================================================
+ * Abstract:
+ *
+ * This function is called once for every major integration time step.
+ * Discrete states are typically updated here, but this function is useful
+ * for performing any tasks that should only take place once per integration
+ * step.
+ */
+#define MDL_UPDATE
+static void mdlUpdate(SimStruct *S, int_T tid)
+{
+	int_T			k, n, capacity, head, size, channel, numChannels;
+	int_T			*iWork;
+	real_T			*x, *rWork;
+
+	x = ssGetRealDiscStates (S);
+	rWork = ssGetRWork (S);
+	iWork = ssGetIWork (S);
+
+	n = BUFFER_SIZE;
+	capacity = LAG + 1;
+	numChannels = NUM_CHANNELS;
+
+	/* Save wedges, with times relative to the start of the next buffer */
+	for (channel=0; channel < numChannels; channel++)
+	{
+		head = WEDGE_HEAD(channel);
+		size = WEDGE_SIZE(channel);
+		STATE_SIZE(channel) = size;
+		for (k=0; k < size; k++)
+		{
+			STATE_VALUE(channel,k) = WEDGE_VALUE(channel, (head + k) % capacity);
+			STATE_TIME(channel,k) = WEDGE_TIME(channel, (head + k) % capacity) - n;
+		}
+	}
+}
+
+
+
+/* Function: mdlTerminate =====================================================
+ * Abstract:
+ *
+ * In this function, you should perform any actions that are necessary
+ * at the termination of a simulation.  For example, if memory was allocated
+ * in mdlInitializeConditions, this is the place to free it.
+ */
+static void mdlTerminate(SimStruct *S)
+{
+}
+
+# if defined(MATLAB_MEX_FILE)
+  /* Function: mdlCheckParameters =============================================
+   * Abstract:
+   *    This routine will be called after mdlInitializeSizes, whenever
+   *    parameters change or get re-evaluated. The purpose of this routine is
+   *    to verify that the new parameter setting are correct.
+   *
+   *    You should add a call to this routine from mdlInitalizeSizes
+   *    to check the parameters. After setting the number of parameters
+   *    you expect in your S-function via ssSetNumSFcnParams(S,n), you should:
+   *     #if defined(MATLAB_MEX_FILE)
+   *       if (ssGetNumSFcnParams(S) == ssGetSFcnParamsCount(S)) {
+   *           mdlCheckParameters(S);
+   *           if (ssGetErrorStatus(S) != NULL) return;
+   *       } else {
+   *           return;     Simulink will report a parameter mismatch error
+   *       }
+   *     #endif
+   *    See matlabroot/simulink/src/sfun_errhdl.c for an example.
+   *
+   *    Your work vectors, for example RWork can be modified based upon
+   *    parameter changes, however you must first verify that any work
+   *    vectors such as RWork are non-NULL.
+   *
+   *    When a Simulation is running, changes to S-function parameters
+   *    can occur either at the start of a simulation step, or during a
+   *    simulation step. When changes to S-function parameters occur during
+   *    a simulation step, this routine is called twice, for the same
+   *    parameter changes. The first call during the simulation step is used
+   *    to verify that the parameters are correct. After verifying the
+   *    new parameters, the simulation continues using the original parameter
+   *    values until the next simulation step at which time the new parameter
+   *    values will be used. During the first call, the work vectors,
+   *    e.g. RWork will be NULL indicating that you should only check the
+   *    parameters. The second call occurs after the simulation step is
+   *    complete, i.e. at the start of the next simulation step. During the
+   *    second call, the work vectors will be non-NULL allowing you to
+   *    modify them based upon the new parameter values. Changing parameters
+   *    at the start of a simulation step, prevents numerical difficulties in
+   *    the solvers due to abrupt parameter changes during a simulation step.
+   */
+# define MDL_CHECK_PARAMETERS
+
+static void mdlCheckParameters (SimStruct *S)
+{
+	long		i;
+
+	for (i=0; i < kNUM_PARAMETERS; i++)
+		if (mxGetNumberOfElements (ssGetSFcnParam(S,i)) != 1)
+		{
+			ssSetErrorStatus (S, ERROR_STRING ("Parameter must be a scalar"));
+			return;
+		}
+
+
+	if (BUFFER_SIZE <= 0)
+	{
+		ssSetErrorStatus (S, ERROR_STRING ("Input width must be positive"));
+		return;
+	}
+
+	if (LAG < 0)
+	{
+		ssSetErrorStatus (S, ERROR_STRING ("Lag must be non-negative"));
+		return;
+	}
+
+	if (NUM_CHANNELS <= 0)
+	{
+		ssSetErrorStatus (S, ERROR_STRING ("Number of channels must be positive"));
+		return;
+	}
+}
+# endif
+
+
+
+/*=============================*
+ * Required S-function trailer *
+ *=============================*/
+
+#ifdef	MATLAB_MEX_FILE    /* Is this file being compiled as a MEX-file? */
+#include "simulink.c"      /* MEX-file interface mechanism */
+#else
+#include "cg_sfun.h"       /* Code generation registration function */
+#endif
@@ -6,6 +6,17 @@
  *
  * The input vector has width m * n.
  *
+ * The transpose is computed recursively, halving the larger of the
+ * row and column ranges until the block to be transposed fits in
+ * a TILE_SIZE x TILE_SIZE tile, so that the reads and writes of each
+ * tile stay in cache whatever the shape of the matrix.  When the
+ * input is contiguous in memory (as it usually is) it is read
+ * directly rather than through the input signal pointers (whether it
+ * is contiguous is determined once, when the block is initialized).  For
+ * square matrices the block allows Simulink to reuse the input
+ * buffer for the output, in which case it transposes in place,
+ * swapping tiles across the diagonal.
+ *
  * Parameters are:
  *		m
  *      n
@@ -49,12 +60,31 @@ enum{
 #define M					((long)  floor(0.5+*mxGetPr(ssGetSFcnParam (S, kM))))
 #define N					((long)  floor(0.5+*mxGetPr(ssGetSFcnParam (S, kN))))
 
+/* Integer work vector */
+enum{
+	kCONTIGUOUS,			/* Nonzero if input is contiguous	*/
+	kNUMIWORKITEMS
+};
+
+#define GET_CONTIGUOUS			(ssGetIWorkValue (S, kCONTIGUOUS))
+#define SET_CONTIGUOUS(x)		(ssSetIWorkValue (S, kCONTIGUOUS, (x)))
+
+/* Size of square tiles transposed directly.  Two tiles of doubles
+   (one read and one written) fit easily in a first level cache. */
+#define TILE_SIZE			16
+
 /* Macros */
 #define RETURN_IF_ERROR			if (ssGetErrorStatus (S) != NULL) return;
 #define ERROR_STRING(a)			a
 
 /* Prototypes */
 static void mdlCheckParameters (SimStruct *S);
+static int_T isContiguous (InputRealPtrsType uPtrs, int_T width);
+static void transpose (const real_T *u, real_T *y, int_T m, int_T n,
+					   int_T i0, int_T i1, int_T j0, int_T j1);
+static void transposePtrs (InputRealPtrsType uPtrs, real_T *y, int_T m, int_T n,
+						   int_T i0, int_T i1, int_T j0, int_T j1);
+static void transposeInPlace (real_T *y, int_T n);
 
 
 /*====================*
@@ -91,10 +121,12 @@ static void mdlInitializeSizes(SimStruct *S)
     ssSetOutputPortWidth(  S, 0, M * N);	
 									/* number of outputs                     */
     ssSetInputPortDirectFeedThrough(S, 0, 1);   
+    ssSetInputPortOverWritable(S, 0, M == N);
+									/* square matrices may be transposed in place */
     ssSetNumSampleTimes(   S, 1);   /* number of sample times                */
     ssSetNumRWork(         S, 0);   
 									/* number of real work vector elements   */
-    ssSetNumIWork(         S, 0);
+    ssSetNumIWork(         S, kNUMIWORKITEMS);
 									/* number of integer work vector elements*/
     ssSetNumPWork(         S, 0);   /* number of pointer work vector elements*/
     ssSetNumModes(         S, 0);   /* number of mode work vector elements   */
@@ -126,6 +158,22 @@ static void mdlInitializeSampleTimes(SimStruct *S)
 
 
 
+/* Function: mdlInitializeConditions ==========================================
+ * Abstract:
+ *
+ * In this function, you should initialize the continuous and discrete
+ * states for your S-function block.  The initial states are placed
+ * in the x0 variable.  You can also perform any other initialization
+ * activities that your S-function may require.
+ */
+#define MDL_INITIALIZE_CONDITIONS
+static void mdlInitializeConditions(SimStruct *S)
+{
+	SET_CONTIGUOUS (isContiguous (ssGetInputPortRealSignalPtrs (S, 0), M * N));
+}
+
+
+
 /* Function: mdlOutputs =======================================================
  * Abstract:
  *
@@ -134,20 +182,24 @@ static void mdlInitializeSampleTimes(SimStruct *S)
  */
 static void mdlOutputs(SimStruct *S, int_T tid)
 {
-	int_T				i, j, m, n;
-	real_T				*x, *y; 
+	int_T				m, n;
+	real_T				*y; 
 	InputRealPtrsType	uPtrs;
 
-	x = ssGetRealDiscStates (S);
 	uPtrs = ssGetInputPortRealSignalPtrs (S, 0);
 	y = ssGetOutputPortSignal (S, 0);
 
 	m = M;
 	n = N;
 
-	for (i=0; i < m; i++)
-	for (j=0; j < n; j++)
-		y[n*i+j]=*uPtrs[m*j+i];
+	if (!GET_CONTIGUOUS)
+		transposePtrs (uPtrs, y, m, n, 0, m, 0, n);
+
+	else if (uPtrs[0] != y)
+		transpose (uPtrs[0], y, m, n, 0, m, 0, n);
+
+	else /* Output overwrites input, which happens only for square matrices */
+		transposeInPlace (y, n);
 }
 
 
@@ -234,6 +286,123 @@ static void mdlCheckParameters (SimStruct *S)
 
 
 
+/* Function: isContiguous =====================================================
+ * Abstract:
+ *
+ * Returns nonzero if and only if the input signal elements are stored
+ * contiguously, in order.
+ */
+static int_T isContiguous (InputRealPtrsType uPtrs, int_T width)
+{
+	int_T		k;
+
+	for (k=1; k < width; k++)
+		if (uPtrs[k] != uPtrs[0] + k)
+			return 0;
+
+	return 1;
+}
+
+
+
+/* Function: transpose ========================================================
+ * Abstract:
+ *
+ * Sets y[n*i+j] to u[m*j+i] for i0 <= i < i1 and j0 <= j < j1.
+ * Blocks larger than a tile are halved along their longer side.
+ */
+static void transpose (const real_T *u, real_T *y, int_T m, int_T n,
+					   int_T i0, int_T i1, int_T j0, int_T j1)
+{
+	int_T		i, j, h;
+
+	if (i1 - i0 > TILE_SIZE && i1 - i0 >= j1 - j0)
+	{
+		h = (i0 + i1) / 2;
+		transpose (u, y, m, n, i0, h, j0, j1);
+		transpose (u, y, m, n, h, i1, j0, j1);
+	}
+	else if (j1 - j0 > TILE_SIZE)
+	{
+		h = (j0 + j1) / 2;
+		transpose (u, y, m, n, i0, i1, j0, h);
+		transpose (u, y, m, n, i0, i1, h, j1);
+	}
+	else
+	{
+		for (i=i0; i < i1; i++)
+		for (j=j0; j < j1; j++)
+			y[n*i+j] = u[m*j+i];
+	}
+}
+
+
+
+/* Function: transposePtrs ====================================================
+ * Abstract:
+ *
+ * Like transpose, but reads the input through signal pointers.
+ */
+static void transposePtrs (InputRealPtrsType uPtrs, real_T *y, int_T m, int_T n,
+						   int_T i0, int_T i1, int_T j0, int_T j1)
+{
+	int_T		i, j, h;
+
+	if (i1 - i0 > TILE_SIZE && i1 - i0 >= j1 - j0)
+	{
+		h = (i0 + i1) / 2;
+		transposePtrs (uPtrs, y, m, n, i0, h, j0, j1);
+		transposePtrs (uPtrs, y, m, n, h, i1, j0, j1);
+	}
+	else if (j1 - j0 > TILE_SIZE)
+	{
+		h = (j0 + j1) / 2;
+		transposePtrs (uPtrs, y, m, n, i0, i1, j0, h);
+		transposePtrs (uPtrs, y, m, n, i0, i1, h, j1);
+	}
+	else
+	{
+		for (i=i0; i < i1; i++)
+		for (j=j0; j < j1; j++)
+			y[n*i+j] = *uPtrs[m*j+i];
+	}
+}
+
+
+
+/* Function: transposeInPlace =================================================
+ * Abstract:
+ *
+ * Transposes the n x n matrix y in place, tile by tile.  Each tile
+ * above the diagonal is swapped with the corresponding tile below it,
+ * and each tile on the diagonal is transposed within itself.
+ */
+static void transposeInPlace (real_T *y, int_T n)
+{
+	int_T		i, j, i0, j0, i1, j1;
+	real_T		t;
+
+	for (i0=0; i0 < n; i0 += TILE_SIZE)
+	{
+		i1 = i0 + TILE_SIZE < n ? i0 + TILE_SIZE : n;
+
+		for (j0=i0; j0 < n; j0 += TILE_SIZE)
+		{
+			j1 = j0 + TILE_SIZE < n ? j0 + TILE_SIZE : n;
+
+			for (i=i0; i < i1; i++)
+			for (j=(j0 == i0 ? i+1 : j0); j < j1; j++)
+			{
+				t = y[n*i+j];
+				y[n*i+j] = y[n*j+i];
+				y[n*j+i] = t;
+			}
+		}
+	}
+}
+
+
+
 /*=============================*
  * Required S-function trailer *
  *=============================*/
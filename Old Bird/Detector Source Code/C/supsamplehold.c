@@ -53,17 +53,12 @@ enum{
 #define INPUT_PHASE(i)		((long)  floor(0.5+ mxGetPr(ssGetSFcnParam (S, kINPUT_PHASES))[i]))
 #define NUM_INPUT_PHASES	(mxGetN(ssGetSFcnParam(S, kINPUT_PHASES)))	
 
-/* Pointer work vector */
-enum{
-	kUPTRS,				/* Input vector pointers		*/
-	kPHASES,			/* Input phases					*/
-	kNUMPWORKITEMS
-};
-
-#define GET_UPTRS				(ssGetPWorkValue (S, kUPTRS))
-#define SET_UPTRS(x)			(ssSetPWorkValue (S, kUPTRS, (x)))
-#define GET_PHASES				(ssGetPWorkValue (S, kPHASES))
-#define SET_PHASES(x)			(ssSetPWorkValue (S, kPHASES, (x)))
+/* Work vectors, sized in mdlInitializeSizes so that Simulink allocates
+   them with the block's other work vectors:
+		pointer work vector		Input vector pointers, one per input phase
+		integer work vector		Input phases, one per input phase		*/
+#define GET_UPTRS				((InputRealPtrsType*) ssGetPWork (S))
+#define GET_PHASES				(ssGetIWork (S))
 
 /* Macros */
 #define MIN(x,y)				((x)<(y) ? (x) : (y))
@@ -72,6 +67,7 @@ enum{
 
 /* Prototypes */
 static void mdlCheckParameters (SimStruct *S);
+static int_T isFullPhaseSet (int_T *pPhases, int_T numPhases, int_T factor);
 
 
 /*====================*
@@ -114,9 +110,9 @@ static void mdlInitializeSizes(SimStruct *S)
     ssSetNumSampleTimes(   S, 1);   /* number of sample times                */
     ssSetNumRWork(         S, 0);   
 									/* number of real work vector elements   */
-    ssSetNumIWork(         S, 0);
+    ssSetNumIWork(         S, NUM_INPUT_PHASES);
 									/* number of integer work vector elements*/
-    ssSetNumPWork(         S, kNUMPWORKITEMS);   
+    ssSetNumPWork(         S, NUM_INPUT_PHASES);   
 									/* number of pointer work vector elements*/
     ssSetNumModes(         S, 0);   /* number of mode work vector elements   */
     ssSetNumNonsampledZCs( S, 0);   /* number of nonsampled zero crossings   */
@@ -158,31 +154,14 @@ static void mdlInitializeSampleTimes(SimStruct *S)
 #define MDL_INITIALIZE_CONDITIONS
 static void mdlInitializeConditions(SimStruct *S)
 {
-	InputRealPtrsType	*puPtrs;
 	int_T				*pPhases;
 	int_T				i;
 
-	puPtrs = (InputRealPtrsType*) malloc (NUM_INPUT_PHASES * sizeof (InputRealPtrsType));
-	if (puPtrs == NULL)
-	{
-		ssSetErrorStatus (S, ERROR_STRING ("Out of memory"));
-		return;
-	}
-
-	SET_UPTRS ((void*) puPtrs);
-
-	pPhases = (int_T*) malloc (NUM_INPUT_PHASES * sizeof (int_T));
-	if (pPhases == NULL)
-	{
-		ssSetErrorStatus (S, ERROR_STRING ("Out of memory"));
-		return;
-	}
+	pPhases = GET_PHASES;
 
 	/* Renumber phases from 0 to factor-1 (instead of 1 to factor) */
 	for (i=0; i < NUM_INPUT_PHASES; i++)
 		pPhases[i] = INPUT_PHASE(i)-1;
-
-	SET_PHASES (pPhases);
 }
 
 
@@ -194,6 +173,12 @@ static void mdlInitializeConditions(SimStruct *S)
  * block. The outputs are placed in the y variable.
  */
 
+/* Interleaves a full set of input phases */
+#define INTERLEAVE(factor)						\
+	for (i=0; i < n; i++)						\
+		for (j=0; j < (factor); j++)			\
+			y [(factor) * i + j] = *puPtrs [j][i]
+
 static void mdlOutputs(SimStruct *S, int_T tid)
 {
 	int_T				i, n, j, k, factor, numPhases;
@@ -213,14 +198,32 @@ static void mdlOutputs(SimStruct *S, int_T tid)
 	for (j=0; j < numPhases; j++)
 		puPtrs [j] = ssGetInputPortRealSignalPtrs (S, j);
 
-	holdValue = 0.0;
-	for (i=0; i < n; i++)
+	if (isFullPhaseSet (pPhases, numPhases, factor))
 	{
-		for (j=0, k=0; j < factor; j++)
+		/* Every output sample comes from an input, so nothing is
+		   held and the block simply interleaves its inputs.  Common
+		   factors get their own copies of the interleaving loop with
+		   a constant factor, so the compiler can unroll the inner
+		   loop and keep the output stores contiguous. */
+		switch (factor)
 		{
-			if (j == pPhases [k])
-				holdValue = *puPtrs [k++][i];
-			y [factor * i + j] = holdValue;
+			case 2:		INTERLEAVE (2);			break;
+			case 4:		INTERLEAVE (4);			break;
+			case 8:		INTERLEAVE (8);			break;
+			default:	INTERLEAVE (factor);	break;
+		}
+	}
+	else
+	{
+		holdValue = 0.0;
+		for (i=0; i < n; i++)
+		{
+			for (j=0, k=0; j < factor; j++)
+			{
+				if (j == pPhases [k])
+					holdValue = *puPtrs [k++][i];
+				y [factor * i + j] = holdValue;
+			}
 		}
 	}
 }
@@ -236,8 +239,7 @@ static void mdlOutputs(SimStruct *S, int_T tid)
  */
 static void mdlTerminate(SimStruct *S)
 {
-	free (GET_UPTRS);
-	free (GET_PHASES);
+	/* The work vectors are freed by Simulink */
 }
 
 # if defined(MATLAB_MEX_FILE)
@@ -320,6 +322,28 @@ static void mdlCheckParameters (SimStruct *S)
 
 
 
+/* Function: isFullPhaseSet ===================================================
+ * Abstract:
+ *
+ * Returns nonzero if and only if the specified (zero-based) phases are
+ * all of the phases from 0 to factor-1, in increasing order.
+ */
+static int_T isFullPhaseSet (int_T *pPhases, int_T numPhases, int_T factor)
+{
+	int_T		j;
+
+	if (numPhases != factor)
+		return 0;
+
+	for (j=0; j < numPhases; j++)
+		if (pPhases [j] != j)
+			return 0;
+
+	return 1;
+}
+
+
+
 /*=============================*
  * Required S-function trailer *
  *=============================*/
@@ -0,0 +1,5 @@
+/*
+ * Stand-in for the Simulink code generation registration header, which
+ * the S-functions include at their ends. The layout benchmark needs no
+ * registration, so this file is empty.
+ */
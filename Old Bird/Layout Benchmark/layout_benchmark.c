@@ -0,0 +1,288 @@
+/*
+ * layout_benchmark.c
+ *
+ * Standalone driver that runs a multichannel BufferedDSP S-function of
+ * `../Detector Source Code/C` with both of its multichannel layouts,
+ * checks that the column-major layout produces the same outputs as the
+ * row-major one, and times both.
+ *
+ * The S-function is compiled into the driver, using the stand-in
+ * `simstruc.h` of this directory in place of the Simulink one, e.g.:
+ *
+ *   cc -O2 -I. -DBLOCK_FILE='"../Detector Source Code/C/sdelay.c"' \
+ *       layout_benchmark.c -o sdelay_benchmark -lm
+ *
+ * The S-function must have `kNUM_CHANNELS` and `kCOL_MAJOR` parameters,
+ * like sdelay, sfifo, sfiniteintegrate, and splimflipflop. Usage:
+ *
+ *   <benchmark> numBuffers prob param ...
+ *
+ * where `numBuffers` is the number of buffers to time, `prob` is zero
+ * for noise input or else the probability of a one in binary input
+ * (e.g. for the set and reset inputs of splimflipflop), and the
+ * `param`s are the values of the block's parameters, in order. The
+ * value of the `col_major` parameter is ignored, since both layouts
+ * are run. For example:
+ *
+ *   sdelay_benchmark 10000 0 1024 300 8 0
+ *   sfifo_benchmark 10000 0 1024 2048 8 0
+ *   sfiniteintegrate_benchmark 10000 0 1024 0 500 1 8 0
+ *   splimflipflop_benchmark 10000 .01 1024 0 20 100 8 0
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include BLOCK_FILE
+
+
+#define NUM_CHECK_BUFFERS	64		/* Number of buffers compared				*/
+#define NUM_INPUT_BUFFERS	8		/* Number of distinct timed input buffers	*/
+
+
+static double		paramValues[MAX_PARAMS];
+static double		layoutParamValues[2][MAX_PARAMS];
+static mxArray		layoutParams[2][MAX_PARAMS];
+static int_T		numParams;
+static double		prob;
+static unsigned long	randomState = 1;
+
+
+/* Returns a pseudorandom number in [0, 1) */
+static double getRandom (void)
+{
+	randomState = randomState * 1103515245UL + 12345UL;
+	return ((randomState >> 16) & 0x7fff) / 32768.;
+}
+
+
+/* Returns the next input sample */
+static real_T getSample (void)
+{
+	double	r = getRandom ();
+
+	if (prob == 0)
+		return r - .5;
+	else
+		return r < prob ? 1 : 0;
+}
+
+
+/* Gets the index of a sample of a buffer of a layout */
+static long getIndex (int colMajor, long numChannels, long width,
+					  long channel, long i)
+{
+	long	numFrames = width / numChannels;
+
+	return colMajor ? i + numFrames * channel : channel + numChannels * i;
+}
+
+
+/* Initializes a block with a layout. The blocks of the two layouts have
+   separate parameters, since the S-functions read them as they run */
+static int initialize (SimStruct *S, int colMajor)
+{
+	double	*values = layoutParamValues[colMajor];
+	mxArray	*params = layoutParams[colMajor];
+	int_T	i;
+
+	memset (S, 0, sizeof (*S));
+
+	for (i = 0; i < numParams; i++)
+	{
+		values[i] = paramValues[i];
+		params[i].numElements = 1;
+		params[i].pr = &values[i];
+		S->params[i] = &params[i];
+	}
+	S->numParams = numParams;
+	values[kCOL_MAJOR] = colMajor;
+
+	mdlInitializeSizes (S);
+	if (ssGetErrorStatus (S) != NULL)
+	{
+		fprintf (stderr, "%s\n", ssGetErrorStatus (S));
+		return 0;
+	}
+
+	ssAllocate (S);
+
+#ifdef MDL_INITIALIZE_CONDITIONS
+	mdlInitializeConditions (S);
+#endif
+
+	return 1;
+}
+
+
+/* Processes one buffer */
+static void step (SimStruct *S)
+{
+	mdlOutputs (S, 0);
+#ifdef MDL_UPDATE
+	mdlUpdate (S, 0);
+#endif
+}
+
+
+/* Terminates a block */
+static void terminate (SimStruct *S)
+{
+	mdlTerminate (S);
+	ssFree (S);
+}
+
+
+/* Runs both layouts on the same inputs, and returns whether their
+   outputs are the same */
+static int check (void)
+{
+	SimStruct	row, col;
+	long		numChannels, b, channel, i, width;
+	int_T		p;
+	real_T		x;
+
+	if (!initialize (&row, 0) || !initialize (&col, 1))
+		return 0;
+
+	numChannels = (long) floor (0.5 + paramValues[kNUM_CHANNELS]);
+
+	for (b = 0; b < NUM_CHECK_BUFFERS; b++)
+	{
+		for (p = 0; p < row.numInputPorts; p++)
+		{
+			width = row.inputWidths[p];
+			for (channel = 0; channel < numChannels; channel++)
+			for (i = 0; i < width / numChannels; i++)
+			{
+				x = getSample ();
+				row.inputs[p][getIndex (0, numChannels, width, channel, i)] = x;
+				col.inputs[p][getIndex (1, numChannels, width, channel, i)] = x;
+			}
+		}
+
+		step (&row);
+		step (&col);
+
+		for (p = 0; p < row.numOutputPorts; p++)
+		{
+			width = row.outputWidths[p];
+			for (channel = 0; channel < numChannels; channel++)
+			for (i = 0; i < width / numChannels; i++)
+			{
+				if (row.outputs[p][getIndex (0, numChannels, width, channel, i)] !=
+					col.outputs[p][getIndex (1, numChannels, width, channel, i)])
+				{
+					printf ("Outputs differ at buffer %ld, port %d, "
+							"channel %ld, sample %ld.\n", b, p, channel, i);
+					return 0;
+				}
+			}
+		}
+	}
+
+	terminate (&row);
+	terminate (&col);
+
+	printf ("Outputs of %d buffers are identical.\n", NUM_CHECK_BUFFERS);
+
+	return 1;
+}
+
+
+/* Times one layout, and returns the time per input sample in
+   nanoseconds */
+static double timeLayout (int colMajor, long numBuffers)
+{
+	SimStruct		S;
+	const real_T	**ownPtrs[MAX_PORTS];
+	const real_T	**ptrs[NUM_INPUT_BUFFERS][MAX_PORTS];
+	real_T			*data[NUM_INPUT_BUFFERS][MAX_PORTS];
+	struct timespec	start, end;
+	long			b, i, k;
+	int_T			p;
+	double			seconds;
+
+	if (!initialize (&S, colMajor))
+		return -1;
+
+	/* Generate inputs ahead of time, so that only the block is timed */
+	for (k = 0; k < NUM_INPUT_BUFFERS; k++)
+	for (p = 0; p < S.numInputPorts; p++)
+	{
+		data[k][p] = malloc (S.inputWidths[p] * sizeof (real_T));
+		ptrs[k][p] = malloc (S.inputWidths[p] * sizeof (real_T*));
+		for (i = 0; i < S.inputWidths[p]; i++)
+		{
+			data[k][p][i] = getSample ();
+			ptrs[k][p][i] = &data[k][p][i];
+		}
+	}
+
+	for (p = 0; p < S.numInputPorts; p++)
+		ownPtrs[p] = S.inputPtrs[p];
+
+	clock_gettime (CLOCK_MONOTONIC, &start);
+
+	for (b = 0; b < numBuffers; b++)
+	{
+		for (p = 0; p < S.numInputPorts; p++)
+			S.inputPtrs[p] = ptrs[b % NUM_INPUT_BUFFERS][p];
+		step (&S);
+	}
+
+	clock_gettime (CLOCK_MONOTONIC, &end);
+
+	seconds = (end.tv_sec - start.tv_sec) +
+			  1e-9 * (end.tv_nsec - start.tv_nsec);
+
+	for (p = 0; p < S.numInputPorts; p++)
+		S.inputPtrs[p] = ownPtrs[p];
+
+	for (k = 0; k < NUM_INPUT_BUFFERS; k++)
+	for (p = 0; p < S.numInputPorts; p++)
+	{
+		free (data[k][p]);
+		free ((void*) ptrs[k][p]);
+	}
+
+	terminate (&S);
+
+	return 1e9 * seconds / numBuffers / S.inputWidths[0];
+}
+
+
+int main (int argc, char **argv)
+{
+	long	numBuffers;
+	double	row, col;
+	int_T	i;
+
+	if (argc != 3 + kNUM_PARAMETERS)
+	{
+		fprintf (stderr, "usage: %s numBuffers prob param ... "
+				 "(%d parameters)\n", argv[0], kNUM_PARAMETERS);
+		return 2;
+	}
+
+	numBuffers = atol (argv[1]);
+	prob = atof (argv[2]);
+	numParams = kNUM_PARAMETERS;
+	for (i = 0; i < numParams; i++)
+		paramValues[i] = atof (argv[3 + i]);
+
+	if (!check ())
+		return 1;
+
+	row = timeLayout (0, numBuffers);
+	col = timeLayout (1, numBuffers);
+	if (row < 0 || col < 0)
+		return 1;
+
+	printf ("Row major:    %.3f ns per sample\n", row);
+	printf ("Column major: %.3f ns per sample\n", col);
+	printf ("Column major / row major: %.2f\n", col / row);
+
+	return 0;
+}
@@ -0,0 +1,163 @@
+/*
+ * Minimal stand-in for the Simulink `simstruc.h` header, sufficient to
+ * compile the BufferedDSP S-functions of `../Detector Source Code/C`
+ * outside of Simulink for `layout_benchmark.c`.
+ *
+ * A `SimStruct` holds the parameters, ports, states, and work vectors
+ * of one block. The driver sets the parameters, calls the block's
+ * `mdlInitializeSizes`, and then calls `ssAllocate` to allocate the
+ * ports, states, and work vectors whose sizes the block declared.
+ */
+
+#ifndef SIMSTRUC_H
+#define SIMSTRUC_H
+
+#include <stdlib.h>
+#include <math.h>
+
+
+typedef double real_T;
+typedef int int_T;
+
+typedef const real_T *const *InputRealPtrsType;
+
+typedef struct {
+	size_t		numElements;
+	real_T		*pr;
+} mxArray;
+
+#define MAX_PARAMS	16
+#define MAX_PORTS	4
+
+typedef struct SimStruct_tag {
+
+	int_T			numParams;
+	const mxArray	*params[MAX_PARAMS];
+
+	int_T			numInputPorts;
+	int_T			inputWidths[MAX_PORTS];
+	real_T			*inputs[MAX_PORTS];
+	const real_T	**inputPtrs[MAX_PORTS];
+
+	int_T			numOutputPorts;
+	int_T			outputWidths[MAX_PORTS];
+	real_T			*outputs[MAX_PORTS];
+
+	int_T			numDiscStates;
+	real_T			*discStates;
+
+	int_T			numIWork;
+	int_T			*iWork;
+
+	int_T			numRWork;
+	real_T			*rWork;
+
+	int_T			numPWork;
+	void			**pWork;
+
+	const char		*errorStatus;
+
+} SimStruct;
+
+
+#define INHERITED_SAMPLE_TIME			(-1.0)
+#define FIXED_IN_MINOR_STEP_OFFSET		(0.0)
+#define SS_OPTION_EXCEPTION_FREE_CODE	1
+
+
+/* Parameters */
+#define mxGetPr(a)						((a)->pr)
+#define mxGetN(a)						((a)->numElements)
+#define mxGetNumberOfElements(a)		((a)->numElements)
+#define mxIsInf(x)						isinf(x)
+#define ssGetSFcnParam(S,i)				((S)->params[i])
+#define ssSetNumSFcnParams(S,n)			((void) 0)
+#define ssGetNumSFcnParams(S)			((S)->numParams)
+#define ssGetSFcnParamsCount(S)			((S)->numParams)
+
+/* Errors */
+#define ssGetErrorStatus(S)				((S)->errorStatus)
+#define ssSetErrorStatus(S,s)			((S)->errorStatus = (s))
+
+/* Ports */
+#define ssSetNumInputPorts(S,n)			((S)->numInputPorts = (n), 1)
+#define ssSetNumOutputPorts(S,n)		((S)->numOutputPorts = (n), 1)
+#define ssSetInputPortWidth(S,i,n)		((S)->inputWidths[i] = (n))
+#define ssSetOutputPortWidth(S,i,n)		((S)->outputWidths[i] = (n))
+#define ssGetInputPortWidth(S,i)		((S)->inputWidths[i])
+#define ssGetOutputPortWidth(S,i)		((S)->outputWidths[i])
+#define ssGetInputPortRealSignalPtrs(S,i) \
+	((InputRealPtrsType) (S)->inputPtrs[i])
+#define ssGetOutputPortSignal(S,i)		((S)->outputs[i])
+#define ssSetInputPortDirectFeedThrough(S,i,b)	((void) 0)
+#define ssSetInputPortOverWritable(S,i,b)		((void) 0)
+
+/* States and work vectors */
+#define ssSetNumContStates(S,n)			((void) 0)
+#define ssSetNumDiscStates(S,n)			((S)->numDiscStates = (n))
+#define ssGetRealDiscStates(S)			((S)->discStates)
+#define ssSetNumIWork(S,n)				((S)->numIWork = (n))
+#define ssGetIWork(S)					((S)->iWork)
+#define ssGetIWorkValue(S,i)			((S)->iWork[i])
+#define ssSetIWorkValue(S,i,x)			((S)->iWork[i] = (x))
+#define ssSetNumRWork(S,n)				((S)->numRWork = (n))
+#define ssGetRWork(S)					((S)->rWork)
+#define ssGetRWorkValue(S,i)			((S)->rWork[i])
+#define ssSetRWorkValue(S,i,x)			((S)->rWork[i] = (x))
+#define ssSetNumPWork(S,n)				((S)->numPWork = (n))
+#define ssGetPWork(S)					((S)->pWork)
+
+/* Sample times and options */
+#define ssSetNumModes(S,n)				((void) 0)
+#define ssSetNumNonsampledZCs(S,n)		((void) 0)
+#define ssSetNumSampleTimes(S,n)		((void) 0)
+#define ssSetSampleTime(S,i,t)			((void) 0)
+#define ssSetOffsetTime(S,i,t)			((void) 0)
+#define ssSetOptions(S,x)				((void) 0)
+
+
+/* Allocates the ports, states, and work vectors of a block after its
+   `mdlInitializeSizes` method has declared their sizes */
+static void ssAllocate (SimStruct *S)
+{
+	int_T	p, i;
+
+	for (p = 0; p < S->numInputPorts; p++)
+	{
+		S->inputs[p] = calloc (S->inputWidths[p], sizeof (real_T));
+		S->inputPtrs[p] = malloc (S->inputWidths[p] * sizeof (real_T*));
+		for (i = 0; i < S->inputWidths[p]; i++)
+			S->inputPtrs[p][i] = &S->inputs[p][i];
+	}
+
+	for (p = 0; p < S->numOutputPorts; p++)
+		S->outputs[p] = calloc (S->outputWidths[p], sizeof (real_T));
+
+	S->discStates = calloc (S->numDiscStates + 1, sizeof (real_T));
+	S->iWork = calloc (S->numIWork + 1, sizeof (int_T));
+	S->rWork = calloc (S->numRWork + 1, sizeof (real_T));
+	S->pWork = calloc (S->numPWork + 1, sizeof (void*));
+}
+
+
+/* Frees what `ssAllocate` allocated */
+static void ssFree (SimStruct *S)
+{
+	int_T	p;
+
+	for (p = 0; p < S->numInputPorts; p++)
+	{
+		free (S->inputs[p]);
+		free ((void*) S->inputPtrs[p]);
+	}
+
+	for (p = 0; p < S->numOutputPorts; p++)
+		free (S->outputs[p]);
+
+	free (S->discStates);
+	free (S->iWork);
+	free (S->rWork);
+	free (S->pWork);
+}
+
+#endif /* SIMSTRUC_H */
@@ -0,0 +1,231 @@
+"""
+Module containing class `Arena`, which allocates the arrays of a
+pipeline from a few large memory regions.
+
+A pipeline allocates all of its state, i.e. the states of its kernels
+and the buffers between them, from one arena, in execution order, so
+that the arrays a pipeline step touches in succession are adjacent in
+memory. Each array starts on a cache line boundary, so that no two
+arrays share a cache line.
+
+Arena regions are anonymous memory maps. They are zeroed when they are
+mapped, so arena arrays need no initialization, and an arena frees all
+of its arrays at once when it is closed. When many pipelines are
+created from the same model, each can be given an arena whose initial
+capacity is the size of the first pipeline's arena, so that all of its
+arrays are allocated from a single region.
+"""
+
+
+import mmap
+import weakref
+
+import numpy as np
+
+
+CACHE_LINE_SIZE = 64
+"""Default alignment of arena arrays, in bytes."""
+
+HUGE_PAGE_SIZE = 2 ** 21
+"""Size of a transparent huge page, in bytes."""
+
+_MIN_REGION_SIZE = 2 ** 20
+
+
+class Arena:
+
+    """
+    Memory arena.
+
+    An arena allocates zeroed NumPy arrays from a list of memory
+    regions. When an allocation does not fit in the current region a
+    new region is mapped that is at least twice as large as the arena's
+    total capacity. An arena with an initial `capacity` maps a region of
+    that size when it is created.
+
+    If `huge_pages` is true, region sizes are rounded up to a multiple
+    of the huge page size and the kernel is advised to back regions
+    with transparent huge pages, where the platform supports it.
+    """
+
+
+    def __init__(
+            self, capacity=0, alignment=CACHE_LINE_SIZE, huge_pages=False):
+
+        if alignment <= 0 or alignment & (alignment - 1) != 0:
+            raise ValueError(
+                'Arena alignment {} is not a power of two.'.format(alignment))
+
+        self._alignment = alignment
+        self._huge_pages = huge_pages
+        self._regions = []
+        self._region_sizes = []
+
+        # weak references to the buffers of the arrays allocated from
+        # this arena, which are alive while the arrays or any views of
+        # them are in use
+        self._buffers = []
+        self._capacity = 0
+        self._size = 0
+        self._offset = 0
+        self._closed = False
+
+        if capacity > 0:
+            self._add_region(capacity)
+
+
+    @property
+    def alignment(self):
+        return self._alignment
+
+
+    @property
+    def huge_pages(self):
+        return self._huge_pages
+
+
+    @property
+    def num_regions(self):
+        return len(self._regions)
+
+
+    @property
+    def capacity(self):
+
+        """Total size of the regions of this arena, in bytes."""
+
+        return self._capacity
+
+
+    @property
+    def size(self):
+
+        """
+        Size of a region that would hold all of the arrays allocated
+        from this arena, in bytes.
+        """
+
+        return self._size
+
+
+    @property
+    def closed(self):
+        return self._closed
+
+
+    @property
+    def region_sizes(self):
+
+        """
+        The numbers of bytes of the regions of this arena that are in
+        use, i.e. through the end of their last arrays.
+        """
+
+        return list(self._region_sizes)
+
+
+    def save(self, file):
+
+        """
+        Writes the bytes in use of the regions of this arena to a binary
+        file, e.g. to checkpoint the state of a pipeline.
+        """
+
+        for region, size in zip(self._regions, self._region_sizes):
+            with memoryview(region) as view, view[:size] as data:
+                file.write(data)
+
+
+    def load(self, file):
+
+        """
+        Reads the bytes in use of the regions of this arena from a
+        binary file written by the `save` method of an arena with the
+        same region sizes.
+        """
+
+        for region, size in zip(self._regions, self._region_sizes):
+            with memoryview(region) as view, view[:size] as data:
+                if file.readinto(data) != size:
+                    raise ValueError('Arena data are truncated.')
+
+
+    def allocate(self, shape, dtype='float64'):
+
+        """Allocates a zeroed array from this arena."""
+
+        if self._closed:
+            raise ValueError('Cannot allocate from a closed arena.')
+
+        dtype = np.dtype(dtype)
+        num_bytes = int(np.prod(shape, dtype='int64')) * dtype.itemsize
+
+        offset = _align(self._offset, self._alignment)
+
+        if len(self._regions) == 0 or \
+                offset + num_bytes > len(self._regions[-1]):
+            self._add_region(
+                max(num_bytes, 2 * self._capacity, _MIN_REGION_SIZE))
+            offset = 0
+
+        region = self._regions[-1]
+        buffer = memoryview(region)[offset:offset + num_bytes]
+        array = np.frombuffer(buffer, dtype)
+        self._buffers.append(weakref.ref(array.base))
+        array = array.reshape(shape)
+
+        self._offset = offset + num_bytes
+        self._region_sizes[-1] = self._offset
+        self._size = _align(self._size, self._alignment) + num_bytes
+
+        return array
+
+
+    def _add_region(self, size):
+
+        page_size = HUGE_PAGE_SIZE if self._huge_pages else mmap.PAGESIZE
+        size = _align(size, page_size)
+
+        region = mmap.mmap(-1, size)
+
+        if self._huge_pages and hasattr(mmap, 'MADV_HUGEPAGE'):
+            region.madvise(mmap.MADV_HUGEPAGE)
+
+        self._regions.append(region)
+        self._region_sizes.append(0)
+        self._capacity += size
+        self._offset = 0
+
+
+    def close(self):
+
+        """
+        Frees the regions of this arena.
+
+        All arrays allocated from the arena must be released before it
+        is closed. A `BufferError` is raised if any are still in use, in
+        which case the arena is left open.
+        """
+
+        # Check all of the arrays before closing any region, so that
+        # we do not close some regions and then fail on another.
+        if any(buffer() is not None for buffer in self._buffers):
+            raise BufferError(
+                'Cannot close arena while arrays allocated from it are '
+                'in use.')
+
+        self._buffers = []
+
+        while len(self._regions) != 0:
+            self._regions[-1].close()
+            self._regions.pop()
+            self._region_sizes.pop()
+
+        self._capacity = 0
+        self._size = 0
+        self._offset = 0
+        self._closed = True
+
+
+def _align(offset, alignment):
+    return (offset + alignment - 1) & ~(alignment - 1)
@@ -0,0 +1,553 @@
+"""
+Module containing classes `AudioBusWriter` and `AudioBusReader`, which
+share a stream of PCM audio between one recorder process and any number
+of detector processes.
+
+An audio bus is a ring of single-channel, 16-bit samples in a shared
+memory segment (on Linux, a file in `/dev/shm`). The writer publishes
+each sample once, and each reader attaches to the bus, claims a consumer
+slot, and reads with its own cursor. Readers get views of the ring
+rather than copies of it, so adding a detector adds no audio decoding
+and little memory traffic.
+
+The segment starts with a header of 64-bit integers:
+
+    0       magic number
+    1       layout version
+    2       ring capacity, in samples
+    3       number of consumer slots
+    4       write count, i.e. the number of samples written
+    5       closed flag
+    6       writer policy
+    7       sample rate, as a 64-bit float
+
+followed by the consumer slots, four integers each:
+
+    0       process ID of the consumer, or zero if the slot is free
+    1       read count, i.e. the consumer's cursor
+    2       number of samples the consumer lost because it lagged
+    3       reserved
+
+and then the ring, at a cache line boundary. The writer writes samples
+to the ring before it advances the write count, and a reader reads the
+write count before it reads samples, so a reader never sees samples
+that have not been written.
+
+A reader that falls more than the ring capacity behind the writer is
+*lagging*. What happens then depends on the writer's policy:
+
+* With the `OVERWRITE` policy, which is appropriate for live input, the
+  writer never waits. A lagging reader skips ahead to the oldest sample
+  still in the ring and counts the samples it missed.
+
+* With the `BLOCK` policy, which is appropriate for file input, the
+  writer waits for the slowest reader. Readers whose processes have
+  exited are detached, so that they cannot stall the bus.
+
+Since the writer may overwrite samples while a reader is still using
+views of them under the `OVERWRITE` policy, `AudioBusReader.advance`
+reports whether the samples a reader has just processed were intact.
+The `run_detector` function copies samples out of the ring under that
+policy, and counts samples that were overwritten before it copied them
+as lost.
+"""
+
+
+import mmap
+import os
+import time
+
+import numpy as np
+
+from multiprocessing import resource_tracker, shared_memory
+
+try:
+    import fcntl
+except ImportError:
+    fcntl = None
+
+
+OVERWRITE = 0
+BLOCK = 1
+
+_MAGIC = 0x4f6c644269726442
+_VERSION = 1
+
+_HEADER_SIZE = 8
+_SLOT_SIZE = 4
+_CACHE_LINE_SIZE = 64
+
+_MAGIC_INDEX = 0
+_VERSION_INDEX = 1
+_CAPACITY_INDEX = 2
+_NUM_SLOTS_INDEX = 3
+_WRITE_COUNT_INDEX = 4
+_CLOSED_INDEX = 5
+_POLICY_INDEX = 6
+_SAMPLE_RATE_INDEX = 7
+
+_PID_OFFSET = 0
+_READ_COUNT_OFFSET = 1
+_LOST_COUNT_OFFSET = 2
+
+_SAMPLE_DTYPE = np.dtype('<i2')
+
+_POLL_INTERVAL = .001
+"""the time a waiting writer or reader sleeps between polls, in seconds."""
+
+
+class _AudioBus:
+
+
+    def _map(self, name, memory, buffer):
+
+        self._name = name
+        self._memory = memory
+
+        num_slots = int(
+            np.ndarray(1, 'int64', buffer, _NUM_SLOTS_INDEX * 8)[0])
+        header_length = _HEADER_SIZE + num_slots * _SLOT_SIZE
+
+        self._header = np.ndarray(header_length, 'int64', buffer)
+        self._slots = self._header[_HEADER_SIZE:].reshape(
+            num_slots, _SLOT_SIZE)
+
+        ring_offset = _get_ring_offset(num_slots)
+        capacity = int(self._header[_CAPACITY_INDEX])
+        self._ring = np.ndarray(
+            capacity, _SAMPLE_DTYPE, buffer, ring_offset)
+
+
+    @property
+    def name(self):
+        return self._name
+
+
+    @property
+    def capacity(self):
+        return len(self._ring)
+
+
+    @property
+    def sample_rate(self):
+        return float(self._header[_SAMPLE_RATE_INDEX:].view('float64')[0])
+
+
+    @property
+    def policy(self):
+        return int(self._header[_POLICY_INDEX])
+
+
+    @property
+    def write_count(self):
+        return int(self._header[_WRITE_COUNT_INDEX])
+
+
+    @property
+    def closed(self):
+        return bool(self._header[_CLOSED_INDEX])
+
+
+    def _release(self):
+
+        # Drop our views of the segment before closing it.
+        self._header = None
+        self._slots = None
+        self._ring = None
+
+        self._memory.close()
+
+
+def _get_ring_offset(num_slots):
+    size = (_HEADER_SIZE + num_slots * _SLOT_SIZE) * 8
+    return -(-size // _CACHE_LINE_SIZE) * _CACHE_LINE_SIZE
+
+
+class AudioBusWriter(_AudioBus):
+
+    """
+    Audio bus writer.
+
+    The writer creates the bus, and unlinks it when it is closed.
+    """
+
+
+    def __init__(
+            self, name, capacity, sample_rate, policy=OVERWRITE,
+            num_slots=16):
+
+        size = _get_ring_offset(num_slots) + capacity * _SAMPLE_DTYPE.itemsize
+        memory = shared_memory.SharedMemory(name, create=True, size=size)
+
+        header = np.ndarray(_HEADER_SIZE, 'int64', memory.buf)
+        header[_VERSION_INDEX] = _VERSION
+        header[_CAPACITY_INDEX] = capacity
+        header[_NUM_SLOTS_INDEX] = num_slots
+        header[_POLICY_INDEX] = policy
+        header[_SAMPLE_RATE_INDEX:].view('float64')[0] = sample_rate
+
+        # Write the magic number last, so that a reader never sees a
+        # partially initialized header.
+        header[_MAGIC_INDEX] = _MAGIC
+        del header
+
+        self._map(name, memory, memory.buf)
+
+
+    def write(self, samples):
+
+        """
+        Writes samples to this bus.
+
+        With the `BLOCK` policy this method waits for room in the ring
+        as needed.
+        """
+
+        samples = np.asarray(samples, dtype=_SAMPLE_DTYPE)
+        capacity = self.capacity
+
+        while len(samples) != 0:
+
+            count = self.write_count
+
+            if self.policy == BLOCK:
+                n = min(len(samples), self._wait_for_room(count))
+            else:
+                n = min(len(samples), capacity)
+
+            chunk = samples[:n]
+            start = count % capacity
+            m = min(n, capacity - start)
+            self._ring[start:start + m] = chunk[:m]
+            self._ring[:n - m] = chunk[m:]
+
+            self._header[_WRITE_COUNT_INDEX] = count + n
+            samples = samples[n:]
+
+
+    def _wait_for_room(self, count):
+
+        while True:
+
+            read_count = self._get_min_read_count(count)
+            room = self.capacity - (count - read_count)
+
+            if room > 0:
+                return room
+
+            time.sleep(_POLL_INTERVAL)
+
+
+    def _get_min_read_count(self, count):
+
+        min_count = count
+
+        for slot in self._slots:
+
+            pid = int(slot[_PID_OFFSET])
+
+            if pid != 0:
+
+                if not _is_process_alive(pid):
+                    # Detach the consumer, since its process has exited.
+                    slot[_PID_OFFSET] = 0
+                    continue
+
+                min_count = min(min_count, int(slot[_READ_COUNT_OFFSET]))
+
+        return min_count
+
+
+    @property
+    def num_consumers(self):
+        return int(np.count_nonzero(self._slots[:, _PID_OFFSET]))
+
+
+    def get_consumer_lags(self):
+
+        """
+        Gets the lag of each attached consumer, in samples, as a
+        dictionary that maps consumer process IDs to lags.
+
+        A lag greater than the capacity of the bus means that the
+        consumer has lost samples.
+        """
+
+        count = self.write_count
+
+        return dict(
+            (int(slot[_PID_OFFSET]), count - int(slot[_READ_COUNT_OFFSET]))
+            for slot in self._slots if slot[_PID_OFFSET] != 0)
+
+
+    def close(self):
+
+        """Marks this bus as closed and unlinks it."""
+
+        self._header[_CLOSED_INDEX] = 1
+        self._release()
+        self._memory.unlink()
+
+
+def _is_process_alive(pid):
+    try:
+        os.kill(pid, 0)
+    except ProcessLookupError:
+        return False
+    except PermissionError:
+        pass
+    return True
+
+
+class AudioBusReader(_AudioBus):
+
+    """
+    Audio bus reader.
+
+    A reader starts reading at the next sample written to the bus,
+    unless `from_oldest` is true, in which case it starts at the oldest
+    sample still in the ring.
+    """
+
+
+    def __init__(self, name, from_oldest=False):
+
+        memory, buffer = _attach(name)
+
+        header = np.ndarray(_HEADER_SIZE, 'int64', buffer)
+        magic = int(header[_MAGIC_INDEX])
+        version = int(header[_VERSION_INDEX])
+        del header
+
+        if magic != _MAGIC or version != _VERSION:
+            memory.close()
+            raise ValueError(
+                'Shared memory segment "{}" is not a version {} audio '
+                'bus.'.format(name, _VERSION))
+
+        self._map(name, memory, buffer)
+        self._slot = self._claim_slot(from_oldest)
+        self._closed = False
+
+
+    def _claim_slot(self, from_oldest):
+
+        with _SlotLock(self.name):
+
+            for i, slot in enumerate(self._slots):
+
+                if slot[_PID_OFFSET] == 0:
+
+                    count = self.write_count
+                    if from_oldest:
+                        count = max(count - self.capacity, 0)
+
+                    slot[_READ_COUNT_OFFSET] = count
+                    slot[_LOST_COUNT_OFFSET] = 0
+                    slot[_PID_OFFSET] = os.getpid()
+
+                    return i
+
+        self._release()
+        raise ValueError('Audio bus "{}" has no free slots.'.format(self.name))
+
+
+    @property
+    def read_count(self):
+        return int(self._slots[self._slot, _READ_COUNT_OFFSET])
+
+
+    @property
+    def lost_count(self):
+
+        """The number of samples this reader lost because it lagged."""
+
+        return int(self._slots[self._slot, _LOST_COUNT_OFFSET])
+
+
+    @property
+    def available(self):
+        return self.write_count - self.read_count
+
+
+    def peek(self, max_size=None):
+
+        """
+        Gets views of the next unread samples of this bus, without
+        advancing this reader's cursor.
+
+        Returns the index of the first sample and a list of at most two
+        arrays, the second of which is present when the samples wrap
+        around the end of the ring. If this reader has lagged, it first
+        skips to the oldest sample still in the ring.
+        """
+
+        slot = self._slots[self._slot]
+        capacity = self.capacity
+        count = self.write_count
+        read_count = int(slot[_READ_COUNT_OFFSET])
+
+        if count - read_count > capacity:
+            slot[_LOST_COUNT_OFFSET] += count - capacity - read_count
+            read_count = count - capacity
+            slot[_READ_COUNT_OFFSET] = read_count
+
+        size = count - read_count
+        if max_size is not None:
+            size = min(size, max_size)
+
+        start = read_count % capacity
+        end = start + size
+
+        if end <= capacity:
+            views = [self._ring[start:end]]
+        else:
+            views = [self._ring[start:], self._ring[:end - capacity]]
+
+        return read_count, views
+
+
+    def advance(self, size):
+
+        """
+        Advances this reader's cursor past samples it has processed.
+
+        Returns `True` if and only if the samples were not overwritten
+        while they were processed, which can only happen with the
+        `OVERWRITE` policy.
+        """
+
+        read_count = self.read_count
+        intact = self.write_count <= read_count + self.capacity
+        self._slots[self._slot, _READ_COUNT_OFFSET] = read_count + size
+        return intact
+
+
+    def wait(self, timeout=None):
+
+        """
+        Waits until samples are available or the bus is closed.
+
+        Returns `True` if and only if samples are available.
+        """
+
+        deadline = None if timeout is None else time.monotonic() + timeout
+
+        while self.available == 0 and not self.closed:
+            if deadline is not None and time.monotonic() >= deadline:
+                break
+            time.sleep(_POLL_INTERVAL)
+
+        return self.available != 0
+
+
+    def close(self):
+
+        """Releases this reader's consumer slot and detaches from the bus."""
+
+        if not self._closed:
+            self._slots[self._slot, _PID_OFFSET] = 0
+            self._release()
+            self._closed = True
+
+
+def _attach(name):
+
+    """
+    Attaches to an existing shared memory segment, returning an object
+    whose `close` method detaches from it and a buffer of its contents.
+
+    Where the segment is a file in `/dev/shm` we map the file directly.
+    Attaching with `shared_memory.SharedMemory` would register the
+    segment with the resource tracker of this process, which would
+    unlink it when this process exits even though the writer owns it.
+    """
+
+    path = _get_segment_path(name)
+
+    if os.path.exists(path):
+        fd = os.open(path, os.O_RDWR)
+        try:
+            memory = mmap.mmap(fd, 0)
+        finally:
+            os.close(fd)
+        return memory, memory
+
+    else:
+        memory = shared_memory.SharedMemory(name)
+        resource_tracker.unregister(memory._name, 'shared_memory')
+        return memory, memory.buf
+
+
+def _get_segment_path(name):
+    return os.path.join('/dev/shm', name.lstrip('/'))
+
+
+class _SlotLock:
+
+    """
+    Lock that serializes the claiming of consumer slots by readers in
+    different processes, where the platform supports file locks.
+    """
+
+
+    def __init__(self, name):
+        path = _get_segment_path(name)
+        self._fd = os.open(path, os.O_RDONLY) \
+            if fcntl is not None and os.path.exists(path) else None
+
+
+    def __enter__(self):
+        if self._fd is not None:
+            fcntl.flock(self._fd, fcntl.LOCK_EX)
+        return self
+
+
+    def __exit__(self, *args):
+        if self._fd is not None:
+            fcntl.flock(self._fd, fcntl.LOCK_UN)
+            os.close(self._fd)
+
+
+def run_detector(reader, detector, block_size=8192):
+
+    """
+    Runs a detector on the samples of an audio bus until the bus is
+    closed and the reader has read all of its samples.
+
+    The detector is a redux detector. With the `BLOCK` policy its
+    `detect` method is called with views of the bus ring. With the
+    `OVERWRITE` policy, under which the writer may overwrite samples
+    while the detector is using them, it is called with copies of the
+    samples instead, made before the reader advances its cursor.
+
+    Returns the number of samples lost, i.e. the number of samples the
+    reader skipped because it lagged plus the number of samples it
+    passed to the detector that the writer overwrote before the reader
+    was done with them.
+    """
+
+    copy = reader.policy == OVERWRITE
+    damaged_count = 0
+
+    while reader.wait():
+
+        _, views = reader.peek(block_size)
+        size = sum(len(v) for v in views)
+
+        if copy:
+            views = [v.copy() for v in views]
+            intact = reader.advance(size)
+
+        for samples in views:
+            detector.detect(samples)
+
+        if not copy:
+            intact = reader.advance(size)
+
+        if not intact:
+            damaged_count += size
+
+    detector.complete_detection()
+
+    return reader.lost_count + damaged_count
@@ -0,0 +1,365 @@
+"""
+Module containing versions of the redux Old Bird detectors that find
+threshold crossings at a reduced sample rate.
+
+The redux detectors filter, square, integrate, and divide at the full
+input sample rate, although the band of interest (6 to 10 kHz for the
+Tseep detector) is only a few kilohertz wide. The detectors of this
+module instead compute an approximation of the detector's ratio signal
+at a sample rate reduced by a decimation factor `D`, as follows:
+
+1. The input is filtered with a complex bandpass filter, namely a
+   lowpass prototype with half the detector's bandwidth modulated up
+   to the center of the detector's band. Only every `D`th output of the
+   filter is computed, by splitting the input into `D` phases as the
+   BufferedDSP distributor block does (see `sdistributor.c` in the `Old
+   Bird` directory) and filtering each phase with the corresponding
+   phase of the filter.
+
+2. The squared magnitude `|z|^2 / 2` of each filter output `z` takes the
+   place of the square of the output of the real bandpass filter. It is
+   the energy of the band shifted to baseband: shifting multiplies `z`
+   by a factor of unit magnitude, so we needn't actually perform the
+   shift. The squared magnitude has bandwidth no more than that of the
+   filter passband, so it can be sampled at the reduced rate.
+
+3. The energy is integrated and divided at the reduced rate.
+
+The approximate ratio is then used only to find *candidate* threshold
+crossings, i.e. places where the approximate ratio comes within a
+margin of the threshold. The exact ratio is computed at the full rate
+only near candidate crossings, and the threshold crossings are found in
+it exactly as in a redux detector. Since the exact ratio is usually far
+from the threshold, most of the input is processed only at the reduced
+rate.
+
+The detectors of this module are *approximate*. The complex filter is
+designed separately from the real bandpass filter of a redux detector,
+so their responses differ, especially in the transition bands, and
+the reduced-rate integration and interpolated delay add further error.
+There is no proven bound on the difference between the approximate and
+exact ratios, so the margin is a heuristic, and a crossing of the
+exact ratio at which the approximate ratio stays outside the margin is
+missed. Clips that are detected are sample-accurate, i.e. identical to
+the corresponding redux detector clips, but for some inputs, e.g. weak
+tones near the band edges, a few redux detector clips are missed or
+detected differently. Use the redux detectors where the same clips are
+required. For this reason the detectors of this module are experimental,
+and are not among the detectors of the `test_detector.py` script.
+"""
+
+
+import math
+
+import numpy as np
+
+from old_bird_detector_redux_1_1 import (
+    _Detector, _firls, _THRUSH_SETTINGS, _TSEEP_SETTINGS)
+
+
+_RATIO_MARGIN = .25
+"""
+the relative margin around thresholds within which the approximate
+ratio indicates a candidate threshold crossing.
+
+The margin is chosen empirically rather than derived from a bound on
+the error of the approximate ratio, so candidates can be missed.
+Larger margins miss fewer crossings at the cost of computing more
+exact ratios.
+"""
+
+_BANDWIDTH_FACTOR = 1.1
+"""
+the minimum ratio of the reduced sample rate to the width of the filter
+passband (including transition bands).
+"""
+
+
+class _BasebandDetector(_Detector):
+
+    """
+    Redux detector that finds candidate threshold crossings at a reduced
+    sample rate.
+
+    This class has the same interface as the `_Detector` class, and
+    detects approximately the same clips (see the module docstring).
+    """
+
+
+    def __init__(self, settings, sample_rate, listener):
+
+        super().__init__(settings, sample_rate, listener)
+
+        s = self.settings
+
+        band_width = s.filter_f1 - s.filter_f0 + 2 * s.filter_bw
+        self._decimation_factor = max(
+            int(sample_rate // (_BANDWIDTH_FACTOR * band_width)), 1)
+
+        self._phase_filters = self._design_phase_filters()
+
+        D = self._decimation_factor
+
+        integration_length = int(round(s.integration_time * sample_rate))
+        self._reduced_integration_length = \
+            max(int(round(integration_length / D)), 1)
+
+        # See `_Detector._create_signal_processor` regarding `math.floor`.
+        delay = math.floor(s.ratio_delay * sample_rate)
+        self._reduced_delay = delay / D
+
+
+    def _design_phase_filters(self):
+
+        s = self.settings
+        fs = self.sample_rate
+        D = self._decimation_factor
+
+        # Design lowpass prototype of the same length and with the same
+        # transition band width as the real bandpass filter. `_firls`
+        # designs even-length filters with a stopband, a passband, and
+        # a stopband, so we give it an empty first stopband.
+        filter_length = int(round(s.filter_duration * fs))
+        half_width = (s.filter_f1 - s.filter_f0) / 2
+        fs2 = fs / 2
+        bands = np.array(
+            [0, 0, 0, half_width, half_width + s.filter_bw, fs2]) / fs2
+        desired = np.array([0, 0, 1, 1, 0, 0])
+        prototype = _firls(filter_length, bands, desired)
+
+        # Modulate prototype to center of band.
+        f = (s.filter_f0 + s.filter_f1) / 2
+        k = np.arange(filter_length) - (filter_length - 1) / 2
+        coefficients = 2 * prototype * np.exp(2j * np.pi * f * k / fs)
+
+        # Pad filter at front to multiple of decimation factor length
+        # and reverse so that phase filters can be correlated with input
+        # phases.
+        padded_length = int(math.ceil(filter_length / D)) * D
+        padding = np.zeros(padded_length - filter_length, dtype='complex')
+        coefficients = np.concatenate((padding, coefficients))[::-1]
+
+        # Split into phases, one per row.
+        return coefficients.reshape(-1, D).T
+
+
+    @property
+    def decimation_factor(self):
+        return self._decimation_factor
+
+
+    def detect(self, samples):
+
+        augmented_samples = np.concatenate((self._recent_samples, samples))
+
+        latency = self._signal_processor.latency
+
+        if len(augmented_samples) <= latency:
+            # don't yet have enough samples to fill processing pipeline
+
+            self._recent_samples = augmented_samples
+
+        else:
+            # have enough samples to fill processing pipeline
+
+            # Get transient index offset. See `_Detector.detect`.
+            offset = self._num_samples_processed
+            if not self._initial_samples_repeated:
+                offset += latency
+                self._initial_samples_repeated = True
+            offset += 1
+
+            crossings = self._find_threshold_crossings(
+                augmented_samples, offset)
+
+            clips = self._series_processor.process(crossings)
+
+            self._notify_listener(clips)
+
+            # Save trailing samples for next call to this method.
+            self._recent_samples = augmented_samples[-latency:]
+
+        self._num_samples_processed += len(samples)
+
+
+    def _find_threshold_crossings(self, x, offset):
+
+        """
+        Finds the threshold crossings of the ratio signal of the
+        specified samples.
+
+        The crossings are those found by `_get_threshold_crossings` for
+        the full-rate ratio signal computed by
+        `_Detector._signal_processor` in the candidate intervals, which
+        usually, but not always, include all of its crossings.
+        """
+
+        latency = self._signal_processor.latency
+        num_ratios = len(x) - latency - 1
+
+        intervals = self._find_candidate_intervals(x, num_ratios)
+
+        crossings = []
+
+        for start, end in intervals:
+
+            # Compute exact ratios `[start, end]` and find crossings
+            # between them.
+            window = np.array(x[start:end + 2 + latency], dtype='float')
+            ratios = self._signal_processor.process(window)
+            crossings += self._get_threshold_crossings(ratios, offset + start)
+
+        return crossings
+
+
+    def _find_candidate_intervals(self, x, num_ratios):
+
+        """
+        Finds intervals of the full-rate ratio signal that may contain
+        threshold crossings.
+
+        Returns a list of disjoint `(start, end)` pairs of ratio indices,
+        sorted by start index. The threshold crossings between ratios
+        `i` and `i + 1` for `start <= i < end` are to be checked.
+        """
+
+        D = self._decimation_factor
+        latency = self._signal_processor.latency
+
+        ratios = self._compute_reduced_rate_ratios(x)
+
+        # `ratios[m]` approximates full-rate ratio `m * D`. Flag each
+        # reduced-rate ratio pair whose range comes within the margin
+        # of either threshold.
+        r0 = ratios[:-1]
+        r1 = ratios[1:]
+        low = np.minimum(r0, r1)
+        high = np.maximum(r0, r1)
+        flags = np.zeros(len(r0), dtype='bool')
+        t = self.settings.ratio_threshold
+        for threshold in (t, 1 / t):
+            flags |= \
+                (high > threshold / (1 + _RATIO_MARGIN)) & \
+                (low <= threshold * (1 + _RATIO_MARGIN))
+
+        # Convert flagged reduced-rate pairs to full-rate intervals,
+        # padded by one reduced-rate sample period on each side.
+        m = np.nonzero(flags)[0]
+        starts = np.maximum((m - 1) * D, 0)
+        ends = np.minimum((m + 2) * D, num_ratios - 1)
+
+        # Check all pairs beyond the end of the reduced-rate ratios.
+        covered_end = len(r0) * D
+        if covered_end < num_ratios - 1:
+            starts = np.append(starts, max(covered_end - D, 0))
+            ends = np.append(ends, num_ratios - 1)
+
+        return _merge_intervals(starts, ends, latency)
+
+
+    def _compute_reduced_rate_ratios(self, x):
+
+        D = self._decimation_factor
+        phase_filters = self._phase_filters
+        filter_length = phase_filters.shape[1] * D
+
+        # Compute every `D`th valid output of complex bandpass filter,
+        # starting with the first, phase by phase. Output `m` is
+        # aligned with full-rate filter output `m * D`. The phase
+        # filters are short, so we convolve directly rather than with
+        # FFTs.
+        num_outputs = (len(x) - filter_length) // D + 1
+        if num_outputs <= 0:
+            return np.zeros(0)
+        x = np.asarray(x, dtype='float')
+        z = np.zeros(num_outputs, dtype='complex')
+        for p in range(D):
+            phase = x[p::D]
+            h = phase_filters[p, ::-1]
+            z += np.convolve(phase, h, mode='valid')[:num_outputs]
+
+        energy = (z.real * z.real + z.imag * z.imag) / 2
+
+        # Integrate. We use a cumulative sum here since the reduced-rate
+        # ratios need only be approximate.
+        n = self._reduced_integration_length
+        if len(energy) < n:
+            return np.zeros(0)
+        sums = np.concatenate(([0], np.cumsum(energy)))
+        integrals = (sums[n:] - sums[:-n]) / n
+        integrals[integrals <= 0] = 1e-20
+
+        # Divide, interpolating delayed integrals linearly.
+        d = self._reduced_delay
+        num_ratios = len(integrals) - int(math.ceil(d))
+        if num_ratios <= 0:
+            return np.zeros(0)
+        i = np.arange(num_ratios)
+        delayed = np.interp(i + d, np.arange(len(integrals)), integrals)
+
+        return delayed / integrals[:num_ratios]
+
+
+def _merge_intervals(starts, ends, min_gap):
+
+    """
+    Merges intervals that overlap or are separated by less than
+    `min_gap`.
+
+    Merging nearby intervals saves computation, since computing exact
+    ratios for an interval requires samples preceding it.
+    """
+
+    intervals = []
+
+    for start, end in sorted(zip(starts.tolist(), ends.tolist())):
+        if len(intervals) != 0 and start < intervals[-1][1] + min_gap:
+            intervals[-1][1] = max(intervals[-1][1], end)
+        else:
+            intervals.append([start, end])
+
+    return [tuple(i) for i in intervals if i[1] > i[0]]
+
+
+class BasebandTseepDetector(_BasebandDetector):
+
+
+    def __init__(self, sample_rate, listener):
+        super().__init__(_TSEEP_SETTINGS, sample_rate, listener)
+
+
+class BasebandThrushDetector(_BasebandDetector):
+
+
+    def __init__(self, sample_rate, listener):
+        super().__init__(_THRUSH_SETTINGS, sample_rate, listener)
+
+
+def detect(samples, settings):
+
+    """
+    Runs a baseband Old Bird detector reimplementation on the specified
+    samples.
+    """
+
+    listener = _Listener()
+
+    if settings.detector_name == 'Thrush':
+        cls = BasebandThrushDetector
+    else:
+        cls = BasebandTseepDetector
+
+    detector = cls(settings.sample_rate, listener)
+    detector.detect(samples)
+    detector.complete_detection()
+
+    return listener.clips
+
+
+class _Listener:
+
+    def __init__(self):
+        self.clips = []
+
+    def process_clip(self, start_index, length):
+        self.clips.append((start_index, length))
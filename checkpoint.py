@@ -0,0 +1,271 @@
+"""
+Module containing functions that checkpoint the state of a pipeline
+(see the `pipeline` module) to a file and restore it, and class
+`Checkpointer`, which checkpoints a pipeline periodically.
+
+All of the mutable state of a pipeline's kernels, e.g. the histories of
+its Delay, FIFO, and Integrate kernels, the indices and counts of its
+Pulse Limited Flip Flop and Counter kernels, and the buffer counts of
+its Clip & Save kernels, is in arrays allocated from the pipeline's
+arena (see the `arena` module), as are the buffers between the kernels.
+A checkpoint is thus the bytes in use of the arena plus the few values
+the pipeline keeps outside of it: the number of samples the pipeline
+has processed and the input samples it holds until they fill a buffer.
+The number of samples the pipeline has received, i.e. the position in
+the input at which to resume, is the sum of those, and is available
+after a restore as the pipeline's `num_samples_received` property.
+Restoring a checkpoint into a newly compiled pipeline of the same model
+is a few large reads, and the restored pipeline continues exactly as
+the checkpointed one would have, so a run that is resumed from a
+checkpoint produces the same output as one that was not interrupted.
+
+A checkpoint also holds caller metadata, e.g. the number of clips saved
+so far. Output that a pipeline reports after a checkpoint is reported
+again when a run resumes from that checkpoint, so a caller should
+discard such output first, for example according to the number of clips
+in the metadata.
+
+A checkpoint file starts with a header of 64-bit integers:
+
+    0       magic number
+    1       format version
+    2       pipeline fingerprint
+    3       number of samples processed
+    4       number of pending input samples
+    5       number of input channels
+    6       metadata length
+    7       number of arena regions
+    8       number of samples received
+
+followed by the arena region sizes (64-bit integers), the metadata
+(JSON, padded to a multiple of eight bytes), the pending input samples
+(64-bit floats), and the arena data. The fingerprint is a checksum of
+the schedule of the pipeline's kernels and of their evaluated block
+parameters, so that a checkpoint is not restored into a pipeline of
+another model, or of the same model with other parameter values.
+
+Checkpoints are written to a temporary file that is renamed to the
+checkpoint file name when it is complete, so that a run that dies while
+writing a checkpoint leaves the previous checkpoint intact.
+"""
+
+
+import json
+import os
+import zlib
+
+import numpy as np
+
+
+_MAGIC = 0x4f6c644368656b70
+_VERSION = 2
+
+_HEADER_SIZE = 9
+
+_MAGIC_INDEX = 0
+_VERSION_INDEX = 1
+_FINGERPRINT_INDEX = 2
+_NUM_SAMPLES_PROCESSED_INDEX = 3
+_NUM_PENDING_SAMPLES_INDEX = 4
+_NUM_CHANNELS_INDEX = 5
+_METADATA_LENGTH_INDEX = 6
+_NUM_REGIONS_INDEX = 7
+_NUM_SAMPLES_RECEIVED_INDEX = 8
+
+
+def save_checkpoint(pipeline, file_path, metadata=None):
+
+    """
+    Saves the state of a pipeline to a checkpoint file.
+
+    `metadata` is an optional JSON-serializable value that is saved with
+    the checkpoint.
+    """
+
+    arena = pipeline.arena
+    region_sizes = arena.region_sizes
+    pending = np.ascontiguousarray(pipeline._pending, dtype='<f8')
+
+    metadata = json.dumps(metadata).encode('utf-8')
+    metadata += b' ' * (-len(metadata) % 8)
+
+    header = np.zeros(_HEADER_SIZE, dtype='<i8')
+    header[_MAGIC_INDEX] = _MAGIC
+    header[_VERSION_INDEX] = _VERSION
+    header[_FINGERPRINT_INDEX] = _get_fingerprint(pipeline)
+    header[_NUM_SAMPLES_PROCESSED_INDEX] = pipeline.num_samples_processed
+    header[_NUM_PENDING_SAMPLES_INDEX] = pending.shape[0]
+    header[_NUM_CHANNELS_INDEX] = pipeline.num_channels
+    header[_METADATA_LENGTH_INDEX] = len(metadata)
+    header[_NUM_REGIONS_INDEX] = len(region_sizes)
+    header[_NUM_SAMPLES_RECEIVED_INDEX] = pipeline.num_samples_received
+
+    temp_file_path = file_path + '.partial'
+
+    with open(temp_file_path, 'wb') as f:
+        f.write(header.tobytes())
+        f.write(np.array(region_sizes, dtype='<i8').tobytes())
+        f.write(metadata)
+        f.write(pending.tobytes())
+        arena.save(f)
+        f.flush()
+        os.fsync(f.fileno())
+
+    os.replace(temp_file_path, file_path)
+
+
+def restore_checkpoint(pipeline, file_path):
+
+    """
+    Restores the state of a pipeline from a checkpoint file.
+
+    The pipeline must be compiled from the same model as the pipeline
+    whose state was saved, and must not have processed any samples.
+    Returns the metadata of the checkpoint. After the restore, the
+    `num_samples_received` property of the pipeline is the position in
+    the input at which to resume.
+    """
+
+    if pipeline.num_samples_processed != 0:
+        raise ValueError(
+            'Cannot restore checkpoint into a pipeline that has '
+            'processed samples.')
+
+    with open(file_path, 'rb') as f:
+
+        header = _read_array(f, '<i8', _HEADER_SIZE)
+
+        if header[_MAGIC_INDEX] != _MAGIC or \
+                header[_VERSION_INDEX] != _VERSION:
+            raise ValueError(
+                'File "{}" is not a version {} pipeline checkpoint.'.format(
+                    file_path, _VERSION))
+
+        num_regions = int(header[_NUM_REGIONS_INDEX])
+        region_sizes = _read_array(f, '<i8', num_regions).tolist()
+
+        if header[_FINGERPRINT_INDEX] != _get_fingerprint(pipeline) or \
+                region_sizes != pipeline.arena.region_sizes or \
+                header[_NUM_CHANNELS_INDEX] != pipeline.num_channels:
+            raise ValueError(
+                'Checkpoint "{}" is not of a pipeline of model "{}".'.format(
+                    file_path, pipeline.graph.name))
+
+        length = int(header[_METADATA_LENGTH_INDEX])
+        metadata = json.loads(f.read(length).decode('utf-8'))
+
+        num_pending = int(header[_NUM_PENDING_SAMPLES_INDEX])
+        pending = _read_array(f, '<f8', num_pending * pipeline.num_channels)
+
+        pipeline.arena.load(f)
+
+    num_processed = int(header[_NUM_SAMPLES_PROCESSED_INDEX])
+
+    if header[_NUM_SAMPLES_RECEIVED_INDEX] != num_processed + num_pending:
+        raise ValueError(
+            'Checkpoint "{}" has inconsistent sample counts.'.format(
+                file_path))
+
+    pipeline._pending = pending.reshape(num_pending, pipeline.num_channels)
+    pipeline._num_samples_processed = num_processed
+
+    return metadata
+
+
+def _read_array(file, dtype, count):
+
+    array = np.empty(count, dtype)
+
+    if file.readinto(memoryview(array).cast('B')) != array.nbytes:
+        raise ValueError('Checkpoint is truncated.')
+
+    return array
+
+
+def _get_fingerprint(pipeline):
+
+    schedule = '\n'.join(
+        '{} {} {}'.format(
+            path, kernel.block.type, _get_param_values(kernel.block))
+        for path, kernel in pipeline.kernels.items())
+
+    text = '{}\n{}\n{}'.format(
+        pipeline.graph.name, pipeline.buffer_size, schedule)
+
+    return zlib.crc32(text.encode('utf-8'))
+
+
+def _get_param_values(block):
+
+    """
+    Gets the evaluated parameter values of a block as a string.
+
+    Parameters that cannot be evaluated contribute their expressions.
+    """
+
+    values = []
+
+    for name, expression in sorted(block.params.items()):
+
+        try:
+            value = block.evaluate(name)
+        except ValueError:
+            value = expression
+
+        if isinstance(value, np.ndarray):
+            value = value.tolist()
+
+        values.append('{}={!r}'.format(name, value))
+
+    return ' '.join(values)
+
+
+class Checkpointer:
+
+    """
+    Processes samples with a pipeline, saving a checkpoint every
+    `interval` samples.
+
+    Checkpoints are saved when the number of samples the pipeline has
+    received reaches a multiple of `interval`, so a checkpointer of a
+    pipeline restored from a checkpoint continues on the same schedule.
+
+    `get_metadata` is an optional function of no arguments that returns
+    the metadata of each checkpoint.
+    """
+
+
+    def __init__(self, pipeline, file_path, interval, get_metadata=None):
+        self._pipeline = pipeline
+        self._file_path = file_path
+        self._interval = interval
+        self._get_metadata = get_metadata
+        num_samples = pipeline.num_samples_received
+        self._next_checkpoint = (num_samples // interval + 1) * interval
+
+
+    @property
+    def pipeline(self):
+        return self._pipeline
+
+
+    @property
+    def file_path(self):
+        return self._file_path
+
+
+    def process(self, samples):
+
+        self._pipeline.process(samples)
+        num_samples = self._pipeline.num_samples_received
+
+        if num_samples >= self._next_checkpoint:
+            self.save()
+            while self._next_checkpoint <= num_samples:
+                self._next_checkpoint += self._interval
+
+
+    def save(self):
+        metadata = \
+            self._get_metadata() if self._get_metadata is not None else None
+        save_checkpoint(self._pipeline, self._file_path, metadata)
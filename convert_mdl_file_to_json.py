@@ -20,7 +20,7 @@ TOKEN_CLOSE_BRACE = '}'
 STATE_KEY = 'key'
 STATE_VALUE = 'value'
 
-LIST_KEYS = {'Annotation', 'Block', 'Line'}
+LIST_KEYS = {'Annotation', 'Block', 'Branch', 'Line'}
 """
 Keys that can occur multiple times in a single mapping in an .mdl file.
 Items with such keys are placed into lists in the JSON generated by
@@ -32,6 +32,7 @@ FILTERS = {
     'Block': {
         'BlockType', 'MaskDescription', 'MaskPromptString', 'MaskVariables',
         'MaskValueString', 'Name', 'Ports', 'SourceBlock'},
+    'Branch': {'DstBlock', 'DstPort'},
     'Line': {'DstBlock', 'DstPort', 'SrcBlock', 'SrcPort'},
     'Model': {'Name'},
     'System': {'Name'},
@@ -0,0 +1,840 @@
+"""
+Script that runs redux detectors on many concurrent PCM streams.
+
+Usage:
+
+    python detector_server.py <socket path> <clip directory> [--workers N]
+
+The server listens for connections on a Unix domain socket. Each
+connection carries one stream, e.g. from one recording station. A
+client first sends a one-line ASCII header of the form
+
+    <detector names> <sample rate> <station name>
+
+where `<detector names>` is "Tseep", "Thrush", or a comma-separated
+list of them such as "Tseep,Thrush", and the station name is the rest
+of the line, followed by single-channel, 16-bit, little-endian PCM.
+When the stream ends the client shuts down the writing side of its
+connection, and the server completes detection for the stream and
+replies with a line containing the number of clips detected, or with
+an error line starting with "error:" if some of the clips could not be
+written. The server writes each clip to a WAV file named
+`<station name>/<detector name>_<stream start time>_<start index>.wav`
+in the clip directory, where the stream start time is the UTC time at
+which the server read the stream's header and the start index is the
+index of the clip's first sample in the stream. Start times are unique,
+so a station that reconnects does not overwrite its earlier clips. A
+station name must be a single relative path component, i.e. it cannot
+be absolute or contain a path separator or "..".
+
+Each stream has its own detector, a multi-detector (see the
+`multi_detector` module) that runs all of the stream's named detectors
+in one pass over its samples and one sample history. All streams share
+one pool of worker threads. A single I/O thread reads from all
+connections with a selector, and hands samples to a stream's detector a
+block at a time.
+A stream can have about `_MAX_PENDING_BLOCKS` blocks awaiting
+processing. When it reaches that limit the I/O thread stops reading
+from its connection until the stream's worker has caught up, so that
+the server's memory use is bounded when detection falls behind its
+input. The stream's client then blocks in its sends.
+A stream with samples to process is a task for the pool. Each worker
+has its own task deque, and an idle worker steals tasks from the deques
+of the others, so that the load of the streams spreads across the pool.
+Idle workers sleep on an eventfd (a pipe where eventfds are not
+available) until there is work, rather than spinning. At most one
+worker processes a stream at a time, so the samples of a stream are
+processed in order. Workers pass clips to a single clip writer thread,
+so that file I/O does not hold up detection. The writer reports a clip
+it cannot write, e.g. because the disk is full, on standard error and
+continues with the next clip.
+"""
+
+
+import argparse
+import collections
+import datetime
+import os
+import queue
+import selectors
+import socket
+import sys
+import threading
+
+import numpy as np
+
+from multi_detector import DETECTOR_SETTINGS, create_detector
+from sound_file_utils import write_sound_file
+
+
+_SAMPLE_DTYPE = np.dtype('<i2')
+
+_BLOCK_SIZE = 8192
+"""the number of samples of a stream the server processes at once."""
+
+_HISTORY_DURATION = 60
+"""
+the duration in seconds of the samples retained for each stream for
+clip extraction.
+
+The detectors report a clip only after it ends, and sometimes well
+after. A clip that starts before the retained samples is truncated.
+"""
+
+_MAX_PENDING_BLOCKS = 32
+"""
+the number of blocks of a stream awaiting processing at which the
+server stops reading from the stream's connection.
+
+The server resumes reading when the stream's worker has processed half
+of the blocks. Since the server reads up to `_READ_SIZE` bytes at a
+time, a stream can have a few more blocks than this.
+"""
+
+_READ_SIZE = 65536
+"""the maximum number of bytes read from a connection at once."""
+
+_MAX_HEADER_SIZE = 1024
+
+_START_TIME_FORMAT = '%Y-%m-%d_%H.%M.%S.%f'
+"""the format of stream start times in clip file names."""
+
+
+def main():
+
+    args = _parse_args()
+
+    server = DetectorServer(args.socket_path, args.clip_dir, args.workers)
+
+    try:
+        server.serve_forever()
+    except KeyboardInterrupt:
+        pass
+    finally:
+        server.close()
+
+
+def _parse_args():
+
+    parser = argparse.ArgumentParser(
+        description='Runs redux detectors on concurrent PCM streams.')
+    parser.add_argument('socket_path')
+    parser.add_argument('clip_dir')
+    parser.add_argument(
+        '--workers', type=int, default=os.cpu_count(),
+        help='number of detection worker threads')
+
+    return parser.parse_args()
+
+
+class DetectorServer:
+
+    """
+    Detector server.
+
+    `serve_forever` runs the server's I/O loop on the calling thread
+    until another thread calls `shutdown`. `close` then releases the
+    server's resources, after all queued work is complete.
+    """
+
+
+    def __init__(self, socket_path, clip_dir, num_workers=None):
+
+        if num_workers is None:
+            num_workers = os.cpu_count()
+
+        self._clip_dir = clip_dir
+        self._pool = _WorkStealingPool(num_workers)
+        self._writer = _ClipWriter()
+
+        if os.path.exists(socket_path):
+            os.remove(socket_path)
+
+        self._socket_path = socket_path
+        self._socket = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+        self._socket.bind(socket_path)
+        self._socket.listen()
+        self._socket.setblocking(False)
+
+        self._selector = selectors.DefaultSelector()
+        self._selector.register(self._socket, selectors.EVENT_READ)
+
+        self._wakeup = _Wakeup()
+        self._selector.register(self._wakeup.fileno(), selectors.EVENT_READ)
+
+        # Streams whose connections are not being read because they
+        # have too many pending blocks, and paused streams whose
+        # workers have caught up. Workers append to the deque, and the
+        # I/O thread pops from it.
+        self._paused_streams = set()
+        self._resumed_streams = collections.deque()
+
+        self._last_start_time = None
+
+        self._stopping = False
+        self._closed = False
+
+
+    @property
+    def socket_path(self):
+        return self._socket_path
+
+
+    def serve_forever(self):
+
+        while not self._stopping:
+
+            for key, _ in self._selector.select():
+
+                if key.fileobj is self._socket:
+                    self._accept()
+
+                elif key.fileobj == self._wakeup.fileno():
+                    self._wakeup.clear()
+                    self._resume_streams()
+
+                else:
+                    self._read(key.fileobj, key.data)
+
+        # Complete the streams that are still open.
+        for key in list(self._selector.get_map().values()):
+            if isinstance(key.data, _Stream):
+                self._end_stream(key.fileobj, key.data)
+            elif isinstance(key.data, _Connection):
+                self._reject(key.fileobj, 'server shutting down')
+
+        for stream in list(self._paused_streams):
+            self._end_stream(stream.connection, stream)
+
+
+    def shutdown(self):
+
+        """Stops the I/O loop of this server."""
+
+        self._stopping = True
+        self._wakeup.signal()
+
+
+    def close(self):
+
+        """
+        Closes this server, after all queued streams are processed and
+        all clips are written.
+        """
+
+        if self._closed:
+            return
+
+        self._selector.close()
+        self._socket.close()
+        os.remove(self._socket_path)
+
+        self._pool.close()
+        self._writer.close()
+        self._wakeup.close()
+
+        self._closed = True
+
+
+    def _accept(self):
+        try:
+            connection, _ = self._socket.accept()
+        except BlockingIOError:
+            return
+        connection.setblocking(False)
+        self._selector.register(
+            connection, selectors.EVENT_READ, _Connection())
+
+
+    def _read(self, connection, data):
+
+        try:
+            bytes_ = connection.recv(_READ_SIZE)
+        except (BlockingIOError, InterruptedError):
+            return
+        except OSError:
+            bytes_ = b''
+
+        if isinstance(data, _Connection):
+            self._read_header(connection, data, bytes_)
+
+        elif len(bytes_) == 0:
+            self._end_stream(connection, data)
+
+        else:
+            data.write(bytes_)
+            if data.num_pending_bytes >= _BLOCK_SIZE * _SAMPLE_DTYPE.itemsize:
+                self._schedule(data.flush())
+                if data.pause():
+                    self._selector.unregister(connection)
+                    self._paused_streams.add(data)
+
+
+    def _read_header(self, connection, data, bytes_):
+
+        data.bytes += bytes_
+        end = data.bytes.find(b'\n')
+
+        if end == -1:
+            if len(bytes_) == 0 or len(data.bytes) > _MAX_HEADER_SIZE:
+                self._reject(connection, 'incomplete stream header')
+            return
+
+        try:
+            stream = _Stream(
+                data.bytes[:end].decode('ascii'), connection,
+                self._get_start_time(), self._clip_dir, self._writer,
+                self._resume)
+        except ValueError as e:
+            self._reject(connection, str(e))
+            return
+
+        self._selector.modify(connection, selectors.EVENT_READ, stream)
+
+        rest = data.bytes[end + 1:]
+        if len(rest) != 0:
+            stream.write(rest)
+
+        if len(bytes_) == 0:
+            self._end_stream(connection, stream)
+
+
+    def _get_start_time(self):
+
+        # Make start times unique, so that the clip file names of
+        # different streams of a station differ.
+        time = datetime.datetime.now(datetime.timezone.utc)
+        if self._last_start_time is not None and \
+                time <= self._last_start_time:
+            time = self._last_start_time + datetime.timedelta(microseconds=1)
+        self._last_start_time = time
+        return time
+
+
+    def _resume(self, stream):
+
+        # Called by the worker of a paused stream when it has caught
+        # up. The I/O thread resumes reading the stream's connection.
+        self._resumed_streams.append(stream)
+        self._wakeup.signal()
+
+
+    def _resume_streams(self):
+        while len(self._resumed_streams) != 0:
+            stream = self._resumed_streams.popleft()
+            self._paused_streams.remove(stream)
+            self._selector.register(
+                stream.connection, selectors.EVENT_READ, stream)
+
+
+    def _reject(self, connection, message):
+        self._selector.unregister(connection)
+        try:
+            connection.sendall('error: {}\n'.format(message).encode('ascii'))
+        except OSError:
+            pass
+        connection.close()
+
+
+    def _end_stream(self, connection, stream):
+
+        # From here on the stream's worker owns the connection.
+        if stream in self._paused_streams:
+            self._paused_streams.remove(stream)
+        else:
+            self._selector.unregister(connection)
+
+        self._schedule(stream.flush(end=True))
+
+
+    def _schedule(self, stream):
+
+        # Submit the stream to the pool unless it is already queued or
+        # running, in which case its worker will find the new samples.
+        if stream.claim():
+            self._pool.submit(stream.run)
+
+
+class _Connection:
+
+    """Connection whose stream header has not yet been read."""
+
+
+    def __init__(self):
+        self.bytes = b''
+
+
+class _Stream:
+
+    """
+    Stream of samples from one connection, with its own detector.
+
+    The I/O thread appends blocks of samples to the stream's deque of
+    pending blocks, and a worker removes them and runs the detector on
+    them. A `None` block marks the end of the stream.
+
+    The I/O thread pauses a stream that has too many pending blocks,
+    and the stream's worker calls `resume` with the stream when it has
+    processed half of them.
+    """
+
+
+    def __init__(
+            self, header, connection, start_time, clip_dir, writer, resume):
+
+        parts = header.strip().split(None, 2)
+        if len(parts) != 3:
+            raise ValueError('malformed stream header "{}"'.format(header))
+
+        detector_names, sample_rate, self.station_name = parts
+
+        _check_station_name(self.station_name)
+
+        detector_names = detector_names.split(',')
+        for name in detector_names:
+            if name not in DETECTOR_SETTINGS:
+                raise ValueError('unknown detector "{}"'.format(name))
+
+        try:
+            sample_rate = float(sample_rate)
+        except ValueError:
+            raise ValueError('bad sample rate "{}"'.format(sample_rate))
+
+        self.detector_names = detector_names
+        self.sample_rate = sample_rate
+        self.connection = connection
+        self.start_time = start_time
+
+        self._history = _SampleHistory(
+            int(round(_HISTORY_DURATION * sample_rate)))
+        self._clip_dir = os.path.join(clip_dir, self.station_name)
+        self._writer = writer
+        self._resume = resume
+        self.num_clips = 0
+
+        # written only by the clip writer thread
+        self.num_unwritten_clips = 0
+
+        self._detector = create_detector(detector_names, sample_rate, self)
+
+        self._bytes = bytearray()
+        self._blocks = collections.deque()
+        self._lock = threading.Lock()
+        self._scheduled = False
+        self._paused = False
+
+
+    @property
+    def num_pending_bytes(self):
+        return len(self._bytes)
+
+
+    def write(self, bytes_):
+        self._bytes += bytes_
+
+
+    def flush(self, end=False):
+
+        """
+        Moves the pending bytes of this stream to its block deque, in
+        blocks of `_BLOCK_SIZE` samples. At the end of the stream the
+        last block can be shorter.
+        """
+
+        block_size = _BLOCK_SIZE * _SAMPLE_DTYPE.itemsize
+        unit = _SAMPLE_DTYPE.itemsize if end else block_size
+        n = len(self._bytes) - len(self._bytes) % unit
+
+        for i in range(0, n, block_size):
+            block = bytes(self._bytes[i:min(i + block_size, n)])
+            self._blocks.append(np.frombuffer(block, dtype=_SAMPLE_DTYPE))
+
+        del self._bytes[:n]
+
+        if end:
+            self._blocks.append(None)
+
+        return self
+
+
+    def pause(self):
+
+        """
+        Pauses this stream if it has too many pending blocks, returning
+        `True` if it does.
+        """
+
+        with self._lock:
+            if len(self._blocks) < _MAX_PENDING_BLOCKS:
+                return False
+            self._paused = True
+            return True
+
+
+    def claim(self):
+
+        """
+        Marks this stream as scheduled, returning `True` if it was not
+        already.
+        """
+
+        with self._lock:
+            if self._scheduled:
+                return False
+            self._scheduled = True
+            return True
+
+
+    def run(self):
+
+        """Processes the pending blocks of this stream."""
+
+        while True:
+
+            while len(self._blocks) != 0:
+
+                samples = self._blocks.popleft()
+
+                if self._paused:
+                    self._resume_if_drained()
+
+                if samples is None:
+                    self._complete()
+                    return
+
+                self._history.append(samples)
+                self._detector.detect(samples)
+
+            with self._lock:
+                # Check again under the lock, since the I/O thread may
+                # have appended a block since we last looked.
+                if len(self._blocks) == 0:
+                    self._scheduled = False
+                    return
+
+
+    def _resume_if_drained(self):
+
+        with self._lock:
+            if not self._paused or \
+                    len(self._blocks) > _MAX_PENDING_BLOCKS // 2:
+                return
+            self._paused = False
+
+        self._resume(self)
+
+
+    def _complete(self):
+
+        self._detector.complete_detection()
+
+        # Wait for the clips of this stream to be written, so that the
+        # reply can report any that could not be.
+        self._writer.wait()
+
+        if self.num_unwritten_clips == 0:
+            reply = '{}\n'.format(self.num_clips)
+        else:
+            reply = 'error: {} of {} clips could not be written\n'.format(
+                self.num_unwritten_clips, self.num_clips)
+
+        try:
+            self.connection.setblocking(True)
+            self.connection.sendall(reply.encode('ascii'))
+        except OSError:
+            pass
+        finally:
+            self.connection.close()
+
+
+    def process_clip(self, detector_num, start_index, length):
+
+        """Passes a clip to the clip writer."""
+
+        samples = self._history.get(start_index, start_index + length)
+
+        file_name = '{}_{}_{}.wav'.format(
+            self.detector_names[detector_num],
+            self.start_time.strftime(_START_TIME_FORMAT), start_index)
+        file_path = os.path.join(self._clip_dir, file_name)
+
+        self._writer.write(self, file_path, samples)
+        self.num_clips += 1
+
+
+def _check_station_name(name):
+
+    # A station name is used as the name of a directory in the clip
+    # directory, so it must not lead outside of it.
+    separators = [os.sep, os.altsep, '\0']
+    if os.path.isabs(name) or '..' in name or name == '.' or \
+            any(s is not None and s in name for s in separators):
+        raise ValueError('bad station name "{}"'.format(name))
+
+
+class _SampleHistory:
+
+    """Ring buffer of the most recent samples of a stream."""
+
+
+    def __init__(self, capacity):
+        self._ring = np.zeros(capacity, dtype=_SAMPLE_DTYPE)
+        self._count = 0
+
+
+    def append(self, samples):
+
+        capacity = len(self._ring)
+
+        if len(samples) > capacity:
+            self._count += len(samples) - capacity
+            samples = samples[-capacity:]
+
+        start = self._count % capacity
+        n = min(len(samples), capacity - start)
+
+        self._ring[start:start + n] = samples[:n]
+        self._ring[:len(samples) - n] = samples[n:]
+        self._count += len(samples)
+
+
+    def get(self, start_index, end_index):
+
+        """
+        Gets the retained samples with indices in
+        `[start_index, end_index)`.
+        """
+
+        capacity = len(self._ring)
+        start_index = max(start_index, self._count - capacity, 0)
+        end_index = min(end_index, self._count)
+
+        indices = np.arange(start_index, end_index) % capacity
+        return self._ring[indices]
+
+
+class _WorkStealingPool:
+
+    """
+    Fixed pool of worker threads with per-worker task deques.
+
+    A task submitted from a worker goes to the bottom of that worker's
+    deque, and other tasks are distributed round robin. A worker takes
+    tasks from the bottom of its own deque, and when that is empty
+    steals from the tops of the others. Deque appends and pops are
+    atomic, so the deques need no locks.
+    """
+
+
+    def __init__(self, num_workers):
+
+        self._deques = [collections.deque() for _ in range(num_workers)]
+        self._wakeups = [_Wakeup() for _ in range(num_workers)]
+        self._idle = [False] * num_workers
+        self._local = threading.local()
+        self._next_worker = 0
+        self._closing = False
+
+        self._threads = [
+            threading.Thread(target=self._run_worker, args=(i,), daemon=True)
+            for i in range(num_workers)]
+
+        for thread in self._threads:
+            thread.start()
+
+
+    def submit(self, task):
+
+        index = getattr(self._local, 'index', None)
+
+        if index is None:
+            index = self._next_worker
+            self._next_worker = (index + 1) % len(self._deques)
+
+        self._deques[index].append(task)
+
+        # Wake the worker that owns the deque if it is idle, and
+        # otherwise an idle worker that can steal the task.
+        if self._idle[index]:
+            self._wakeups[index].signal()
+        else:
+            for i, idle in enumerate(self._idle):
+                if idle:
+                    self._wakeups[i].signal()
+                    break
+
+
+    def _run_worker(self, index):
+
+        self._local.index = index
+
+        while True:
+
+            task = self._get_task(index)
+
+            if task is not None:
+                task()
+                continue
+
+            # Announce that we are idle before looking for tasks one
+            # more time, so that a task submitted in the meantime
+            # either is found or wakes us.
+            self._idle[index] = True
+            task = self._get_task(index)
+
+            if task is None:
+                if self._closing:
+                    self._idle[index] = False
+                    return
+                self._wakeups[index].wait()
+
+            self._idle[index] = False
+
+            if task is not None:
+                task()
+
+
+    def _get_task(self, index):
+
+        try:
+            return self._deques[index].pop()
+        except IndexError:
+            pass
+
+        n = len(self._deques)
+        for i in range(1, n):
+            try:
+                return self._deques[(index + i) % n].popleft()
+            except IndexError:
+                pass
+
+        return None
+
+
+    def close(self):
+
+        """Stops the workers of this pool after all tasks are done."""
+
+        self._closing = True
+
+        for wakeup in self._wakeups:
+            wakeup.signal()
+
+        for thread in self._threads:
+            thread.join()
+
+        for wakeup in self._wakeups:
+            wakeup.close()
+
+
+class _Wakeup:
+
+    """
+    Wakeup signal on which a thread can sleep, and that can be selected.
+
+    The signal is an eventfd where available and a pipe elsewhere.
+    """
+
+
+    def __init__(self):
+        if hasattr(os, 'eventfd'):
+            self._read_fd = self._write_fd = os.eventfd(0)
+        else:
+            self._read_fd, self._write_fd = os.pipe()
+
+
+    def fileno(self):
+        return self._read_fd
+
+
+    def signal(self):
+        if hasattr(os, 'eventfd_write'):
+            os.eventfd_write(self._write_fd, 1)
+        else:
+            os.write(self._write_fd, b'\0')
+
+
+    def wait(self):
+
+        """Waits for the signal and clears it."""
+
+        if hasattr(os, 'eventfd_read'):
+            os.eventfd_read(self._read_fd)
+        else:
+            os.read(self._read_fd, 1024)
+
+
+    def clear(self):
+        self.wait()
+
+
+    def close(self):
+        os.close(self._read_fd)
+        if self._write_fd != self._read_fd:
+            os.close(self._write_fd)
+
+
+class _ClipWriter:
+
+    """
+    Thread that writes clips to files in the order they arrive.
+
+    A clip that cannot be written is reported on standard error and
+    counted in the `num_unwritten_clips` attribute of its stream.
+    """
+
+
+    def __init__(self):
+        self._queue = queue.SimpleQueue()
+        self._thread = threading.Thread(target=self._run, daemon=True)
+        self._thread.start()
+
+
+    def write(self, stream, file_path, samples):
+        self._queue.put((stream, file_path, samples))
+
+
+    def wait(self):
+
+        """Waits for all clips queued so far to be written."""
+
+        event = threading.Event()
+        self._queue.put(event)
+        event.wait()
+
+
+    def _run(self):
+
+        while True:
+
+            item = self._queue.get()
+
+            if item is None:
+                return
+
+            if isinstance(item, threading.Event):
+                item.set()
+                continue
+
+            stream, file_path, samples = item
+
+            try:
+                os.makedirs(os.path.dirname(file_path), exist_ok=True)
+                write_sound_file(file_path, samples, stream.sample_rate)
+            except Exception as e:
+                stream.num_unwritten_clips += 1
+                print(
+                    'could not write clip "{}": {}'.format(file_path, e),
+                    file=sys.stderr)
+
+
+    def close(self):
+
+        """Waits for all queued clips to be written."""
+
+        self._queue.put(None)
+        self._thread.join()
+
+
+if __name__ == '__main__':
+    main()
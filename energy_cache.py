@@ -0,0 +1,548 @@
+"""
+Module containing classes `EnergyCacheWriter`, `EnergyCache`, and
+`CachedDetector`, which let a redux Old Bird detector re-detect clips
+in a recording without filtering the recording again.
+
+The only settings of a redux detector that affect its signal before the
+ratio stage are those of its bandpass filter and its integration time.
+An energy cache stores the integrated energy signal of a recording for
+such settings, i.e. the output of the detector's integrator, so that
+detection with other ratio delays, thresholds, minimum and maximum
+durations, and so on can start from it rather than from the recording.
+
+A cache file is a sequence of independently compressed chunks of the
+energy signal, each of the same number of values except the last. The
+bytes of the 64-bit floats of a chunk are shuffled (so that the first
+bytes of all of the floats come first, and so on) and then compressed
+with zlib, which compresses them losslessly. The file is read through
+a memory map, and only the chunks a reader needs are decompressed.
+
+Each chunk also has a summary of the minimum and maximum of its values.
+The ratio of a redux detector at a sample is the energy at that sample
+divided by the energy `delay` samples earlier, so the summaries of a
+chunk and the chunk before it bound the ratios of the chunk. A cached
+detector skips the chunks whose ratios cannot cross its threshold, and
+only decompresses a chunk it skips if the next chunk needs its last
+few values.
+
+A cache file starts with a header of 64-bit integers:
+
+    0       magic number
+    1       format version
+    2       chunk size, in values
+    3       number of chunks
+    4       start index, i.e. the index in the recording of the sample
+            at which the first energy value ends
+    5       number of energy values
+    6       number of recording samples
+    7       metadata offset
+    8       metadata length
+    9       chunk table offset
+
+followed by the compressed chunks, the metadata, which is JSON that
+includes the sample rate and the filter and integration settings, and
+the chunk table. The table comprises an array of `num_chunks + 1`
+64-bit integer chunk offsets (the last is the end of the last chunk)
+and arrays of `num_chunks` 64-bit float chunk minima and maxima.
+
+A cache writer writes a cache to a temporary file and renames it to its
+final name when it is closed, so an incomplete cache is never mistaken
+for a complete one.
+"""
+
+
+import json
+import math
+import mmap
+import os
+import zlib
+
+import numpy as np
+
+from old_bird_detector_redux_1_1 import _Detector, _SignalProcessorChain
+
+
+_MAGIC = 0x4f6c64456e657267
+_VERSION = 1
+
+_HEADER_SIZE = 10
+
+_MAGIC_INDEX = 0
+_VERSION_INDEX = 1
+_CHUNK_SIZE_INDEX = 2
+_NUM_CHUNKS_INDEX = 3
+_START_INDEX_INDEX = 4
+_NUM_VALUES_INDEX = 5
+_NUM_SAMPLES_INDEX = 6
+_METADATA_OFFSET_INDEX = 7
+_METADATA_LENGTH_INDEX = 8
+_TABLE_OFFSET_INDEX = 9
+
+_CACHED_SETTING_NAMES = (
+    'filter_f0', 'filter_f1', 'filter_bw', 'filter_duration',
+    'integration_time')
+"""names of the detector settings on which an energy cache depends."""
+
+_ZERO_REPLACEMENT = 1e-20
+"""the value with which the ratio stage of a redux detector replaces zeros."""
+
+
+class EnergyCacheWriter:
+
+    """
+    Writes the integrated energy signal of a recording to a cache file.
+
+    The `write` method can be called repeatedly with consecutive arrays
+    of samples. The `close` method must be called after the last call
+    to `write` to complete the cache.
+    """
+
+
+    def __init__(
+            self, file_path, settings, sample_rate, chunk_size=2 ** 14,
+            compression_level=6):
+
+        self._file_path = file_path
+        self._temp_file_path = file_path + '.partial'
+        self._settings = settings
+        self._sample_rate = sample_rate
+        self._chunk_size = chunk_size
+        self._compression_level = compression_level
+
+        # The signal processor of a redux detector without its ratio
+        # stage computes the integrated energy.
+        detector = _Detector(settings, sample_rate, None)
+        processors = detector._signal_processor._processors[:-1]
+        self._processor = _SignalProcessorChain(processors)
+
+        self._recent_samples = np.array([], dtype='float')
+        self._pending = []
+        self._num_pending = 0
+        self._num_samples = 0
+        self._num_values = 0
+
+        self._offsets = []
+        self._minima = []
+        self._maxima = []
+
+        self._file = open(self._temp_file_path, 'wb')
+        self._file.write(bytes(8 * _HEADER_SIZE))
+
+
+    @property
+    def file_path(self):
+        return self._file_path
+
+
+    def write(self, samples):
+
+        x = np.concatenate((self._recent_samples, samples))
+        latency = self._processor.latency
+
+        if len(x) > latency:
+            self._append(self._processor.process(x))
+            self._recent_samples = x[len(x) - latency:]
+        else:
+            self._recent_samples = x
+
+        self._num_samples += len(samples)
+
+
+    def _append(self, values):
+
+        self._pending.append(values)
+        self._num_pending += len(values)
+
+        if self._num_pending >= self._chunk_size:
+
+            values = np.concatenate(self._pending)
+            n = self._chunk_size
+            num_chunks = len(values) // n
+
+            for i in range(num_chunks):
+                self._write_chunk(values[i * n:(i + 1) * n])
+
+            values = values[num_chunks * n:]
+            self._pending = [values]
+            self._num_pending = len(values)
+
+
+    def _write_chunk(self, values):
+
+        self._offsets.append(self._file.tell())
+        self._minima.append(values.min())
+        self._maxima.append(values.max())
+
+        data = _shuffle(values)
+        self._file.write(zlib.compress(data, self._compression_level))
+
+        self._num_values += len(values)
+
+
+    def close(self):
+
+        """Completes the cache and renames it to its final name."""
+
+        if self._file is None:
+            return
+
+        if self._num_pending != 0:
+            self._write_chunk(np.concatenate(self._pending))
+            self._pending = []
+            self._num_pending = 0
+
+        f = self._file
+        num_chunks = len(self._minima)
+        self._offsets.append(f.tell())
+
+        metadata = json.dumps({
+            'sample_rate': self._sample_rate,
+            'settings': dict(
+                (name, getattr(self._settings, name))
+                for name in _CACHED_SETTING_NAMES)
+        }).encode('utf-8')
+        metadata_offset = f.tell()
+        f.write(metadata)
+
+        # Align the table for memory-mapped access.
+        f.write(bytes(-f.tell() % 8))
+        table_offset = f.tell()
+        f.write(np.array(self._offsets, dtype='<i8').tobytes())
+        f.write(np.array(self._minima, dtype='<f8').tobytes())
+        f.write(np.array(self._maxima, dtype='<f8').tobytes())
+
+        processor = self._processor
+        start_index = processor.latency if num_chunks != 0 else 0
+
+        header = np.zeros(_HEADER_SIZE, dtype='<i8')
+        header[_MAGIC_INDEX] = _MAGIC
+        header[_VERSION_INDEX] = _VERSION
+        header[_CHUNK_SIZE_INDEX] = self._chunk_size
+        header[_NUM_CHUNKS_INDEX] = num_chunks
+        header[_START_INDEX_INDEX] = start_index
+        header[_NUM_VALUES_INDEX] = self._num_values
+        header[_NUM_SAMPLES_INDEX] = self._num_samples
+        header[_METADATA_OFFSET_INDEX] = metadata_offset
+        header[_METADATA_LENGTH_INDEX] = len(metadata)
+        header[_TABLE_OFFSET_INDEX] = table_offset
+        f.seek(0)
+        f.write(header.tobytes())
+
+        f.flush()
+        os.fsync(f.fileno())
+        f.close()
+        self._file = None
+
+        os.replace(self._temp_file_path, self._file_path)
+
+
+    def __enter__(self):
+        return self
+
+
+    def __exit__(self, exc_type, exc_value, traceback):
+        if exc_type is None:
+            self.close()
+        else:
+            self._file.close()
+            self._file = None
+            os.remove(self._temp_file_path)
+
+
+class EnergyCache:
+
+    """Energy cache file, opened for reading."""
+
+
+    def __init__(self, file_path):
+
+        with open(file_path, 'rb') as f:
+            self._map = mmap.mmap(f.fileno(), 0, access=mmap.ACCESS_READ)
+
+        header = np.frombuffer(self._map, dtype='<i8', count=_HEADER_SIZE)
+
+        if header[_MAGIC_INDEX] != _MAGIC or \
+                header[_VERSION_INDEX] != _VERSION:
+            self._map.close()
+            raise ValueError(
+                'File "{}" is not a version {} energy cache.'.format(
+                    file_path, _VERSION))
+
+        self._chunk_size = int(header[_CHUNK_SIZE_INDEX])
+        self._num_chunks = int(header[_NUM_CHUNKS_INDEX])
+        self._start_index = int(header[_START_INDEX_INDEX])
+        self._num_values = int(header[_NUM_VALUES_INDEX])
+        self._num_samples = int(header[_NUM_SAMPLES_INDEX])
+
+        offset = int(header[_METADATA_OFFSET_INDEX])
+        length = int(header[_METADATA_LENGTH_INDEX])
+        metadata = json.loads(
+            self._map[offset:offset + length].decode('utf-8'))
+        self._sample_rate = metadata['sample_rate']
+        self._settings = metadata['settings']
+
+        n = self._num_chunks
+        offset = int(header[_TABLE_OFFSET_INDEX])
+        self._offsets = self._get_array('<i8', offset, n + 1)
+        offset += 8 * (n + 1)
+        self._minima = self._get_array('<f8', offset, n)
+        offset += 8 * n
+        self._maxima = self._get_array('<f8', offset, n)
+
+
+    def _get_array(self, dtype, offset, count):
+        return np.frombuffer(
+            self._map, dtype=dtype, count=count, offset=offset)
+
+
+    @property
+    def sample_rate(self):
+        return self._sample_rate
+
+
+    @property
+    def settings(self):
+
+        """The filter and integration settings of this cache, a `dict`."""
+
+        return dict(self._settings)
+
+
+    @property
+    def chunk_size(self):
+        return self._chunk_size
+
+
+    @property
+    def num_chunks(self):
+        return self._num_chunks
+
+
+    @property
+    def start_index(self):
+
+        """
+        The index of the recording sample at which the first energy
+        value ends.
+        """
+
+        return self._start_index
+
+
+    @property
+    def num_values(self):
+        return self._num_values
+
+
+    @property
+    def num_samples(self):
+
+        """The number of samples of the recording."""
+
+        return self._num_samples
+
+
+    @property
+    def minima(self):
+        return self._minima
+
+
+    @property
+    def maxima(self):
+        return self._maxima
+
+
+    def get_chunk(self, chunk_num):
+
+        """Decompresses the values of the specified chunk."""
+
+        start = int(self._offsets[chunk_num])
+        end = int(self._offsets[chunk_num + 1])
+        return _unshuffle(zlib.decompress(self._map[start:end]))
+
+
+    def get_ratio_bounds(self, delay):
+
+        """
+        Gets lower and upper bounds on the ratios of the values of each
+        chunk to the values `delay` samples before them.
+
+        Bounds are computed from the chunk summaries for the values of
+        each chunk and the chunk before it, so `delay` must not exceed
+        the chunk size. Where the values of those chunks are not all
+        positive, so that the ratios cannot be bounded, the bounds are
+        minus and plus infinity.
+        """
+
+        if delay > self._chunk_size:
+            raise ValueError(
+                'Ratio delay {} exceeds cache chunk size {}.'.format(
+                    delay, self._chunk_size))
+
+        minima = _include_previous(self._minima, np.minimum)
+        maxima = _include_previous(self._maxima, np.maximum)
+
+        positive = minima > 0
+        safe_minima = np.where(positive, minima, 1)
+
+        lows = np.where(positive, safe_minima / maxima, -np.inf)
+        highs = np.where(positive, maxima / safe_minima, np.inf)
+
+        return lows, highs
+
+
+    def close(self):
+        self._offsets = None
+        self._minima = None
+        self._maxima = None
+        self._map.close()
+
+
+    def __enter__(self):
+        return self
+
+
+    def __exit__(self, exc_type, exc_value, traceback):
+        self.close()
+
+
+def _include_previous(x, function):
+
+    """Combines each element of an array with the one before it."""
+
+    result = x.copy()
+    result[1:] = function(x[1:], x[:-1])
+    return result
+
+
+def _shuffle(values):
+    return values.astype('<f8').view('uint8').reshape(-1, 8).T.tobytes()
+
+
+def _unshuffle(data):
+    x = np.frombuffer(data, dtype='uint8').reshape(8, -1)
+    return np.ascontiguousarray(x.T).view('<f8').reshape(-1)
+
+
+class CachedDetector(_Detector):
+
+    """
+    Redux detector that detects clips from an energy cache.
+
+    The filter and integration settings of `settings` must match those
+    of the cache. The `detect` method processes the whole cache, and
+    the `complete_detection` method should be called after it. The
+    detected clips are those the redux detector with the specified
+    settings would detect when run on the recording with the same
+    division of the recording into chunks as when the cache was
+    written.
+    """
+
+
+    def __init__(self, cache, settings, listener):
+
+        for name, value in cache.settings.items():
+            if getattr(settings, name) != value:
+                raise ValueError(
+                    'Detector setting "{}" does not match that of '
+                    'energy cache.'.format(name))
+
+        super().__init__(settings, cache.sample_rate, listener)
+
+        self._cache = cache
+        self._delay = math.floor(settings.ratio_delay * cache.sample_rate)
+        self._num_chunks_skipped = 0
+
+
+    @property
+    def num_chunks_skipped(self):
+        return self._num_chunks_skipped
+
+
+    def detect(self):
+
+        cache = self._cache
+        delay = self._delay
+        threshold = self.settings.ratio_threshold
+
+        lows, highs = cache.get_ratio_bounds(delay)
+
+        # The ratio rises above the threshold only at samples where it
+        # is above the threshold, and falls below the inverse of the
+        # threshold only at samples where it is below that.
+        active = (highs > threshold) | (lows < 1 / threshold)
+
+        # Index in the recording of the first value of the current chunk.
+        start_index = cache.start_index
+
+        # The last `delay + 1` values of the previous chunk, or `None`
+        # if the previous chunk was skipped and has not been loaded.
+        history = np.array([])
+
+        for i in range(cache.num_chunks):
+
+            size = min(
+                cache.chunk_size, cache.num_values - i * cache.chunk_size)
+
+            if not active[i]:
+                self._num_chunks_skipped += 1
+                history = None
+
+            else:
+
+                if history is None:
+                    history = cache.get_chunk(i - 1)[-(delay + 1):]
+
+                x = np.concatenate((history, cache.get_chunk(i)))
+                self._process(x, start_index + size - len(x))
+                history = x[-(delay + 1):]
+
+            start_index += size
+
+        self._num_samples_processed = cache.num_samples
+
+
+    def _process(self, x, start_index):
+
+        """
+        Processes energy values, the first of which ends at the
+        specified recording index.
+        """
+
+        delay = self._delay
+
+        if len(x) < delay + 2:
+            return
+
+        x = x.copy()
+        x[x == 0] = _ZERO_REPLACEMENT
+        ratios = x[delay:] / x[:-delay]
+
+        # As in `_Detector.detect`, the index of the crossing between
+        # two consecutive ratios is the index of the numerator of the
+        # second one. `_get_threshold_crossings` adds one to the offset.
+        offset = start_index + delay
+
+        crossings = self._get_threshold_crossings(ratios, offset)
+        clips = self._series_processor.process(crossings)
+        self._notify_listener(clips)
+
+
+def detect(cache, settings):
+
+    """Runs a cached detector on the specified cache and returns its clips."""
+
+    listener = _Listener()
+    detector = CachedDetector(cache, settings, listener)
+    detector.detect()
+    detector.complete_detection()
+    return listener.clips
+
+
+class _Listener:
+
+    def __init__(self):
+        self.clips = []
+
+    def process_clip(self, start_index, length):
+        self.clips.append((start_index, length))
@@ -0,0 +1,359 @@
+"""
+Module containing class `GridSearch`, which runs many configurations of
+a redux Old Bird detector on the same input, sharing the computation of
+the processing stages that the configurations have in common.
+
+A redux detector processes its input with a bandpass filter, a squarer,
+an integrator, a ratio stage, and a threshold stage, and then turns the
+resulting threshold crossings into clips with a chain of series
+processors. Each stage depends on only a few detector settings, and on
+the stages before it. A grid search builds a tree of stage nodes for a
+set of detector configurations, in which configurations share a node
+whenever they agree on the settings of that stage and of all of the
+stages before it. For example, configurations that differ only in their
+thresholds share everything up to the threshold stage, and the input is
+filtered once for each distinct filter rather than once per
+configuration. Each node processes the new output of its parent a chunk
+at a time and keeps just the history of that output it needs to
+continue with the next chunk.
+
+The `score_clips` function scores the clips of a configuration against
+a reference clip list, and the `search` function runs a grid search and
+scores all of its configurations.
+"""
+
+
+import itertools
+
+import numpy as np
+
+from bunch import Bunch
+from old_bird_detector_redux_1_1 import (
+    _Detector, _Divider, _get_threshold_crossings)
+import clip_utils
+
+
+_STAGE_NAMES = (
+    'filter', 'squarer', 'integrator', 'ratio', 'threshold', 'series')
+
+_SIGNAL_STAGE_SETTING_NAMES = (
+    ('filter_f0', 'filter_f1', 'filter_bw', 'filter_duration'),
+    (),
+    ('integration_time',),
+    ('ratio_delay',)
+)
+"""
+names of the settings on which each signal processing stage of a redux
+detector depends (in addition to those of the stages before it).
+
+The stages are the filter, squarer, integrator, and ratio stage.
+"""
+
+
+class GridSearch:
+
+    """
+    Runs many redux detector configurations on the same input.
+
+    `configurations` is a sequence of redux detector settings, e.g.
+    as returned by `get_configurations`. The `process` method can be
+    called repeatedly with consecutive arrays of samples, and the
+    `complete_processing` method must be called after the last call to
+    it. After that the `clips` property is a list of the clips of each
+    configuration.
+    """
+
+
+    def __init__(self, configurations, sample_rate):
+
+        self._sample_rate = sample_rate
+        self._root = _Node(None, 0)
+        self._stage_nodes = [{} for _ in range(len(_STAGE_NAMES))]
+        self._leaves = []
+
+        for settings in configurations:
+            self._leaves.append(self._add_configuration(settings))
+
+        self._num_samples_processed = 0
+
+
+    def _add_configuration(self, settings):
+
+        detector = None
+        parent = self._root
+        key = ()
+
+        for stage_num, names in enumerate(_SIGNAL_STAGE_SETTING_NAMES):
+
+            key += tuple(getattr(settings, name) for name in names)
+            node = self._stage_nodes[stage_num].get(key)
+
+            if node is None:
+
+                if detector is None:
+                    detector = _Detector(settings, self._sample_rate, None)
+
+                processor = detector._signal_processor._processors[stage_num]
+                node = _SignalNode(processor, parent.start_index)
+                self._add_node(stage_num, key, node, parent)
+
+            parent = node
+
+        # threshold stage
+        stage_num = len(_SIGNAL_STAGE_SETTING_NAMES)
+        key += (settings.ratio_threshold,)
+        node = self._stage_nodes[stage_num].get(key)
+        if node is None:
+            node = _ThresholdNode(settings.ratio_threshold, parent.start_index)
+            self._add_node(stage_num, key, node, parent)
+        parent = node
+
+        # series processing stage, which depends on all of the settings
+        stage_num += 1
+        key = tuple(sorted(settings.__dict__.items()))
+        node = self._stage_nodes[stage_num].get(key)
+        if node is None:
+            if detector is None:
+                detector = _Detector(settings, self._sample_rate, None)
+            node = _SeriesNode(detector._series_processor)
+            self._add_node(stage_num, key, node, parent)
+
+        return node
+
+
+    def _add_node(self, stage_num, key, node, parent):
+        self._stage_nodes[stage_num][key] = node
+        parent.children.append(node)
+
+
+    @property
+    def sample_rate(self):
+        return self._sample_rate
+
+
+    @property
+    def num_configurations(self):
+        return len(self._leaves)
+
+
+    @property
+    def stage_node_counts(self):
+
+        """
+        A mapping from stage names to the numbers of distinct nodes of
+        the stages.
+        """
+
+        return dict(
+            (name, len(nodes))
+            for name, nodes in zip(_STAGE_NAMES, self._stage_nodes))
+
+
+    @property
+    def clips(self):
+        return [leaf.clips for leaf in self._leaves]
+
+
+    def process(self, samples):
+        self._root.process_children(np.asarray(samples, dtype='float'))
+        self._num_samples_processed += len(samples)
+
+
+    def complete_processing(self):
+
+        """
+        Completes processing after the `process` method has been called
+        for all input.
+        """
+
+        # As in `_Detector.complete_detection`.
+        fall = (self._num_samples_processed, False)
+
+        for node in self._stage_nodes[-1].values():
+            node.complete_processing([fall])
+
+
+class _Node:
+
+    """
+    Grid search tree node.
+
+    `start_index` is the index in the input of the sample with which
+    the first output value of the node ends, i.e. the newest input
+    sample on which that value depends.
+    """
+
+
+    def __init__(self, processor, start_index):
+        self.processor = processor
+        self.start_index = start_index
+        self.children = []
+
+
+    def process_children(self, x):
+        for child in self.children:
+            child.process(x)
+
+
+class _SignalNode(_Node):
+
+
+    def __init__(self, processor, start_index):
+
+        # A ratio stage computes one output value for each input value
+        # after the first `delay` of them, while other signal processors
+        # compute one for each after the first `latency`.
+        if isinstance(processor, _Divider):
+            history_length = processor._delay
+        else:
+            history_length = processor.latency
+
+        super().__init__(processor, start_index + history_length)
+
+        self._history_length = history_length
+        self._history = np.array([], dtype='float')
+
+
+    def process(self, x):
+
+        x = np.concatenate((self._history, x))
+        n = self._history_length
+
+        if len(x) > n:
+            self._history = x[len(x) - n:] if n != 0 else x[:0]
+            self.process_children(self.processor.process(x))
+        else:
+            self._history = x
+
+
+class _ThresholdNode(_Node):
+
+    """Finds the threshold crossings of a ratio signal."""
+
+
+    def __init__(self, threshold, start_index):
+        super().__init__(None, start_index)
+        self._threshold = threshold
+        self._previous_ratio = np.array([], dtype='float')
+
+        # index of the first ratio of the next call to `process`,
+        # including the previous ratio
+        self._first_index = start_index
+
+
+    def process(self, ratios):
+
+        x = np.concatenate((self._previous_ratio, ratios))
+
+        if len(x) > 1:
+
+            # As in `_Detector.detect`, the index of the crossing
+            # between two consecutive ratios is that of the second one.
+            # `_get_threshold_crossings` adds one to the offset.
+            crossings = _get_threshold_crossings(
+                x, self._threshold, self._first_index)
+            self.process_children(crossings)
+
+            self._first_index += len(x) - 1
+            self._previous_ratio = x[-1:]
+
+        else:
+            self._previous_ratio = x
+
+
+class _SeriesNode(_Node):
+
+    """Turns threshold crossings into clips."""
+
+
+    def __init__(self, processor):
+        super().__init__(processor, 0)
+        self.clips = []
+
+
+    def process(self, crossings):
+        self.clips += self.processor.process(crossings)
+
+
+    def complete_processing(self, crossings):
+        self.clips += self.processor.complete_processing(crossings)
+
+
+def get_configurations(settings, **values):
+
+    """
+    Gets the detector configurations of a parameter grid.
+
+    `settings` are base detector settings, and each keyword argument
+    is a sequence of values of the setting of the same name. The
+    configurations are the base settings with each combination of
+    setting values.
+    """
+
+    names = sorted(values.keys())
+    return [
+        Bunch(settings, **dict(zip(names, combination)))
+        for combination in itertools.product(*[values[n] for n in names])]
+
+
+def score_clips(clips, reference_clips):
+
+    """
+    Scores detected clips against reference clips.
+
+    A reference clip is *hit* if some detected clip overlaps it, and a
+    detected clip is a *false alarm* if it overlaps no reference clip.
+    The score includes the numbers of hits, misses, and false alarms,
+    the fraction of reference clips that are hit (the recall), and the
+    fraction of detected clips that are not false alarms (the
+    precision).
+    """
+
+    matches = clip_utils.match_clips(reference_clips, clips)
+
+    num_hits = sum(1 for r, c in matches if r is not None and len(c) != 0)
+    num_false_alarms = sum(1 for r, c in matches if r is None)
+
+    num_references = len(reference_clips)
+    num_clips = len(clips)
+
+    recall = num_hits / num_references if num_references != 0 else 1
+
+    if num_clips != 0:
+        precision = (num_clips - num_false_alarms) / num_clips
+    else:
+        precision = 1
+
+    return Bunch(
+        num_hits=num_hits,
+        num_misses=num_references - num_hits,
+        num_false_alarms=num_false_alarms,
+        recall=recall,
+        precision=precision)
+
+
+def search(
+        samples, sample_rate, configurations, reference_clips,
+        chunk_size=None):
+
+    """
+    Runs a grid search on the specified samples and scores the clips of
+    each configuration against the specified reference clips.
+
+    Returns a list of `(configuration, clips, score)` triples, one for
+    each configuration.
+    """
+
+    search = GridSearch(configurations, sample_rate)
+
+    if chunk_size is None:
+        chunk_size = max(len(samples), 1)
+
+    for i in range(0, len(samples), chunk_size):
+        search.process(samples[i:i + chunk_size])
+
+    search.complete_processing()
+
+    return [
+        (configuration, clips, score_clips(clips, reference_clips))
+        for configuration, clips in zip(configurations, search.clips)]
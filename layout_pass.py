@@ -0,0 +1,468 @@
+"""
+Module containing a graph pass that chooses the multichannel layouts of
+the blocks of a model graph (see the `mdl_graph` module) and eliminates
+redundant transposes.
+
+A multichannel BufferedDSP signal is a buffer of `buffersize` samples of
+each of `numChannels` channels, stored either in row-major order (the
+samples of one time are adjacent) or in column-major order (the samples
+of one channel are adjacent). Many blocks have a `col_major` parameter
+that selects the layout of their input and output buffers, and models
+convert between layouts with transpose blocks (see `stranspose.c` in the
+`Old Bird` directory), each of which copies a whole buffer.
+
+Several blocks support both layouts equally well, namely the blocks of
+`LAYOUT_AGNOSTIC_TYPES`, as do pointwise blocks like gains, products,
+and relational operators, which have no `col_major` parameter. This
+pass removes all transposes from a graph and then assigns a layout to
+each such block so as to minimize the total size of the buffers that
+must be converted between layouts. Other blocks keep the layouts of their
+`col_major` parameters, or the row-major layout if they have none. A
+transpose is inserted only on each edge whose endpoints must still
+disagree, and then only if the edge carries more than one channel, since
+the two layouts of a single-channel buffer are the same.
+
+Minimizing the conversion cost is a two-label assignment problem, which
+we solve exactly as a minimum cut: fixed row-major blocks are attached
+to a source and fixed column-major blocks to a sink. All of the
+destinations of a block output that need a conversion share one
+transpose, so the conversion cost of an output is paid once if any of
+the output's block and its destinations disagree, and not at all if
+they all agree. Each multichannel output is therefore represented in
+the flow network by two auxiliary nodes. The first is reachable from
+the output's block and destinations by edges of infinite capacity, and
+is attached to the sink by an edge of capacity equal to the conversion
+cost. The second is attached to the source by such an edge, and reaches
+the block and destinations by edges of infinite capacity. If the block
+and destinations are all row-major or all column-major, a minimum cut
+cuts one of the two capacity edges, and otherwise it cuts both, so up
+to a constant the capacity of the cut is the conversion cost. Among
+optimal assignments we prefer to keep each block's declared layout, or
+the specified preferred layout.
+"""
+
+
+from collections import deque
+
+from mdl_graph import Block, Edge
+
+
+ROW_MAJOR = 0
+COL_MAJOR = 1
+
+LAYOUT_AGNOSTIC_TYPES = frozenset([
+    'Delay', 'sdelay', 'FIFO', 'sfifo', 'Integrate', 'sfiniteintegrate',
+    'PulseLimitedFlipFlop', 'splimflipflop', 'Counter', 'scounter',
+    'sclipnsave'])
+"""
+types of blocks that support both layouts, by library source type or
+S-function name.
+"""
+
+POINTWISE_TYPES = frozenset([
+    'Constant', 'Gain', 'Logic', 'Math', 'Product', 'RelationalOperator',
+    'Sum'])
+"""
+types of pointwise blocks, which operate on the samples of their inputs
+independently and so have whatever layout their inputs have.
+"""
+
+TRANSPOSE_TYPES = frozenset(['Transpose', 'stranspose'])
+"""types of transpose blocks."""
+
+_SINGLE_CHANNEL_OUTPUT_TYPES = frozenset(['SelectChannel'])
+"""types of blocks with a single-channel output but a multichannel input."""
+
+
+def propagate_layouts(graph, preferred_layout=None):
+
+    """
+    Chooses the layouts of the blocks of a graph and eliminates
+    redundant transposes.
+
+    The `col_major` parameters of layout-agnostic blocks are set to
+    their chosen layouts, and transposes are kept only where they are
+    needed. If `preferred_layout` is `None`, each block keeps its
+    declared layout when that costs nothing, and otherwise blocks prefer
+    the specified layout.
+
+    Returns the resulting graph. The specified graph is not modified.
+    """
+
+    graph = graph.copy()
+
+    declared = _get_declared_layouts(graph)
+    channel_counts = _get_channel_counts(graph)
+    widths = _get_widths(graph)
+
+    _remove_transposes(graph)
+
+    layouts = _assign_layouts(
+        graph, declared, channel_counts, widths, preferred_layout)
+
+    for block in graph.blocks.values():
+        if block.type in LAYOUT_AGNOSTIC_TYPES:
+            block.params['col_major'] = str(layouts[block.path])
+
+    _insert_transposes(graph, layouts, channel_counts, widths)
+
+    return graph
+
+
+def get_conversion_cost(graph):
+
+    """
+    Gets the number of samples per buffer period copied by the transposes
+    of a graph.
+    """
+
+    channel_counts = _get_channel_counts(graph)
+    widths = _get_widths(graph)
+
+    return sum(
+        channel_counts[e.src] * widths[e.src]
+        for e in graph.edges
+        if graph.blocks[e.dst].type in TRANSPOSE_TYPES)
+
+
+def _get_declared_layouts(graph):
+
+    """
+    Gets the declared layout of each block that has one.
+
+    Pointwise and transpose blocks have no declared layout.
+    """
+
+    layouts = {}
+
+    for block in graph.blocks.values():
+
+        if block.type in POINTWISE_TYPES or block.type in TRANSPOSE_TYPES:
+            continue
+
+        try:
+            col_major = block.evaluate('col_major', ROW_MAJOR)
+        except ValueError:
+            col_major = ROW_MAJOR
+
+        layouts[block.path] = COL_MAJOR if col_major else ROW_MAJOR
+
+    return layouts
+
+
+def _get_channel_counts(graph):
+
+    """Gets the number of channels of the output of each block."""
+
+    counts = {}
+
+    def get_count(path, visiting):
+
+        if path in counts:
+            return counts[path]
+
+        if path in visiting:
+            # feedback loop
+            return 1
+
+        block = graph.blocks[path]
+
+        if block.type in _SINGLE_CHANNEL_OUTPUT_TYPES:
+            count = 1
+
+        elif 'numChannels' in block.params:
+            count = _evaluate_int(block, 'numChannels', 1)
+
+        elif block.type == 'WaveIn':
+            count = 2 if block.params.get('stereo') == 'on' else 1
+
+        elif block.type in POINTWISE_TYPES or block.type in TRANSPOSE_TYPES:
+            visiting.add(path)
+            count = max(
+                [get_count(e.src, visiting) for e in graph.get_inputs(path)],
+                default=1)
+            visiting.discard(path)
+
+        else:
+            count = 1
+
+        counts[path] = count
+        return count
+
+    for path in graph.blocks:
+        get_count(path, set())
+
+    return counts
+
+
+def _get_widths(graph):
+
+    """
+    Gets the buffer size of the output of each block, in samples per
+    channel.
+
+    Blocks without a buffer size parameter are assumed to have the
+    buffer size of their first input, or one if they have no inputs.
+    """
+
+    widths = {}
+
+    def get_width(path, visiting):
+
+        if path in widths:
+            return widths[path]
+
+        block = graph.blocks[path]
+
+        width = _evaluate_int(block, 'buffersize', None)
+        if width is None:
+            width = _evaluate_int(block, 'output_width', None)
+
+        if width is None:
+            inputs = graph.get_inputs(path)
+            if len(inputs) == 0 or path in visiting:
+                width = 1
+            else:
+                visiting.add(path)
+                width = get_width(inputs[0].src, visiting)
+                visiting.discard(path)
+
+        widths[path] = width
+        return width
+
+    for path in graph.blocks:
+        get_width(path, set())
+
+    return widths
+
+
+def _evaluate_int(block, param_name, default):
+    try:
+        value = block.evaluate(param_name, default)
+    except ValueError:
+        return default
+    return default if value is None else int(round(float(value)))
+
+
+def _remove_transposes(graph):
+
+    """
+    Removes the transposes of a graph, connecting the source of each
+    to its destinations.
+    """
+
+    for block in graph.get_blocks(*TRANSPOSE_TYPES):
+
+        inputs = graph.get_inputs(block.path)
+        outputs = graph.get_outputs(block.path)
+        graph.remove_block(block.path)
+
+        for i in inputs:
+            for o in outputs:
+                graph.edges.append(Edge(i.src, i.src_port, o.dst, o.dst_port))
+
+
+def _assign_layouts(
+        graph, declared, channel_counts, widths, preferred_layout):
+
+    """
+    Assigns a layout to each block of a graph that has no transposes,
+    minimizing the total cost of the needed layout conversions.
+    """
+
+    source = object()
+    sink = object()
+    network = _FlowNetwork()
+
+    free = set(
+        b.path for b in graph.blocks.values()
+        if b.type in LAYOUT_AGNOSTIC_TYPES or b.type in POINTWISE_TYPES)
+
+    # Each conversion costs at least one, so the total of the preference
+    # capacities (less than one) can only break ties between assignments
+    # of equal conversion cost.
+    preference = 1 / (2 * (len(graph.blocks) + 1))
+
+    for path in graph.blocks:
+
+        if path in free:
+            layout = declared.get(path) if preferred_layout is None \
+                else preferred_layout
+            if layout is None:
+                layout = ROW_MAJOR
+            capacity = preference
+
+        else:
+            layout = declared[path]
+            capacity = float('inf')
+
+        if layout == ROW_MAJOR:
+            network.add_edge(source, path, capacity)
+        else:
+            network.add_edge(path, sink, capacity)
+
+    # Group the destinations of each multichannel block output, since
+    # they share a transpose.
+    outputs = {}
+    for e in graph.edges:
+        cost = _get_conversion_cost(e, channel_counts, widths)
+        if cost != 0:
+            key = (e.src, e.src_port)
+            outputs.setdefault(key, (cost, set([e.src])))[1].add(e.dst)
+
+    infinity = float('inf')
+
+    for cost, paths in outputs.values():
+
+        # `any_row` is on the source side of a cut if any of the paths
+        # are, and `any_col` on the sink side if any of the paths are.
+        any_row = object()
+        any_col = object()
+        network.add_edge(any_row, sink, cost)
+        network.add_edge(source, any_col, cost)
+
+        for path in paths:
+            network.add_edge(path, any_row, infinity)
+            network.add_edge(any_col, path, infinity)
+
+    row_major = network.get_min_cut(source, sink)
+
+    return dict(
+        (path, ROW_MAJOR if path in row_major else COL_MAJOR)
+        for path in graph.blocks)
+
+
+def _get_conversion_cost(edge, channel_counts, widths):
+    count = channel_counts[edge.src]
+    return count * widths[edge.src] if count > 1 else 0
+
+
+def _insert_transposes(graph, layouts, channel_counts, widths):
+
+    """
+    Inserts a transpose on each multichannel edge of a graph whose
+    endpoints have different layouts.
+
+    The destinations of a block output that need the same conversion
+    share one transpose.
+    """
+
+    transposes = {}
+    edges = []
+
+    for e in graph.edges:
+
+        if layouts[e.src] == layouts[e.dst] or \
+                _get_conversion_cost(e, channel_counts, widths) == 0:
+            edges.append(e)
+            continue
+
+        key = (e.src, e.src_port)
+        path = transposes.get(key)
+
+        if path is None:
+
+            path = _get_transpose_path(graph, e.src, e.src_port)
+            transposes[key] = path
+
+            # A row-major buffer is a `buffersize` by `numChannels`
+            # matrix, and a column-major one the transpose of that.
+            m = widths[e.src]
+            n = channel_counts[e.src]
+            if layouts[e.src] == COL_MAJOR:
+                m, n = n, m
+
+            block = graph.blocks[e.src]
+            graph.add_block(Block(
+                path, 'stranspose', {'M': str(m), 'N': str(n)}, block.scope))
+            layouts[path] = layouts[e.dst]
+            edges.append(Edge(e.src, e.src_port, path, 1))
+
+        edges.append(Edge(path, 1, e.dst, e.dst_port))
+
+    graph.edges = edges
+
+
+def _get_transpose_path(graph, src, src_port):
+
+    path = '{} Transpose {}'.format(src, src_port)
+
+    i = 1
+    while path in graph.blocks:
+        i += 1
+        path = '{} Transpose {} ({})'.format(src, src_port, i)
+
+    return path
+
+
+class _FlowNetwork:
+
+    """Flow network with a minimum cut method."""
+
+
+    def __init__(self):
+        self._capacities = {}
+
+
+    def add_edge(self, u, v, capacity):
+        edges = self._capacities.setdefault(u, {})
+        edges[v] = edges.get(v, 0) + capacity
+        self._capacities.setdefault(v, {}).setdefault(u, 0)
+
+
+    def get_min_cut(self, source, sink):
+
+        """
+        Gets the source side of a minimum cut between the specified
+        nodes, found with the Edmonds-Karp maximum flow algorithm.
+        """
+
+        residual = dict((u, dict(e)) for u, e in self._capacities.items())
+        residual.setdefault(source, {})
+        residual.setdefault(sink, {})
+
+        while True:
+
+            parents = self._find_path(residual, source, sink)
+
+            if sink not in parents:
+                return set(parents) - {source}
+
+            # Find bottleneck capacity of path.
+            flow = float('inf')
+            v = sink
+            while v is not source:
+                u = parents[v]
+                flow = min(flow, residual[u][v])
+                v = u
+
+            # Augment flow along path.
+            v = sink
+            while v is not source:
+                u = parents[v]
+                residual[u][v] -= flow
+                residual[v][u] += flow
+                v = u
+
+
+    def _find_path(self, residual, source, sink):
+
+        """
+        Finds a shortest path from the source toward the sink in a
+        residual network.
+
+        Returns a mapping from each node reached to its parent on the
+        path.
+        """
+
+        parents = {source: None}
+        queue = deque([source])
+
+        while len(queue) != 0 and sink not in parents:
+            u = queue.popleft()
+            for v, capacity in residual[u].items():
+                if capacity > 0 and v not in parents:
+                    parents[v] = u
+                    queue.append(v)
+
+        return parents
@@ -0,0 +1,451 @@
+"""
+Module containing class `Graph`, the block graph of an Old Bird detector
+Simulink model.
+
+A graph is loaded from an .mdl file with the `load_graph` function,
+which parses the file with the `convert_mdl_file_to_json` module and
+flattens the model's subsystems. The blocks of the graph are the leaf
+blocks of the model, i.e. the blocks that are not subsystems and not the
+input and output ports of subsystems, and the edges of the graph are the
+connections between leaf blocks implied by the model's lines, their
+branches, and its subsystem ports.
+
+The parameters of a block are kept as the MATLAB expressions of the
+.mdl file. They are evaluated on demand with the `Block.evaluate`
+method, in the scope of the mask variables of the block's enclosing
+masked subsystems. Only the small subset of MATLAB expression syntax
+that occurs in the Old Bird models is supported.
+"""
+
+
+from collections import namedtuple
+import copy
+import math
+import re
+
+import numpy as np
+
+from convert_mdl_file_to_json import parse, scan
+from old_bird_detector_redux_1_1 import _firls
+
+
+Edge = namedtuple('Edge', ('src', 'src_port', 'dst', 'dst_port'))
+"""
+Connection from output port `src_port` of block `src` to input port
+`dst_port` of block `dst`. Blocks are identified by path and ports are
+numbered from one, as in .mdl files.
+"""
+
+
+_GENERIC_BLOCK_KEYS = frozenset([
+    'BlockType', 'Name', 'Ports', 'Position', 'SourceBlock', 'SourceType',
+    'FunctionName', 'Parameters', 'PortCounts', 'SFunctionModules',
+    'Orientation', 'ForegroundColor', 'BackgroundColor', 'DropShadow',
+    'NamePlacement', 'ShowName', 'ShowPortLabels', 'System'])
+"""keys of .mdl file blocks that are not block parameters."""
+
+_S_FUNCTION_PARAMETER_NAMES = {
+    'sclipnsave': (
+        'buffersize', 'fifosize', 'numChannels', 'col_major', 'fname',
+        'saveDir', 'ftype', 'fnamestyle', 'fs'),
+    'stranspose': ('M', 'N'),
+}
+"""
+mapping from S-function names to the names of their parameters, in the
+order of the `Parameters` value of an S-Function block.
+
+The parameters of other S-functions are named `p1`, `p2`, etc.
+"""
+
+
+class Block:
+
+    """Leaf block of a model graph."""
+
+
+    def __init__(self, path, type_, params, scope):
+        self.path = path
+        self.type = type_
+        self.params = params
+        self.scope = scope
+
+
+    @property
+    def name(self):
+        return self.path.rsplit('/', 1)[-1]
+
+
+    def evaluate(self, param_name, default=None):
+
+        """
+        Evaluates the named parameter of this block.
+
+        Returns `default` if the block does not have the parameter.
+        Raises a `ValueError` if the parameter value cannot be
+        evaluated.
+        """
+
+        expression = self.params.get(param_name)
+
+        if expression is None:
+            return default
+        else:
+            return evaluate(expression, self.scope)
+
+
+    def __repr__(self):
+        return 'Block({!r}, {!r})'.format(self.path, self.type)
+
+
+class Graph:
+
+    """
+    Block graph of a Simulink model.
+
+    The blocks of a graph are kept in a dictionary that maps block paths
+    to blocks, in model file order.
+    """
+
+
+    def __init__(self, name):
+        self.name = name
+        self.blocks = {}
+        self.edges = []
+
+
+    def copy(self):
+        return copy.deepcopy(self)
+
+
+    def add_block(self, block):
+        self.blocks[block.path] = block
+
+
+    def remove_block(self, path):
+
+        """Removes the specified block and all of its edges."""
+
+        del self.blocks[path]
+        self.edges = [e for e in self.edges if path not in (e.src, e.dst)]
+
+
+    def get_inputs(self, path):
+
+        """Gets the edges into the specified block, sorted by port."""
+
+        return sorted(
+            (e for e in self.edges if e.dst == path),
+            key=lambda e: e.dst_port)
+
+
+    def get_outputs(self, path):
+
+        """Gets the edges out of the specified block, sorted by port."""
+
+        return sorted(
+            (e for e in self.edges if e.src == path),
+            key=lambda e: e.src_port)
+
+
+    def get_blocks(self, *types):
+
+        """Gets the blocks of this graph of the specified types."""
+
+        return [b for b in self.blocks.values() if b.type in types]
+
+
+def load_graph(file_name, workspace=None):
+
+    """
+    Loads the block graph of the specified .mdl file.
+
+    `workspace` is an optional dictionary of MATLAB workspace variables
+    referenced by the model's top-level parameters.
+    """
+
+    data = parse(scan(file_name))
+    model = data['Model']
+
+    graph = Graph(model['Name'])
+    _add_system(graph, model['System'], '', dict(workspace or {}))
+    _flatten(graph)
+
+    return graph
+
+
+def _add_system(graph, system, prefix, scope):
+
+    for data in system.get('Block', []):
+
+        path = prefix + data['Name']
+        block_type = data['BlockType']
+
+        if block_type == 'SubSystem':
+            block_scope = _get_mask_scope(data, scope)
+            graph.add_block(Block(path, block_type, {}, block_scope))
+            _add_system(graph, data['System'], path + '/', block_scope)
+
+        else:
+            params = _get_block_params(data)
+            graph.add_block(
+                Block(path, _get_block_type(data), params, scope))
+
+    for line in system.get('Line', []):
+        src = prefix + line['SrcBlock']
+        src_port = int(line['SrcPort'])
+        for dst, dst_port in _get_line_destinations(line):
+            graph.edges.append(Edge(src, src_port, prefix + dst, dst_port))
+
+
+def _get_block_type(data):
+
+    block_type = data['BlockType']
+
+    if block_type == 'Reference':
+        return data['SourceType']
+    elif block_type == 'S-Function':
+        return data['FunctionName']
+    else:
+        return block_type
+
+
+def _get_block_params(data):
+
+    params = dict(
+        (key, value) for key, value in data.items()
+        if key not in _GENERIC_BLOCK_KEYS and not key.startswith('Font'))
+
+    if data['BlockType'] == 'S-Function':
+        args = data.get('Parameters', '').split()
+        names = _S_FUNCTION_PARAMETER_NAMES.get(data['FunctionName'])
+        if names is None:
+            names = ['p{}'.format(i + 1) for i in range(len(args))]
+        params.update(zip(names, args))
+
+    return params
+
+
+def _get_mask_scope(data, scope):
+
+    """
+    Gets the scope of the blocks of a subsystem.
+
+    An unmasked subsystem has the scope of its parent. A masked
+    subsystem has its own scope, comprising its mask variables. The
+    value of a mask variable declared with `@` is its mask value
+    evaluated in the parent scope, or the one-based index of the value
+    for a popup. The value of a variable declared with `&` is its mask
+    value string. A variable whose mask value cannot be evaluated is
+    left undefined, so that parameters that reference it cannot be
+    evaluated either.
+    """
+
+    variables = data.get('MaskVariables')
+
+    if variables is None:
+        return scope
+
+    values = data.get('MaskValueString', '').split('|')
+    styles = data.get('MaskStyleString', '').split(',')
+
+    mask_scope = {}
+
+    for declaration in variables.split(';'):
+
+        if declaration == '':
+            continue
+
+        name, spec = declaration.split('=')
+        i = int(spec[1:]) - 1
+        value = values[i] if i < len(values) else ''
+        style = _get_popup_style(styles, i)
+
+        if spec[0] == '&':
+            mask_scope[name] = value
+
+        elif style is not None and value in _get_popup_options(style):
+            mask_scope[name] = _get_popup_options(style).index(value) + 1
+
+        else:
+            try:
+                mask_scope[name] = evaluate(value, scope)
+            except ValueError:
+                pass
+
+    return mask_scope
+
+
+def _get_popup_style(styles, i):
+
+    # The options of a popup style are separated by `|`, like the
+    # values of a mask value string, but styles are separated by
+    # commas, and no option of the Old Bird models contains a comma.
+    if i < len(styles) and styles[i].startswith('popup('):
+        return styles[i]
+    else:
+        return None
+
+
+def _get_popup_options(style):
+    return style[len('popup('):-1].split('|')
+
+
+def _get_line_destinations(line):
+
+    if 'DstBlock' in line:
+        yield line['DstBlock'], int(line['DstPort'])
+
+    for branch in line.get('Branch', []):
+        yield from _get_line_destinations(branch)
+
+
+def _flatten(graph):
+
+    """
+    Flattens a graph by replacing the edges to and from subsystems,
+    subsystem ports, and Goto and From blocks with edges between leaf
+    blocks.
+    """
+
+    subsystems = set(
+        b.path for b in graph.blocks.values() if b.type == 'SubSystem')
+
+    def is_port(path):
+        block = graph.blocks[path]
+        return block.type in ('Inport', 'Outport') and \
+            _get_parent(path) in subsystems
+
+    def is_leaf(path):
+        return path not in subsystems and not is_port(path) and \
+            graph.blocks[path].type not in ('Goto', 'From')
+
+    def find_goto(from_path):
+
+        # Prefer a Goto block in the same system as the From block.
+        tag = graph.blocks[from_path].params.get('GotoTag')
+        parent = _get_parent(from_path)
+        gotos = [
+            b.path for b in graph.get_blocks('Goto')
+            if b.params.get('GotoTag') == tag]
+        gotos.sort(key=lambda path: _get_parent(path) != parent)
+
+        return gotos[0] if len(gotos) != 0 else None
+
+    def find_port(subsystem, port_type, port):
+        for block in graph.blocks.values():
+            if block.type == port_type and \
+                    _get_parent(block.path) == subsystem and \
+                    int(block.params['Port']) == port:
+                return block.path
+        return None
+
+    def find_source(dst, dst_port):
+        for e in graph.edges:
+            if e.dst == dst and e.dst_port == dst_port:
+                return resolve_source(e.src, e.src_port)
+        return None
+
+    def resolve_source(src, src_port):
+
+        if src in subsystems:
+            outport = find_port(src, 'Outport', src_port)
+            return None if outport is None else find_source(outport, 1)
+
+        elif is_port(src):
+            port = int(graph.blocks[src].params['Port'])
+            return find_source(_get_parent(src), port)
+
+        elif graph.blocks[src].type == 'From':
+            goto = find_goto(src)
+            return None if goto is None else find_source(goto, 1)
+
+        else:
+            return src, src_port
+
+    edges = []
+    for e in graph.edges:
+        if is_leaf(e.dst):
+            source = resolve_source(e.src, e.src_port)
+            if source is not None:
+                edges.append(Edge(source[0], source[1], e.dst, e.dst_port))
+
+    graph.edges = edges
+
+    for path in [p for p in graph.blocks if not is_leaf(p)]:
+        del graph.blocks[path]
+
+
+def _get_parent(path):
+    return path.rsplit('/', 1)[0] if '/' in path else None
+
+
+def evaluate(expression, scope):
+
+    """
+    Evaluates a MATLAB expression of an .mdl file in the specified
+    scope.
+
+    Raises a `ValueError` if the expression cannot be evaluated.
+    """
+
+    namespace = dict(_FUNCTIONS)
+    namespace.update(scope)
+
+    try:
+        return eval(_translate(expression), {'__builtins__': {}}, namespace)
+    except Exception as e:
+        raise ValueError(
+            'Could not evaluate MATLAB expression "{}": {}'.format(
+                expression, e))
+
+
+def _translate(expression):
+
+    """
+    Translates a MATLAB expression to Python.
+
+    Elements of bracketed arrays may be separated by commas or by
+    whitespace, but whitespace separators are only recognized outside
+    of parentheses and not adjacent to binary operators.
+    """
+
+    def translate_array(match):
+        text = match.group(1).strip()
+        text = re.sub(r'\s*([-+*/^])\s*', r'\1', text)
+        items = [s for s in re.split(r'[\s,]+', text) if s != '']
+        return '_array([{}])'.format(', '.join(items))
+
+    expression = expression.replace('^', '**')
+    return re.sub(r'\[([^\[\]]*)\]', translate_array, expression)
+
+
+def _round(x):
+    # MATLAB's `round` rounds halves away from zero.
+    return np.sign(x) * np.floor(np.abs(x) + .5) if isinstance(x, np.ndarray) \
+        else math.copysign(math.floor(abs(x) + .5), x)
+
+
+def _fix(x):
+    return np.fix(x) if isinstance(x, np.ndarray) else float(math.trunc(x))
+
+
+def _matlab_firls(order, bands, desired):
+    # MATLAB's `firls` takes a filter order rather than a length.
+    return _firls(
+        int(order) + 1, np.array(bands, dtype='float'),
+        np.array(desired, dtype='float'))
+
+
+_FUNCTIONS = {
+    '_array': lambda items: np.array(items, dtype='float'),
+    'ceil': np.ceil,
+    'eps': np.finfo('float').eps,
+    'firls': _matlab_firls,
+    'fix': _fix,
+    'floor': np.floor,
+    'Inf': math.inf,
+    'inf': math.inf,
+    'pi': math.pi,
+    'round': _round,
+}
+"""MATLAB functions and constants supported by `evaluate`."""
@@ -0,0 +1,216 @@
+"""
+Module containing class `MultiDetector`, which runs several redux Old
+Bird detectors (e.g. Tseep and Thrush) in one pass over shared input.
+
+Running the detectors separately on the same input converts and buffers
+the input once per detector, and resamples it once per detector if it
+needs resampling. A multi-detector does all of that once. Its front end
+keeps a single history of recent input samples, long enough for the
+longest detector filter, and runs all of the detector filters of the
+same length as one two-dimensional convolution, so that the Fourier
+transform of the input is computed once for all of them. Only the stages
+that follow the filters (the squarer, integrator, and divider, and the
+series processing stages after them) are instantiated per detector.
+
+The clips detected by each detector of a multi-detector are the same as
+those the detector would detect alone.
+"""
+
+
+import numpy as np
+import scipy.signal as signal
+
+from old_bird_detector_redux_1_1 import (
+    _OLD_FS, _Detector, _FirFilter, _SignalProcessorChain, _THRUSH_SETTINGS,
+    _TSEEP_SETTINGS)
+from resampler import Resampler
+
+
+DETECTOR_SETTINGS = {
+    'Tseep': _TSEEP_SETTINGS,
+    'Thrush': _THRUSH_SETTINGS,
+}
+"""settings of the named redux detectors."""
+
+
+class MultiDetector:
+
+    """
+    Several redux detectors that share their input.
+
+    The `detect` and `complete_detection` methods of this class are like
+    those of the `_Detector` class of the `old_bird_detector_redux_1_1`
+    module, but the listener's `process_clip` method must accept three
+    arguments, the detector number (i.e. the index of the detector's
+    settings in `settings_list`), start index, and length of a detected
+    clip.
+
+    If `resample` is true, the input is resampled to 22050 hertz once
+    for all of the detectors, as by the detectors of the
+    `resampling_detector` module, and clip start indices and lengths
+    are converted back to the input sample rate.
+    """
+
+
+    def __init__(self, settings_list, sample_rate, listener, resample=False):
+
+        self._sample_rate = sample_rate
+        self._listener = listener
+
+        if resample:
+            self._resampler = Resampler(sample_rate, _OLD_FS)
+            detector_sample_rate = _OLD_FS
+        else:
+            self._resampler = None
+            detector_sample_rate = sample_rate
+
+        self._detectors = [
+            _BandDetector(s, detector_sample_rate, _ClipRelay(self, i))
+            for i, s in enumerate(settings_list)]
+
+        # Group detectors by filter length.
+        groups = {}
+        for detector in self._detectors:
+            groups.setdefault(len(detector.coefficients), []).append(detector)
+        self._filter_groups = [
+            _FilterGroup(detectors) for _, detectors in sorted(groups.items())]
+
+        self._history_length = max(
+            g.coefficients.shape[1] for g in self._filter_groups) - 1
+        self._recent_samples = np.array([], dtype='float')
+        self._num_samples_processed = 0
+
+
+    @property
+    def sample_rate(self):
+        return self._sample_rate
+
+
+    @property
+    def settings(self):
+        return [d.settings for d in self._detectors]
+
+
+    def detect(self, samples):
+
+        if self._resampler is not None:
+            samples = self._resampler.resample(samples)
+
+        x = np.concatenate((self._recent_samples, samples))
+
+        # Index of `x[0]` in the detector input.
+        offset = self._num_samples_processed - len(self._recent_samples)
+
+        total = self._num_samples_processed + len(samples)
+
+        for group in self._filter_groups:
+            group.process(x, offset, total)
+
+        self._recent_samples = x[max(len(x) - self._history_length, 0):]
+        self._num_samples_processed = total
+
+
+    def complete_detection(self):
+
+        """
+        Completes detection after the `detect` method has been called
+        for all input.
+        """
+
+        for detector in self._detectors:
+            detector.complete_detection()
+
+
+    def _process_clip(self, detector_num, start_index, length):
+
+        if self._resampler is not None:
+            get_index = self._resampler.get_input_index
+            end_index = get_index(start_index + length)
+            start_index = get_index(start_index)
+            length = end_index - start_index
+
+        self._listener.process_clip(detector_num, start_index, length)
+
+
+class _FilterGroup:
+
+    """Detectors whose filters have the same length."""
+
+
+    def __init__(self, detectors):
+
+        self._detectors = detectors
+        self.coefficients = np.array([d.coefficients for d in detectors])
+
+        # Index of the detector input sample that corresponds to the
+        # next filter output sample.
+        self._next_index = self.coefficients.shape[1] - 1
+
+
+    def process(self, x, offset, total):
+
+        filter_length = self.coefficients.shape[1]
+        start = self._next_index - (filter_length - 1)
+
+        if total - start < filter_length:
+            # don't yet have enough samples for a filter output
+            return
+
+        x = x[np.newaxis, start - offset:]
+        y = signal.fftconvolve(x, self.coefficients, mode='valid', axes=1)
+
+        for detector, samples in zip(self._detectors, y):
+            detector.detect(samples)
+
+        self._next_index = total
+
+
+class _BandDetector(_Detector):
+
+    """
+    Redux detector whose input has already been filtered.
+
+    The detector's sample count starts at the latency of its filter, so
+    that the indices of its clips are those of the unfiltered input.
+    """
+
+
+    def __init__(self, settings, sample_rate, listener):
+        super().__init__(settings, sample_rate, listener)
+        self._num_samples_processed = len(self.coefficients) - 1
+
+
+    def _create_signal_processor(self):
+
+        chain = super()._create_signal_processor()
+
+        fir_filter = chain._processors[0]
+        assert isinstance(fir_filter, _FirFilter)
+        self.coefficients = fir_filter._coefficients
+
+        # The latency of the returned chain excludes that of the filter,
+        # which the initial sample count accounts for.
+        return _SignalProcessorChain(chain._processors[1:])
+
+
+class _ClipRelay:
+
+
+    def __init__(self, detector, detector_num):
+        self._detector = detector
+        self._detector_num = detector_num
+
+
+    def process_clip(self, start_index, length):
+        self._detector._process_clip(self._detector_num, start_index, length)
+
+
+def create_detector(detector_names, sample_rate, listener, resample=False):
+
+    """
+    Creates a multi-detector that runs the named detectors, e.g.
+    `['Tseep', 'Thrush']`.
+    """
+
+    settings_list = [DETECTOR_SETTINGS[name] for name in detector_names]
+    return MultiDetector(settings_list, sample_rate, listener, resample)
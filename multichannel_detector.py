@@ -0,0 +1,179 @@
+"""
+Module containing multichannel versions of the redux Old Bird detectors.
+
+A multichannel detector processes all of the channels of its input
+together. Its input is a two-dimensional NumPy array of shape
+`(num_frames, num_channels)` in which the samples of each frame (i.e.
+the samples of all channels at one sample time) are contiguous. This is
+the interleaved, or array-of-structures, layout in which multichannel
+audio files and devices deliver their samples, so the input needs no
+transposition. Each signal processing stage (the FIR filter, squarer,
+integrator, and divider, as well as the threshold comparisons that
+follow them) is a single NumPy operation along the first axis of its
+input, so that one pass of the stage advances all channels at once
+rather than looping over channels in Python.
+
+The series processing stages of the detector (the transient finder,
+which plays the role of the original detector's pulse-limited flip flop
+and counter, and the stages after it) operate on sparse threshold
+crossings rather than samples, so they are instantiated per channel.
+"""
+
+
+import numpy as np
+import scipy.signal as signal
+
+from old_bird_detector_redux_1_1 import (
+    _Detector, _FirFilter, _SeriesProcessor, _SignalProcessorChain,
+    _THRUSH_SETTINGS, _TSEEP_SETTINGS)
+
+
+class _MultichannelDetector(_Detector):
+
+    """
+    Multichannel reimplementation of Old Bird transient detector.
+
+    This class is like the `_Detector` class, except that its `detect`
+    method takes a two-dimensional array of shape
+    `(num_frames, num_channels)`, and its listener's `process_clip`
+    method must accept three arguments, the channel number, start index,
+    and length of a detected clip. The clips detected for each channel
+    are the same as those that a `_Detector` would detect for that
+    channel alone.
+    """
+
+
+    def __init__(self, settings, sample_rate, num_channels, listener):
+
+        self._num_channels = num_channels
+
+        super().__init__(settings, sample_rate, listener)
+
+        self._recent_samples = np.zeros((0, num_channels))
+
+
+    def _create_signal_processor(self):
+
+        # Replace FIR filters of single-channel signal processor chain
+        # with multichannel ones. The other signal processors operate
+        # along the first axis of their input and so work for both
+        # one- and two-dimensional input.
+        chain = super()._create_signal_processor()
+        processors = [
+            _MultichannelFirFilter(p._coefficients)
+            if isinstance(p, _FirFilter) else p
+            for p in chain._processors]
+
+        return _SignalProcessorChain(processors)
+
+
+    def _create_series_processor(self):
+        processors = [
+            super(_MultichannelDetector, self)._create_series_processor()
+            for _ in range(self._num_channels)]
+        return _MultichannelSeriesProcessor(processors)
+
+
+    @property
+    def num_channels(self):
+        return self._num_channels
+
+
+    def _get_threshold_crossings(self, ratios, offset):
+
+        # Add one to index offset to compensate for processing latency
+        # of this method.
+        offset += 1
+
+        x0 = ratios[:-1]
+        x1 = ratios[1:]
+
+        t = self.settings.ratio_threshold
+        rises = (x0 <= t) & (x1 > t)
+
+        t = 1 / t
+        falls = (x0 >= t) & (x1 < t)
+
+        # Find crossings of all channels at once, and then split them
+        # by channel. `np.nonzero` returns indices in row-major order,
+        # so we transpose to get them grouped by channel and sorted
+        # by sample index within each channel.
+        crossings = rises | falls
+        channel_nums, indices = np.nonzero(crossings.T)
+        is_rise = rises.T[channel_nums, indices]
+        indices = indices + offset
+
+        splits = np.searchsorted(channel_nums, np.arange(1, self.num_channels))
+
+        return [
+            list(zip(i.tolist(), r.tolist()))
+            for i, r in zip(
+                np.split(indices, splits), np.split(is_rise, splits))]
+
+
+    def _notify_listener(self, clip_lists):
+        for channel_num, clips in enumerate(clip_lists):
+            for start_index, length in clips:
+                self._listener.process_clip(channel_num, start_index, length)
+
+
+    def complete_detection(self):
+
+        """
+        Completes detection after the `detect` method has been called
+        for all input.
+        """
+
+        fall = (self._num_samples_processed, False)
+        falls = [[fall]] * self.num_channels
+        clip_lists = self._series_processor.complete_processing(falls)
+        self._notify_listener(clip_lists)
+
+
+class _MultichannelFirFilter(_FirFilter):
+
+
+    def process(self, x):
+        coefficients = self._coefficients[:, np.newaxis]
+        return signal.fftconvolve(x, coefficients, mode='valid', axes=0)
+
+
+class _MultichannelSeriesProcessor(_SeriesProcessor):
+
+    """
+    Series processor comprising one series processor per channel.
+
+    The `process` and `complete_processing` methods of this class take
+    and return lists of per-channel item lists.
+    """
+
+
+    def __init__(self, processors):
+        self._processors = processors
+
+
+    def process(self, item_lists):
+        return [
+            p.process(items)
+            for p, items in zip(self._processors, item_lists)]
+
+
+    def complete_processing(self, item_lists):
+        return [
+            p.complete_processing(items)
+            for p, items in zip(self._processors, item_lists)]
+
+
+class MultichannelTseepDetector(_MultichannelDetector):
+
+
+    def __init__(self, sample_rate, num_channels, listener):
+        super().__init__(_TSEEP_SETTINGS, sample_rate, num_channels, listener)
+
+
+class MultichannelThrushDetector(_MultichannelDetector):
+
+
+    def __init__(self, sample_rate, num_channels, listener):
+        super().__init__(
+            _THRUSH_SETTINGS, sample_rate, num_channels, listener)
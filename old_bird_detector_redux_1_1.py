@@ -285,26 +285,8 @@ class _Detector:
             
             
     def _get_threshold_crossings(self, ratios, offset):
-    
-        # Add one to index offset to compensate for processing latency
-        # of this method.
-        offset += 1
-        
-        x0 = ratios[:-1]
-        x1 = ratios[1:]
-        
-        # Find indices where ratio rises above threshold.
-        t = self.settings.ratio_threshold
-        rise_indices = np.where((x0 <= t) & (x1 > t))[0] + offset
-        
-        # Find indices where ratio falls below threshold inverse.
-        t = 1 / t
-        fall_indices = np.where((x0 >= t) & (x1 < t))[0] + offset
-
-        # Tag rises and falls with booleans, combine, and sort.
-        return sorted(
-            [(i, True) for i in rise_indices] +
-            [(i, False) for i in fall_indices])
+        return _get_threshold_crossings(
+            ratios, self.settings.ratio_threshold, offset)
     
     
     def _notify_listener(self, clips):
@@ -343,6 +325,29 @@ class _Detector:
 #             f.write(text)
         
 
+def _get_threshold_crossings(ratios, threshold, offset):
+
+    # Add one to index offset to compensate for processing latency
+    # of this function.
+    offset += 1
+    
+    x0 = ratios[:-1]
+    x1 = ratios[1:]
+    
+    # Find indices where ratio rises above threshold.
+    t = threshold
+    rise_indices = np.where((x0 <= t) & (x1 > t))[0] + offset
+    
+    # Find indices where ratio falls below threshold inverse.
+    t = 1 / t
+    fall_indices = np.where((x0 >= t) & (x1 < t))[0] + offset
+
+    # Tag rises and falls with booleans, combine, and sort.
+    return sorted(
+        [(i, True) for i in rise_indices] +
+        [(i, False) for i in fall_indices])
+
+
 class _SignalProcessor:
     
     
@@ -652,44 +657,93 @@ class _ClipMerger(_SeriesProcessor):
         
 class _ClipSuppressor(_SeriesProcessor):
     
+    """
+    Suppresses clips that start too frequently.
+    
+    This processor plays the role of the Overload Check Valve of the
+    original Old Bird detectors. It suppresses a clip if it is the last
+    of `count_threshold` clips that started within fewer than `period`
+    samples of each other.
+    """
+    
     
     def __init__(self, count_threshold, period):
-        self._count_threshold = count_threshold
-        self._period = period
-        self._recent_start_indices = []
+        self._rate_limiter = _EventRateLimiter(count_threshold, period)
         
         
     def process(self, clips):
         
-        unsuppressed_clips = []
+        is_allowed = self._rate_limiter.is_allowed
         
-        indices = self._recent_start_indices
-             
-        for start_index, length in clips:
-            
-            # Remember clip.
-            indices.append(start_index)
-             
-            # Discard oldest clip if there are more than count threshold.
-            if len(indices) > self._count_threshold:
-                indices.pop(0)
-                 
-            if len(indices) == self._count_threshold:
-                # have enough clips to test for suppression
-                 
-                delta = (indices[-1] - indices[0])
-                 
-                if delta < self._period:
-                    # got more than `self._count_threshold` clips in the
-                    # last `self._period` samples
-                     
-                    # Suppress clip.
-                    continue
-                 
-            # If we get here, the clip was not suppressed.
-            unsuppressed_clips.append((start_index, length))
+        return [
+            (start_index, length) for start_index, length in clips
+            if is_allowed(start_index)]
+        
+        
+class _EventRateLimiter:
+    
+    """
+    Event rate limiter.
+    
+    A rate limiter disallows an event if it is the last of `count`
+    events that occurred within fewer than `period` time units (e.g.
+    sample periods) of each other. Disallowed events count towards
+    the limit just as allowed ones do.
+    
+    The limiter keeps the times of the most recent `count` events in
+    a ring buffer, so it takes constant time per event regardless of
+    `count`, and no time at all between events.
+    """
+    
+    
+    def __init__(self, count, period):
+        
+        if count < 1:
+            raise ValueError('Rate limiter event count must be positive.')
+        
+        self._count = count
+        self._period = period
+        
+        # times of most recent `count` events, in a ring
+        self._times = [0] * count
+        
+        # index in `self._times` of oldest event time, i.e. of slot to
+        # which to write next event time
+        self._oldest = 0
+        
+        # number of events so far, up to `count`
+        self._num_events = 0
+        
+        
+    def is_allowed(self, time):
+        
+        """
+        Records an event at the specified time and returns whether or
+        not it is allowed.
+        
+        Event times must be nondecreasing.
+        """
+        
+        times = self._times
+        i = self._oldest
+        
+        times[i] = time
+        
+        i += 1
+        if i == self._count:
+            i = 0
+        self._oldest = i
+        
+        if self._num_events < self._count:
+            self._num_events += 1
+            if self._num_events < self._count:
+                # haven't yet seen `count` events
+                
+                return True
             
-        return unsuppressed_clips
+        # If we get here, `times[i]` is the time of the event `count - 1`
+        # events before this one.
+        return time - times[i] >= self._period
         
         
 _BUFFER_SIZE = 8192
@@ -0,0 +1,209 @@
+"""
+Module containing function that runs a redux detector on segments of its
+input in parallel.
+
+The input is divided into consecutive segments that are processed by a
+pool of worker processes. Each worker runs the signal processing stages
+of the detector (the FIR filter, squarer, integrator, and divider) on its
+segment, and finds the threshold crossings of the resulting ratio signal.
+The crossings of all segments are then concatenated in segment order and
+run serially through the series processing stages of the detector (the
+transient finder, clip extender, merger, suppressor, etc.).
+
+The signal processing stages have finite memory: each ratio depends only
+on the `latency + 1` samples ending at it. Each segment is therefore
+primed by prepending a warm-up prefix comprising the `latency + 1`
+samples that precede it, so that the ratios it computes and the
+threshold crossings it finds (including a crossing that straddles the
+start of the segment) are exactly those of a serial run. The series
+processing stages have unbounded memory (the clip suppressor, for
+example, remembers clips for twenty seconds, and a transient can remain
+in its holding state indefinitely), but they process only threshold
+crossings, of which there are very few compared to samples. We run them
+serially over the stitched crossings rather than warming them up, which
+makes the clips output by this module equal to those of a serial run by
+construction.
+"""
+
+
+from concurrent.futures import ProcessPoolExecutor
+from multiprocessing import shared_memory
+import os
+
+import numpy as np
+
+from old_bird_detector_redux_1_1 import ThrushDetector, TseepDetector
+
+
+_SEGMENT_DURATION = 600
+"""
+the maximum duration of a segment, in seconds.
+
+The segments are smaller than this if needed to give each worker
+process at least one segment.
+"""
+
+_MIN_SEGMENT_DURATION = 10
+"""the minimum duration of a segment, in seconds."""
+
+
+def detect(samples, settings, num_workers=None):
+
+    """
+    Runs the Old Bird detector reimplementation on the specified samples,
+    processing segments of the samples in parallel.
+
+    The clips detected are the same as those detected by running the
+    detector serially, i.e. by `new_detector_1_1.detect`.
+    """
+
+    cls = _get_detector_class(settings.detector_name)
+    sample_rate = settings.sample_rate
+
+    if num_workers is None:
+        num_workers = os.cpu_count()
+
+    listener = _Listener()
+    detector = cls(sample_rate, listener)
+    latency = detector._signal_processor.latency
+
+    num_samples = len(samples)
+    num_ratios = num_samples - latency
+
+    if num_ratios > 1:
+
+        bounds = _get_segment_bounds(num_ratios, sample_rate, num_workers)
+
+        if len(bounds) == 1 or num_workers == 1:
+            crossing_lists = _find_crossings_serially(
+                cls, sample_rate, samples, bounds, latency)
+        else:
+            crossing_lists = _find_crossings_in_parallel(
+                cls, sample_rate, samples, bounds, latency, num_workers)
+
+        for crossings in crossing_lists:
+            clips = detector._series_processor.process(crossings)
+            detector._notify_listener(clips)
+
+    detector._num_samples_processed = num_samples
+    detector.complete_detection()
+
+    return listener.clips
+
+
+def _get_detector_class(detector_name):
+    if detector_name == 'Thrush':
+        return ThrushDetector
+    else:
+        return TseepDetector
+
+
+def _get_segment_bounds(num_ratios, sample_rate, num_workers):
+
+    """
+    Gets the bounds of the segments of the ratio signal that are to
+    be processed by the workers.
+
+    The segments partition the index range `[0, num_ratios)` of the
+    ratio signal.
+    """
+
+    max_length = int(round(_SEGMENT_DURATION * sample_rate))
+    min_length = int(round(_MIN_SEGMENT_DURATION * sample_rate))
+
+    length = int(np.ceil(num_ratios / num_workers))
+    length = max(min(length, max_length), min_length)
+
+    starts = list(range(0, num_ratios, length))
+    ends = starts[1:] + [num_ratios]
+
+    return list(zip(starts, ends))
+
+
+def _find_crossings_serially(cls, sample_rate, samples, bounds, latency):
+    return [
+        _find_segment_crossings(cls, sample_rate, samples, start, end, latency)
+        for start, end in bounds]
+
+
+def _find_crossings_in_parallel(
+        cls, sample_rate, samples, bounds, latency, num_workers):
+
+    # Share samples with workers via shared memory rather than pickling
+    # a copy of each segment for each task.
+    samples = np.asarray(samples)
+    memory = shared_memory.SharedMemory(create=True, size=samples.nbytes)
+
+    try:
+
+        shared_samples = np.ndarray(
+            samples.shape, dtype=samples.dtype, buffer=memory.buf)
+        shared_samples[:] = samples
+        del shared_samples
+
+        samples_info = (memory.name, samples.shape, samples.dtype.str)
+
+        with ProcessPoolExecutor(num_workers) as executor:
+            futures = [
+                executor.submit(
+                    _find_shared_segment_crossings, cls, sample_rate,
+                    samples_info, start, end, latency)
+                for start, end in bounds]
+            return [f.result() for f in futures]
+
+    finally:
+        memory.close()
+        memory.unlink()
+
+
+def _find_shared_segment_crossings(
+        cls, sample_rate, samples_info, start, end, latency):
+
+    name, shape, dtype = samples_info
+    memory = shared_memory.SharedMemory(name=name)
+
+    try:
+        samples = np.ndarray(shape, dtype=dtype, buffer=memory.buf)
+        crossings = _find_segment_crossings(
+            cls, sample_rate, samples, start, end, latency)
+        del samples
+        return crossings
+    finally:
+        memory.close()
+
+
+def _find_segment_crossings(cls, sample_rate, samples, start, end, latency):
+
+    """
+    Finds the threshold crossings of one segment of the ratio signal.
+
+    Ratio `i` is computed from samples `[i, i + latency + 1)`. A threshold
+    crossing is found between each pair of consecutive ratios, so in
+    addition to ratios `[start, end)` we compute the ratio that precedes
+    the segment (if there is one), which yields the crossing between the
+    previous segment and this one.
+    """
+
+    if start > 0:
+        start -= 1
+
+    detector = cls(sample_rate, _Listener())
+
+    # Copy samples since the divider modifies its input in place.
+    x = np.array(samples[start:end + latency], dtype='float')
+
+    ratios = detector._signal_processor.process(x)
+
+    # See `_Detector.detect` for the derivation of this offset.
+    offset = start + latency + 1
+
+    return detector._get_threshold_crossings(ratios, offset)
+
+
+class _Listener:
+
+    def __init__(self):
+        self.clips = []
+
+    def process_clip(self, start_index, length):
+        self.clips.append((start_index, length))
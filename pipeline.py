@@ -0,0 +1,551 @@
+"""
+Module containing class `Pipeline`, which runs an Old Bird Simulink
+model without Simulink.
+
+A pipeline is compiled from the block graph of a model (see the
+`mdl_graph` module) as follows:
+
+1. The layouts of the graph's multichannel blocks are chosen, and
+   redundant transposes eliminated, by the `layout_pass` module.
+
+2. Blocks that do not contribute to the results of the model, i.e. to
+   its Clip & Save blocks and output ports, are pruned. This removes
+   scopes, log files, and stop controls, which have no place in a
+   pipeline.
+
+3. Integrate blocks that integrate the same signal with the same
+   settings other than their integration times are merged into one
+   multiple-output integrator, which keeps one history for all of
+   them.
+
+4. The remaining blocks are scheduled in a topological order of the
+   graph, so that each block runs after the blocks that feed it.
+
+5. Each block is replaced by a kernel from the `pipeline_kernels`
+   module, created with the values of its parameters as constants, and
+   a buffer is allocated for each block output.
+
+The pipeline is statically wired: each step of a pipeline calls the
+kernels of its schedule in order with fixed lists of input and output
+buffers. The model's audio source is replaced by the input of the
+pipeline's `process` method, and Clip & Save blocks report clips to a
+listener rather than saving them to files.
+
+All kernel states and buffers of a pipeline are allocated from its
+arena (see the `arena` module) in execution order, and are freed
+together when the pipeline is closed.
+"""
+
+
+from collections import deque
+
+import numpy as np
+
+from arena import Arena
+from layout_pass import propagate_layouts
+from mdl_graph import Block, Edge, load_graph
+import pipeline_kernels as kernels
+
+
+class Pipeline:
+
+    """
+    Compiled Old Bird Simulink model.
+
+    The `process` method of a pipeline can be called repeatedly with
+    consecutive sample arrays. Samples are processed a buffer at a time,
+    and samples that do not fill a buffer are retained until they do.
+    """
+
+
+    def __init__(self, graph, listener=None, arena=None, share_buffers=True):
+
+        graph = propagate_layouts(graph)
+        graph = _prune(graph)
+        graph = _merge_integrators(graph)
+        schedule = _schedule(graph)
+
+        self._graph = graph
+        self._listener = listener
+        self._arena = Arena() if arena is None else arena
+        self.outputs = {}
+
+        context = _Context(self)
+        buffers = _BufferAllocator(graph, schedule, self, share_buffers)
+
+        self._kernels = {}
+        self._buffers = {}
+        self._steps = []
+
+        for i, path in enumerate(schedule):
+
+            block = graph.blocks[path]
+            cls = kernels.KERNEL_CLASSES.get(block.type)
+            if cls is None:
+                raise ValueError(
+                    'Block "{}" has unsupported type "{}".'.format(
+                        path, block.type))
+
+            inputs = self._get_input_buffers(graph, path)
+            input_widths = [len(b) for b in inputs]
+
+            kernel = cls(block, input_widths, context)
+            outputs = buffers.allocate_outputs(i, kernel)
+
+            self._kernels[path] = kernel
+            for j, buffer in enumerate(outputs):
+                self._buffers[(path, j + 1)] = buffer
+
+            if not (kernel.pass_through and share_buffers):
+                self._steps.append((kernel, inputs, outputs))
+
+            buffers.release(i)
+
+        self._num_buffers = buffers.num_buffers
+        self._source = self._get_source(graph)
+        self._pending = np.zeros((0, self._source.num_channels))
+        self._num_samples_processed = 0
+
+
+    def allocate(self, shape, dtype='float64'):
+
+        """Allocates a zeroed array from the pipeline's arena."""
+
+        return self._arena.allocate(shape, dtype)
+
+
+    def _get_input_buffers(self, graph, path):
+
+        edges = graph.get_inputs(path)
+
+        for i, e in enumerate(edges):
+            if e.dst_port != i + 1:
+                raise ValueError(
+                    'Input {} of block "{}" is not connected.'.format(
+                        i + 1, path))
+
+        return [self._buffers[(e.src, e.src_port)] for e in edges]
+
+
+    def _get_source(self, graph):
+
+        sources = [
+            self._kernels[b.path]
+            for b in graph.get_blocks(*kernels.SOURCE_TYPES)]
+
+        if len(sources) != 1:
+            raise ValueError(
+                'Model "{}" has {} audio sources rather than one.'.format(
+                    graph.name, len(sources)))
+
+        return sources[0]
+
+
+    @property
+    def graph(self):
+        return self._graph
+
+
+    @property
+    def listener(self):
+        return self._listener
+
+
+    @property
+    def arena(self):
+        return self._arena
+
+
+    @property
+    def kernels(self):
+        return self._kernels
+
+
+    @property
+    def num_buffers(self):
+
+        """
+        The number of distinct buffers between the kernels of this
+        pipeline.
+        """
+
+        return self._num_buffers
+
+
+    @property
+    def buffer_size(self):
+        return self._source.buffer_size
+
+
+    @property
+    def num_channels(self):
+        return self._source.num_channels
+
+
+    @property
+    def num_samples_processed(self):
+        return self._num_samples_processed
+
+
+    @property
+    def num_samples_received(self):
+
+        """
+        The number of samples passed to the `process` method of this
+        pipeline, i.e. the position in its input at which to continue.
+
+        This includes the samples that the pipeline holds until they fill
+        a buffer, so it may exceed `num_samples_processed`.
+        """
+
+        return self._num_samples_processed + len(self._pending)
+
+
+    def process(self, samples):
+
+        """
+        Processes the specified samples.
+
+        The samples are a one-dimensional array for single-channel input,
+        or a two-dimensional array with one column per channel.
+        """
+
+        samples = np.asarray(samples, dtype='float64')
+        if samples.ndim == 1:
+            samples = samples[:, np.newaxis]
+
+        samples = np.concatenate((self._pending, samples))
+        n = self.buffer_size
+        num_buffers = len(samples) // n
+
+        for i in range(num_buffers):
+            self._write_source(samples[i * n:(i + 1) * n])
+            self.step()
+
+        self._pending = samples[num_buffers * n:]
+
+
+    def _write_source(self, samples, output=None):
+
+        source = self._source
+
+        if output is None:
+            output = self._buffers[(source.block.path, 1)]
+
+        if source.layout == kernels.COL_MAJOR:
+            output[:] = samples.T.reshape(-1)
+        else:
+            output[:] = samples.reshape(-1)
+
+
+    def step(self):
+
+        """
+        Runs the kernels of this pipeline once, on the current contents
+        of the source output buffer.
+        """
+
+        for kernel, inputs, outputs in self._steps:
+            kernel.process(inputs, outputs)
+
+        self._num_samples_processed += self.buffer_size
+
+
+    def close(self):
+
+        """
+        Closes this pipeline, freeing its kernels and its arena.
+
+        A closed pipeline cannot process samples.
+        """
+
+        # Clear rather than replace the kernel dictionary, since kernel
+        # contexts may still refer to it.
+        self._kernels.clear()
+        self._buffers.clear()
+        self._steps.clear()
+        self._source = None
+
+        self._arena.close()
+
+
+class _BufferAllocator:
+
+    """
+    Allocates the output buffers of the kernels of a pipeline.
+
+    Buffer lifetimes are found by a liveness analysis of the schedule of
+    the pipeline: a buffer is live from the step of the kernel that
+    writes it through the last step of a kernel that reads it. When
+    buffer sharing is enabled:
+
+    * The output of a pass-through kernel (e.g. a zero-sample delay) is
+      its first input, and the kernel does not run.
+
+    * A pointwise kernel writes its output over its first input when
+      that input is of the same width, is not live after the kernel
+      runs, and is not also another input of the kernel.
+
+    * Any other output is written to a dead buffer of the same width
+      when there is one, and to a new buffer otherwise.
+
+    Outputs of kernels without inputs are always new buffers, since the
+    pipeline writes source outputs before the first kernel runs.
+    """
+
+
+    def __init__(self, graph, schedule, pipeline, share_buffers):
+
+        self._graph = graph
+        self._pipeline = pipeline
+        self._share_buffers = share_buffers
+
+        # Find the index of the last step that reads each block output.
+        self._last_reads = {}
+        for i, path in enumerate(schedule):
+            for e in graph.get_inputs(path):
+                self._last_reads[(e.src, e.src_port)] = i
+
+        self._path_buffers = {}
+        self._buffer_ends = {}
+        self._dead_buffers = {}
+        self.num_buffers = 0
+
+
+    def allocate_outputs(self, index, kernel):
+
+        path = kernel.block.path
+        ends = self._buffer_ends
+        inputs = [
+            self._path_buffers[(e.src, e.src_port)]
+            for e in self._graph.get_inputs(path)]
+
+        outputs = []
+
+        for i, width in enumerate(kernel.output_widths):
+
+            port = (path, i + 1)
+            end = self._last_reads.get(port, index)
+
+            if self._share_buffers and i == 0 and len(inputs) != 0 and \
+                    len(inputs[0]) == width and (
+                        kernel.pass_through or (
+                            kernel.pointwise and
+                            ends[id(inputs[0])] == index and
+                            all(b is not inputs[0] for b in inputs[1:]))):
+                buffer = inputs[0]
+                end = max(end, ends[id(buffer)])
+
+            elif self._share_buffers and len(inputs) != 0 and \
+                    len(self._dead_buffers.get(width, [])) != 0:
+                buffer = self._dead_buffers[width].pop()
+
+            else:
+                buffer = self._pipeline.allocate(width)
+                self.num_buffers += 1
+
+            ends[id(buffer)] = end
+            self._path_buffers[port] = buffer
+            outputs.append(buffer)
+
+        self._step_buffers = inputs + outputs
+
+        return outputs
+
+
+    def release(self, index):
+
+        """Releases the buffers that are dead after the specified step."""
+
+        if not self._share_buffers:
+            return
+
+        released = set()
+
+        for buffer in self._step_buffers:
+            key = id(buffer)
+            if self._buffer_ends[key] == index and key not in released:
+                self._dead_buffers.setdefault(len(buffer), []).append(buffer)
+                released.add(key)
+
+
+class _Context:
+
+    """Context in which pipeline kernels are created."""
+
+
+    def __init__(self, pipeline):
+        self.pipeline = pipeline
+        self.listener = pipeline.listener
+        self.outputs = pipeline.outputs
+        self._delays = {}
+
+
+    def allocate(self, shape, dtype='float64'):
+        return self.pipeline.allocate(shape, dtype)
+
+
+    def get_input_delay(self, block, port_index):
+
+        """
+        Gets the delay of the specified block input relative to the
+        pipeline input, in samples.
+
+        The delay of a block output is the delay of the block's first
+        input plus the delay of its kernel.
+        """
+
+        graph = self.pipeline.graph
+        kernels_ = self.pipeline.kernels
+        delays = self._delays
+
+        def get_delay(path):
+            if path not in delays:
+                inputs = graph.get_inputs(path)
+                delay = kernels_[path].delay
+                if len(inputs) != 0:
+                    delay += get_delay(inputs[0].src)
+                delays[path] = delay
+            return delays[path]
+
+        return get_delay(graph.get_inputs(block.path)[port_index].src)
+
+
+def compile_model(file_name, listener=None, arena=None, share_buffers=True):
+
+    """Compiles the specified .mdl file into a pipeline."""
+
+    return Pipeline(load_graph(file_name), listener, arena, share_buffers)
+
+
+def _prune(graph):
+
+    """
+    Removes the blocks of a graph from which no sink block is
+    reachable.
+    """
+
+    graph = graph.copy()
+
+    reached = set(b.path for b in graph.get_blocks(*kernels.SINK_TYPES))
+
+    if len(reached) == 0:
+        raise ValueError(
+            'Model "{}" has no Clip & Save blocks or output ports.'.format(
+                graph.name))
+
+    queue = deque(reached)
+
+    while len(queue) != 0:
+        path = queue.popleft()
+        for e in graph.get_inputs(path):
+            if e.src not in reached:
+                reached.add(e.src)
+                queue.append(e.src)
+
+    for path in list(graph.blocks):
+        if path not in reached:
+            graph.remove_block(path)
+
+    return graph
+
+
+def _merge_integrators(graph):
+
+    """
+    Replaces each set of two or more Integrate blocks of a graph that
+    integrate the same signal with the same settings other than their
+    integration times with one MultiIntegrate block.
+
+    The merged block takes the path and position of the first block of
+    its set, and its output `k` is the output of the `k`th block.
+    """
+
+    sets = {}
+
+    for block in graph.get_blocks('Integrate'):
+        e = graph.get_inputs(block.path)[0]
+        key = (e.src, e.src_port) + tuple(
+            block.evaluate(name, default)
+            for name, default in _INTEGRATOR_PARAMS) + (
+            block.params.get('normalize', 'off'),)
+        sets.setdefault(key, []).append(block)
+
+    sets = [blocks for blocks in sets.values() if len(blocks) > 1]
+
+    if len(sets) == 0:
+        return graph
+
+    graph = graph.copy()
+
+    for blocks in sets:
+
+        first = blocks[0]
+        times = [b.evaluate('integration_time') for b in blocks]
+
+        params = dict(first.params)
+        del params['integration_time']
+        params['integration_times'] = '[{}]'.format(
+            ' '.join(repr(float(t)) for t in times))
+
+        merged = Block(first.path, 'MultiIntegrate', params, first.scope)
+
+        edges = graph.get_inputs(first.path)
+        for i, block in enumerate(blocks):
+            edges += [
+                Edge(first.path, i + 1, e.dst, e.dst_port)
+                for e in graph.get_outputs(block.path)]
+
+        for block in blocks[1:]:
+            graph.remove_block(block.path)
+
+        graph.edges = [
+            e for e in graph.edges if first.path not in (e.src, e.dst)]
+        graph.edges += edges
+        graph.blocks[first.path] = merged
+
+    return graph
+
+
+_INTEGRATOR_PARAMS = (
+    ('buffersize', None), ('numChannels', 1), ('col_major', 0),
+    ('initial_value', 0))
+"""
+parameters other than their integration times and normalization flags
+that must match for Integrate blocks to be merged, with their defaults.
+"""
+
+
+def _schedule(graph):
+
+    """
+    Gets a topological order of the blocks of a graph.
+
+    Blocks whose inputs are ready run in model file order.
+    """
+
+    order = dict((path, i) for i, path in enumerate(graph.blocks))
+    counts = dict((path, 0) for path in graph.blocks)
+    for e in graph.edges:
+        counts[e.dst] += 1
+
+    ready = sorted((p for p, c in counts.items() if c == 0), key=order.get)
+    schedule = []
+
+    while len(ready) != 0:
+
+        path = ready.pop(0)
+        schedule.append(path)
+
+        for e in graph.get_outputs(path):
+            counts[e.dst] -= 1
+            if counts[e.dst] == 0:
+                ready.append(e.dst)
+                ready.sort(key=order.get)
+
+    if len(schedule) != len(graph.blocks):
+        raise ValueError(
+            'Model "{}" has a feedback loop, which pipelines do not '
+            'support.'.format(graph.name))
+
+    return schedule
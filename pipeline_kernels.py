@@ -0,0 +1,1119 @@
+"""
+Module containing the block kernels of the `pipeline` module.
+
+A kernel implements one block of a model graph (see the `mdl_graph`
+module). It is created once, when its pipeline is compiled, with the
+values of its block's parameters as constants, and then processes one
+buffer per pipeline step. The kernels of the BufferedDSP blocks follow
+the S-functions of the `Old Bird` directory (e.g. `sdelay.c` for the
+Delay block), except that each kernel processes all of the samples of
+a buffer with NumPy operations rather than one sample at a time. The
+kernels of blocks whose S-functions are not among the Old Bird files
+(e.g. Edge Detect and Select Channel) follow the descriptions of the
+blocks in the models.
+
+A kernel holds all of its mutable state in arrays obtained from its
+pipeline with `context.allocate`, so that a pipeline's state can be
+managed as a whole. Each kernel writes its outputs to buffers allocated
+by its pipeline.
+"""
+
+
+import math
+
+import numpy as np
+import scipy.ndimage as ndimage
+import scipy.signal as signal
+
+
+ROW_MAJOR = 0
+COL_MAJOR = 1
+
+
+class Kernel:
+
+    """
+    Pipeline block implementation.
+
+    Subclasses set `output_widths` in their initializers, and implement
+    the `process` method.
+    """
+
+
+    pointwise = False
+    """
+    `True` if and only if each output sample of the kernel depends only
+    on the kernel's state and the input samples at the same position,
+    and the kernel reads its inputs at a position before it writes its
+    output there, so that the kernel can write its output over its
+    first input.
+    """
+
+    pass_through = False
+    """
+    `True` if and only if the output of the kernel is always its first
+    input, so that the kernel need not run.
+    """
+
+    delay = 0
+    """the delay of the kernel's output relative to its first input."""
+
+
+    def __init__(self, block, input_widths, context):
+        self.block = block
+        self.input_widths = input_widths
+        self.output_widths = []
+
+
+    def process(self, inputs, outputs):
+
+        """
+        Processes one buffer.
+
+        `inputs` and `outputs` are lists of one-dimensional float arrays,
+        one per port.
+        """
+
+        pass
+
+
+def _get_int(block, name, default=None):
+    value = block.evaluate(name, default)
+    if value is None:
+        raise ValueError(
+            'Block "{}" has no "{}" parameter.'.format(block.path, name))
+    return int(math.floor(.5 + float(value)))
+
+
+def _get_flag(block, name, default='off'):
+    return block.params.get(name, default) == 'on'
+
+
+def _get_layout(block):
+    return COL_MAJOR if _get_int(block, 'col_major', 0) else ROW_MAJOR
+
+
+def _get_channels(buffer, num_channels, layout):
+
+    """
+    Gets a `(num_channels, n)` view of a multichannel buffer.
+
+    Writing to the view writes to the buffer.
+    """
+
+    if layout == COL_MAJOR:
+        return buffer.reshape(num_channels, -1)
+    else:
+        return buffer.reshape(-1, num_channels).T
+
+
+class _BufferedKernel(Kernel):
+
+    """Kernel for a BufferedDSP block with one multichannel input."""
+
+
+    _BUFFER_SIZE_PARAM = 'buffersize'
+
+
+    def __init__(self, block, input_widths, context):
+        super().__init__(block, input_widths, context)
+        self.buffer_size = _get_int(block, self._BUFFER_SIZE_PARAM)
+        self.num_channels = _get_int(block, 'numChannels', 1)
+        self.layout = _get_layout(block)
+        self.output_widths = [self.buffer_size * self.num_channels]
+
+
+    def get_channels(self, buffer):
+        return _get_channels(buffer, self.num_channels, self.layout)
+
+
+class Source(Kernel):
+
+    """
+    Kernel for a model's audio source, i.e. a WaveIn or From Wave File
+    block.
+
+    The pipeline writes input buffers directly to the source output.
+    """
+
+
+    def __init__(self, block, input_widths, context):
+        super().__init__(block, input_widths, context)
+        self.buffer_size = _get_int(block, 'buffersize')
+        self.num_channels = 2 if _get_flag(block, 'stereo') else 1
+        self.layout = _get_layout(block)
+        self.output_widths = [self.buffer_size * self.num_channels]
+
+
+class Constant(Kernel):
+
+
+    def __init__(self, block, input_widths, context):
+        super().__init__(block, input_widths, context)
+        self.value = np.atleast_1d(
+            np.asarray(block.evaluate('Value'), dtype='float')).reshape(-1)
+        self.output_widths = [len(self.value)]
+
+
+    def process(self, inputs, outputs):
+        outputs[0][:] = self.value
+
+
+class _PointwiseKernel(Kernel):
+
+    pointwise = True
+
+
+    def __init__(self, block, input_widths, context):
+        super().__init__(block, input_widths, context)
+        self.output_widths = [max(input_widths)]
+
+
+class Gain(_PointwiseKernel):
+
+
+    def __init__(self, block, input_widths, context):
+        super().__init__(block, input_widths, context)
+        self.gain = float(block.evaluate('Gain'))
+
+
+    def process(self, inputs, outputs):
+        np.multiply(inputs[0], self.gain, out=outputs[0])
+
+
+class Math(_PointwiseKernel):
+
+
+    _OPERATORS = {
+        'exp': np.exp,
+        'log': np.log,
+        'log10': np.log10,
+        'reciprocal': np.reciprocal,
+        'sqrt': np.sqrt,
+        'square': np.square,
+    }
+
+
+    def __init__(self, block, input_widths, context):
+
+        super().__init__(block, input_widths, context)
+
+        name = block.params.get('Operator', 'exp')
+        self.function = self._OPERATORS.get(name)
+
+        if self.function is None:
+            raise ValueError(
+                'Unsupported Math block operator "{}".'.format(name))
+
+
+    def process(self, inputs, outputs):
+        with np.errstate(divide='ignore', invalid='ignore'):
+            self.function(inputs[0], out=outputs[0])
+
+
+class Sum(_PointwiseKernel):
+
+
+    def __init__(self, block, input_widths, context):
+
+        super().__init__(block, input_widths, context)
+
+        self.signs = _get_operand_signs(block.params.get('Inputs', '++'), '+-')
+
+        if len(self.signs) == 1:
+            # A one-input sum block sums the elements of its input.
+            self.pointwise = False
+            self.output_widths = [1]
+
+
+    def process(self, inputs, outputs):
+
+        y = outputs[0]
+
+        if len(self.signs) == 1:
+            y[0] = np.sum(inputs[0])
+
+        else:
+            first = True
+            for x, sign in zip(inputs, self.signs):
+                if first:
+                    np.multiply(x, 1. if sign else -1., out=y)
+                    first = False
+                elif sign:
+                    np.add(y, x, out=y)
+                else:
+                    np.subtract(y, x, out=y)
+
+
+class Product(_PointwiseKernel):
+
+
+    def __init__(self, block, input_widths, context):
+        super().__init__(block, input_widths, context)
+        self.signs = _get_operand_signs(block.params.get('Inputs', '2'), '*/')
+
+
+    def process(self, inputs, outputs):
+
+        y = outputs[0]
+
+        with np.errstate(divide='ignore', invalid='ignore'):
+
+            divisors = [x for x, s in zip(inputs, self.signs) if not s]
+            factors = [x for x, s in zip(inputs, self.signs) if s]
+
+            if len(factors) == 0:
+                y[:] = 1
+            elif len(divisors) == 0:
+                np.multiply(factors[0], 1, out=y)
+            else:
+                np.divide(factors[0], divisors[0], out=y)
+                divisors = divisors[1:]
+
+            for x in factors[1:]:
+                np.multiply(y, x, out=y)
+
+            for x in divisors:
+                np.divide(y, x, out=y)
+
+
+def _get_operand_signs(spec, symbols):
+
+    """
+    Gets the operand signs of a Sum or Product block.
+
+    The `Inputs` parameter of such a block is either a number of inputs
+    or a string of operand symbols, e.g. `'+-'` or `'*/'`.
+    """
+
+    if spec.isdigit():
+        return [True] * int(spec)
+    else:
+        return [c == symbols[0] for c in spec if c in symbols]
+
+
+class RelationalOperator(_PointwiseKernel):
+
+
+    _OPERATORS = {
+        '>': np.greater,
+        '>=': np.greater_equal,
+        '<': np.less,
+        '<=': np.less_equal,
+        '==': np.equal,
+        '~=': np.not_equal,
+    }
+
+
+    def __init__(self, block, input_widths, context):
+        super().__init__(block, input_widths, context)
+        self.function = self._OPERATORS[block.params.get('Operator', '<=')]
+
+
+    def process(self, inputs, outputs):
+        self.function(inputs[0], inputs[1], out=outputs[0])
+
+
+class Logic(_PointwiseKernel):
+
+
+    def __init__(self, block, input_widths, context):
+        super().__init__(block, input_widths, context)
+        self.operator = block.params.get('Operator', 'AND')
+        if self.operator not in ('AND', 'OR', 'NAND', 'NOR', 'XOR', 'NOT'):
+            raise ValueError(
+                'Unsupported Logic block operator "{}".'.format(
+                    self.operator))
+
+
+    def process(self, inputs, outputs):
+
+        y = outputs[0]
+        op = self.operator
+
+        if op == 'NOT':
+            np.logical_not(inputs[0], out=y)
+            return
+
+        function = {
+            'AND': np.logical_and, 'NAND': np.logical_and,
+            'OR': np.logical_or, 'NOR': np.logical_or,
+            'XOR': np.logical_xor}[op]
+
+        function(inputs[0], inputs[1], out=y)
+        for x in inputs[2:]:
+            function(y, x, out=y)
+
+        if op in ('NAND', 'NOR'):
+            np.logical_not(y, out=y)
+
+
+class SelectChannel(_BufferedKernel):
+
+
+    def __init__(self, block, input_widths, context):
+        super().__init__(block, input_widths, context)
+        self.channel = _get_int(block, 'selectChannel') - 1
+        self.output_widths = [self.buffer_size]
+
+
+    def process(self, inputs, outputs):
+        outputs[0][:] = self.get_channels(inputs[0])[self.channel]
+
+
+class Delay(_BufferedKernel):
+
+    """
+    Kernel for the BufferedDSP Delay block (see `sdelay.c`).
+
+    A delay of zero is a pass-through. When the delay is a multiple of
+    the buffer size, the history is a ring of whole buffers and the
+    kernel is pointwise.
+    """
+
+
+    def __init__(self, block, input_widths, context):
+
+        super().__init__(block, input_widths, context)
+
+        self.delay = _get_int(block, 'delay')
+        self.history = context.allocate((self.num_channels, self.delay))
+
+        self.pass_through = self.delay == 0
+        self.pointwise = self.delay % self.buffer_size == 0
+
+        if self.pointwise:
+            self.ring_index = context.allocate(1, 'int64')
+
+
+    def process(self, inputs, outputs):
+
+        if self.delay == 0:
+            outputs[0][:] = inputs[0]
+            return
+
+        x = self.get_channels(inputs[0])
+
+        if self.pointwise:
+            n = self.buffer_size
+            start = self.ring_index[0] * n
+            slot = self.history[:, start:start + n]
+            x = x.copy()
+            self.get_channels(outputs[0])[:] = slot
+            slot[:] = x
+            self.ring_index[0] = (start + n) % self.delay // n
+            return
+
+        z = np.concatenate((self.history, x), axis=1)
+        self.get_channels(outputs[0])[:] = z[:, :self.buffer_size]
+        self.history[:] = z[:, z.shape[1] - self.delay:]
+
+
+class FIFO(_BufferedKernel):
+
+    """Kernel for the BufferedDSP FIFO block (see `sfifo.c`)."""
+
+
+    _BUFFER_SIZE_PARAM = 'input_width'
+
+
+    def __init__(self, block, input_widths, context):
+
+        super().__init__(block, input_widths, context)
+
+        self.output_size = _get_int(block, 'output_width')
+        self.overlap = self.output_size - self.buffer_size
+        self.output_widths = [self.output_size * self.num_channels]
+        self.history = context.allocate((self.num_channels, self.overlap))
+
+
+    def get_output_channels(self, buffer):
+        return _get_channels(buffer, self.num_channels, self.layout)
+
+
+    def process(self, inputs, outputs):
+        x = self.get_channels(inputs[0])
+        z = np.concatenate((self.history, x), axis=1)
+        self.get_output_channels(outputs[0])[:] = z
+        self.history[:] = z[:, self.buffer_size:]
+
+
+class Integrate(_BufferedKernel):
+
+    """
+    Kernel for the BufferedDSP Integrate block (see
+    `sfiniteintegrate.c`).
+    """
+
+
+    def __init__(self, block, input_widths, context):
+
+        super().__init__(block, input_widths, context)
+
+        self.integration_time = _get_int(block, 'integration_time')
+        self.factor = 1 / self.integration_time \
+            if _get_flag(block, 'normalize') else 1
+
+        self.history = context.allocate(
+            (self.num_channels, self.integration_time))
+        self.value = context.allocate((self.num_channels, 1))
+        self.value[:] = float(block.evaluate('initial_value', 0))
+
+
+    def process(self, inputs, outputs):
+
+        x = self.get_channels(inputs[0])
+        z = np.concatenate((self.history, x), axis=1)
+
+        # `z[:, k]` is the input `integration_time` samples before
+        # `x[:, k]`.
+        sums = self.value + np.cumsum(x - z[:, :self.buffer_size], axis=1)
+
+        np.multiply(sums, self.factor, out=self.get_channels(outputs[0]))
+        self.value[:, 0] = sums[:, -1]
+        self.history[:] = z[:, z.shape[1] - self.integration_time:]
+
+
+class MultiIntegrate(_BufferedKernel):
+
+    """
+    Kernel for a finite integrator with several integration times.
+
+    The block has the parameters of the BufferedDSP Integrate block,
+    except that its `integration_times` parameter is an array, and it
+    has one output per integration time. The pipeline replaces
+    Integrate blocks that integrate the same signal with the same
+    settings other than their integration times with one of these.
+
+    Rather than keeping a history of its input and a running sum for
+    each integration time, the kernel keeps one history of cumulative
+    sums of its input, long enough for the longest integration time.
+    Each output is the difference of the current cumulative sum and the
+    one an integration time earlier. The history is rebased after each
+    buffer so that its values do not grow without bound.
+    """
+
+
+    def __init__(self, block, input_widths, context):
+
+        super().__init__(block, input_widths, context)
+
+        times = np.atleast_1d(block.evaluate('integration_times'))
+        self.integration_times = [int(math.floor(.5 + t)) for t in times]
+        self.max_integration_time = max(self.integration_times)
+
+        normalize = _get_flag(block, 'normalize')
+        self.factors = [
+            1 / t if normalize else 1 for t in self.integration_times]
+        self.initial_value = float(block.evaluate('initial_value', 0))
+
+        self.output_widths = self.output_widths * len(self.integration_times)
+
+        # cumulative sums of the last `max_integration_time` inputs
+        self.sums = context.allocate(
+            (self.num_channels, self.max_integration_time))
+
+
+    def process(self, inputs, outputs):
+
+        x = self.get_channels(inputs[0])
+        n = self.max_integration_time
+
+        # `z[:, n + k]` is the cumulative sum through `x[:, k]`.
+        z = np.concatenate(
+            (self.sums, self.sums[:, -1:] + np.cumsum(x, axis=1)), axis=1)
+        current = z[:, n:]
+
+        for time, factor, output in zip(
+                self.integration_times, self.factors, outputs):
+            sums = current - z[:, n - time:n - time + self.buffer_size]
+            if self.initial_value != 0:
+                sums += self.initial_value
+            np.multiply(sums, factor, out=self.get_channels(output))
+
+        self.sums[:] = z[:, z.shape[1] - n:]
+        self.sums -= self.sums[:, :1].copy()
+
+
+class Counter(_BufferedKernel):
+
+    """Kernel for the BufferedDSP Counter block (see `scounter.c`)."""
+
+
+    _EPS = 1e-12
+
+
+    def __init__(self, block, input_widths, context):
+
+        super().__init__(block, input_widths, context)
+
+        self.has_enable = _get_flag(block, 'has_enable')
+        self.has_reset = _get_flag(block, 'has_reset')
+        self.has_preset = _get_flag(block, 'has_preset')
+        self.step = -1. if block.params.get('count_direction') == 'Down' \
+            else 1.
+        self.preset = float(block.evaluate('preset', 0))
+
+        eps = self._EPS
+        stop_count = float(block.evaluate('stop_count', 0))
+        if not _get_flag(block, 'has_stop_count'):
+            self.stop_count = None
+        elif self.step < 0:
+            self.stop_count = stop_count * (1 + eps) + eps
+        else:
+            self.stop_count = stop_count * (1 - eps) - eps
+
+        self.count = context.allocate(self.num_channels)
+        self.count[:] = float(block.evaluate('initial_count', 0))
+
+
+    def process(self, inputs, outputs):
+
+        y = self.get_channels(outputs[0])
+
+        if len(inputs) == 0:
+            self._count(y)
+
+        else:
+            ports = iter(inputs)
+            enable = self._get_input(ports, self.has_enable)
+            reset = self._get_input(ports, self.has_reset)
+            preset = self._get_input(ports, self.has_preset)
+            for channel in range(self.num_channels):
+                self._count_channel(channel, y[channel], enable, reset, preset)
+
+
+    def _count(self, y):
+
+        # Without inputs, each channel counts steadily until it reaches
+        # the stop count.
+        k = np.arange(1, self.buffer_size + 1)
+
+        for channel in range(self.num_channels):
+
+            count = self.count[channel]
+
+            if self.stop_count is None:
+                steps = k
+
+            else:
+                # `limit` is the number of steps before the count passes
+                # the stop count.
+                distance = (self.stop_count - count) * self.step
+                limit = max(math.ceil(distance), 0)
+                steps = np.minimum(k, limit)
+
+            y[channel] = count + steps * self.step
+            self.count[channel] = y[channel, -1]
+
+
+    def _get_input(self, ports, present):
+        return self.get_channels(next(ports)) if present else None
+
+
+    def _count_channel(self, channel, y, enable, reset, preset):
+
+        # Each reset or preset sample sets the count, and starts a
+        # segment of the buffer in which the count only steps. The
+        # segments are counted with `np.cumsum`, jumping from one reset
+        # or preset sample to the next.
+
+        n = self.buffer_size
+        step = self.step
+
+        if enable is None:
+            steps = np.full(n, step)
+        else:
+            steps = step * enable[channel]
+
+        is_reset = np.zeros(n, bool) if reset is None else reset[channel] != 0
+        is_preset = \
+            np.zeros(n, bool) if preset is None else preset[channel] != 0
+
+        events = np.flatnonzero(is_reset | is_preset).tolist()
+        events.append(n)
+
+        count = self.count[channel]
+        i = 0
+
+        for end in events:
+
+            if i < end:
+                self._count_segment(count, steps[i:end], y[i:end])
+                count = y[end - 1]
+
+            if end == n:
+                break
+
+            count = 0. if is_reset[end] else self.preset
+            y[end] = count
+            i = end + 1
+
+        self.count[channel] = count
+
+
+    def _count_segment(self, count, steps, y):
+
+        """
+        Counts from `count` by the specified steps, stopping at the stop
+        count.
+        """
+
+        stop_count = self.stop_count
+
+        if stop_count is not None and (count - stop_count) * self.step >= 0:
+            y[:] = count
+            return
+
+        # Accumulating from the initial count adds in the same order as
+        # a sample-by-sample loop, so the counts are the same.
+        counts = np.cumsum(np.concatenate(([count], steps)))[1:]
+
+        if stop_count is None:
+            y[:] = counts
+
+        else:
+            # The count stops changing at the first sample at which it
+            # reaches the stop count.
+            stopped = (counts - stop_count) * self.step >= 0
+            k = np.argmax(stopped) if stopped.any() else len(counts) - 1
+            y[:k + 1] = counts[:k + 1]
+            y[k + 1:] = counts[k]
+
+
+class PulseLimitedFlipFlop(_BufferedKernel):
+
+    """
+    Kernel for the BufferedDSP Pulse Limited Flip Flop block (see
+    `splimflipflop.c`).
+
+    The input ports are reset and set.
+    """
+
+
+    def __init__(self, block, input_widths, context):
+
+        super().__init__(block, input_widths, context)
+
+        self.min_limit = _get_limit(block, 'minLimit')
+        self.max_limit = _get_limit(block, 'maxLimit')
+
+        # state and pulse duration count of each channel
+        self.state = context.allocate(self.num_channels)
+        self.state[:] = float(block.evaluate('initial_state', 0))
+        self.count = context.allocate(self.num_channels, 'int64')
+
+
+    def process(self, inputs, outputs):
+
+        resets = self.get_channels(inputs[0])
+        sets = self.get_channels(inputs[1])
+        y = self.get_channels(outputs[0])
+
+        for channel in range(self.num_channels):
+            self._process_channel(channel, resets[channel], sets[channel],
+                                  y[channel])
+
+
+    def _process_channel(self, channel, reset, set_, y):
+
+        # This follows `processChannel` of `splimflipflop.c`, jumping
+        # from one set or reset event to the next.
+
+        n = len(y)
+        min_limit = self.min_limit
+        max_limit = self.max_limit
+        unlimited = min_limit == 0 and max_limit == 0
+        state = self.state[channel]
+        count = int(self.count[channel])
+
+        events = np.flatnonzero((reset != 0) | (set_ != 0)).tolist()
+        events.append(n)
+
+        i = 0
+
+        for end in events:
+
+            # Fill output up to event.
+            if unlimited:
+                y[i:end] = state
+                i = end
+
+            else:
+
+                if state:
+                    j = end
+                    if max_limit != 0 and j - i > max_limit - count:
+                        j = i + (max_limit - count if count < max_limit else 0)
+                    count += j - i
+                    y[i:j] = 1
+                    i = j
+                    if i < end:
+                        state = 0.
+
+                if not state and i < end:
+
+                    if count != 0 and count < min_limit:
+                        j = min(end, i + min_limit - count)
+                        count += j - i
+                        y[i:j] = 1
+                        i = j
+
+                    if i < end:
+                        count = 0
+                        y[i:end] = 0
+                        i = end
+
+            if i == n:
+                break
+
+            # Process event sample.
+            if unlimited:
+                if reset[i] != 0:
+                    state = 0.
+                elif set_[i] != 0:
+                    state = 1.
+                y[i] = state
+
+            else:
+                if reset[i] != 0 or (max_limit != 0 and count >= max_limit):
+                    state = 0.
+                elif set_[i] != 0:
+                    state = 1.
+
+                if not state and (count == 0 or count >= min_limit):
+                    y[i] = 0
+                    count = 0
+                else:
+                    y[i] = 1
+                    count += 1
+
+            i += 1
+
+        self.state[channel] = state
+        self.count[channel] = count
+
+
+def _get_limit(block, name):
+
+    # An infinite limit is the same as a zero one.
+    value = float(block.evaluate(name, 0))
+    return 0 if math.isinf(value) else int(math.floor(.5 + value))
+
+
+class PulseExtend(_BufferedKernel):
+
+    """
+    Kernel for the BufferedDSP Pulse Extend block (see
+    `spulseextend.c`).
+
+    Each output sample is the maximum of the input sample at the same
+    position and the `lag` preceding input samples.
+    """
+
+
+    def __init__(self, block, input_widths, context):
+        super().__init__(block, input_widths, context)
+        self.lag = _get_int(block, 'lag')
+        self.history = context.allocate((self.num_channels, self.lag))
+
+
+    def process(self, inputs, outputs):
+
+        if self.lag == 0:
+            outputs[0][:] = inputs[0]
+            return
+
+        x = self.get_channels(inputs[0])
+        z = np.concatenate((self.history, x), axis=1)
+
+        # Shift the filter window so that it ends at its output sample.
+        size = self.lag + 1
+        maxima = ndimage.maximum_filter1d(
+            z, size, axis=1, origin=(size - 1) // 2)
+
+        self.get_channels(outputs[0])[:] = maxima[:, self.lag:]
+        self.history[:] = z[:, z.shape[1] - self.lag:]
+
+
+class EdgeDetect(_BufferedKernel):
+
+    """
+    Kernel for the BufferedDSP Edge Detect block.
+
+    The output is one at each rising edge of the input, i.e. at each
+    nonzero input sample whose predecessor is zero, and zero elsewhere.
+    """
+
+
+    def __init__(self, block, input_widths, context):
+        super().__init__(block, input_widths, context)
+        self.previous = context.allocate((self.num_channels, 1))
+
+
+    def process(self, inputs, outputs):
+        x = self.get_channels(inputs[0]) != 0
+        z = np.concatenate((self.previous != 0, x), axis=1)
+        self.get_channels(outputs[0])[:] = x & ~z[:, :-1]
+        self.previous[:, 0] = x[:, -1]
+
+
+class DigitalClock(Kernel):
+
+    """
+    Kernel for the BufferedDSP Digital Clock block.
+
+    The output is the time of each sample in seconds, starting from
+    `t0`.
+    """
+
+
+    def __init__(self, block, input_widths, context):
+        super().__init__(block, input_widths, context)
+        self.buffer_size = _get_int(block, 'buffersize')
+        self.t0 = float(block.evaluate('t0', 0))
+        self.sample_rate = float(block.evaluate('fs'))
+        self.sample_count = context.allocate(1, 'int64')
+        self.output_widths = [self.buffer_size]
+
+
+    def process(self, inputs, outputs):
+        n = self.sample_count[0] + np.arange(self.buffer_size)
+        np.add(self.t0, n / self.sample_rate, out=outputs[0])
+        self.sample_count[0] += self.buffer_size
+
+
+class GatedShiftRegister(_BufferedKernel):
+
+    """
+    Kernel for the BufferedDSP Gated Shift Register block (see
+    `sgatedshiftregister.c`).
+
+    The input ports are the input and the gate. At each nonzero gate
+    sample the input sample is shifted into the register, and the
+    output is always the oldest register value.
+    """
+
+
+    def __init__(self, block, input_widths, context):
+        super().__init__(block, input_widths, context)
+        self.register_size = _get_int(block, 'reg_size')
+        self.register = context.allocate(
+            (self.num_channels, self.register_size))
+
+
+    def process(self, inputs, outputs):
+
+        x = self.get_channels(inputs[0])
+        gate = inputs[1] != 0
+
+        # `values[:, k]` is the oldest register value after `k` shifts.
+        values = np.concatenate((self.register, x[:, gate]), axis=1)
+        shifts = np.cumsum(gate)
+
+        self.get_channels(outputs[0])[:] = values[:, shifts]
+        self.register[:] = values[:, values.shape[1] - self.register_size:]
+
+
+class OverlapSave(_BufferedKernel):
+
+    """
+    Kernel for the BufferedDSP row-major FIR Filter block, an
+    overlap-save FFT convolver.
+    """
+
+
+    _BUFFER_SIZE_PARAM = 'input_width'
+
+
+    def __init__(self, block, input_widths, context):
+
+        super().__init__(block, input_widths, context)
+
+        # The block is from the row-major filter library.
+        self.layout = ROW_MAJOR
+
+        self.coefficients = np.asarray(block.evaluate('h'), dtype='float')
+        self.history = context.allocate(
+            (self.num_channels, len(self.coefficients) - 1))
+
+
+    def process(self, inputs, outputs):
+        x = self.get_channels(inputs[0])
+        z = np.concatenate((self.history, x), axis=1)
+        h = self.coefficients[np.newaxis, :]
+        y = signal.fftconvolve(z, h, mode='valid', axes=1)
+        self.get_channels(outputs[0])[:] = y
+        self.history[:] = z[:, z.shape[1] - self.history.shape[1]:]
+
+
+class ClipAndSave(Kernel):
+
+    """
+    Kernel for the BufferedDSP Clip & Save block (see `sclipnsave.c`).
+
+    The input ports are the samples and the gate, both typically from
+    FIFOs, so that the buffers overlap. A clip comprises the samples of
+    one gate pulse, and is reported when the gate goes low. Rather than
+    saving clips to files, the kernel calls the `process_clip` method of
+    the pipeline's listener with the start index and length of each clip
+    and, if the listener has a `save_clip` method, calls that with the
+    start index and samples of the clip.
+
+    Clip start indices are indices of the pipeline input, i.e. they
+    account for the delay of the samples input relative to the pipeline
+    input (e.g. the Delay block that precedes Clip & Save in the Old Bird
+    models). A clip that would start before the pipeline input does is
+    truncated.
+    """
+
+
+    def __init__(self, block, input_widths, context):
+
+        super().__init__(block, input_widths, context)
+
+        self.buffer_size = _get_int(block, 'buffersize')
+        self.fifo_size = _get_int(block, 'fifosize')
+        self.num_channels = _get_int(block, 'numChannels', 1)
+        self.layout = _get_layout(block)
+        self.listener = context.listener
+        self.sample_delay = context.get_input_delay(block, 0)
+
+        self.buffer_count = context.allocate(1, 'int64')
+
+
+    def process(self, inputs, outputs):
+
+        gate = inputs[1] != 0
+        fifo_size = self.fifo_size
+        overlap = fifo_size - self.buffer_size
+
+        # index of first FIFO sample in the input stream
+        offset = (self.buffer_count[0] + 1) * self.buffer_size - fifo_size
+
+        rising = overlap
+
+        while True:
+
+            # Find the next rising edge.
+            highs = np.flatnonzero(gate[rising:])
+            if len(highs) == 0:
+                break
+            rising += highs[0]
+
+            if rising == overlap:
+                # Back up to the first rising edge.
+                lows = np.flatnonzero(~gate[:rising])
+                rising = lows[-1] + 1 if len(lows) != 0 else 0
+
+            # Find the trailing edge.
+            trailing = max(rising, overlap)
+            lows = np.flatnonzero(~gate[trailing:])
+            if len(lows) == 0:
+                # We'll pick this up next time.
+                break
+            trailing += lows[0]
+
+            self._save_clip(inputs[0], offset, rising, trailing)
+
+            rising = trailing
+
+        self.buffer_count[0] += 1
+
+
+    def _save_clip(self, samples, offset, start, end):
+
+        listener = self.listener
+
+        if listener is None:
+            return
+
+        # Truncate clip to start no earlier than pipeline input.
+        start_index = int(offset + start) - self.sample_delay
+        if start_index < 0:
+            start -= start_index
+            start_index = 0
+            if start >= end:
+                return
+
+        listener.process_clip(start_index, int(end - start))
+
+        save_clip = getattr(listener, 'save_clip', None)
+        if save_clip is not None:
+            channels = _get_channels(samples, self.num_channels, self.layout)
+            save_clip(start_index, channels[:, start:end].T.copy())
+
+
+class Transpose(Kernel):
+
+    """
+    Kernel for the BufferedDSP Transpose block (see `stranspose.c`).
+
+    The input is an `M` by `N` row-major matrix.
+    """
+
+
+    def __init__(self, block, input_widths, context):
+        super().__init__(block, input_widths, context)
+        self.shape = (_get_int(block, 'M'), _get_int(block, 'N'))
+        self.output_widths = [self.shape[0] * self.shape[1]]
+
+
+    def process(self, inputs, outputs):
+        outputs[0].reshape(self.shape[1], self.shape[0])[:] = \
+            inputs[0].reshape(self.shape).T
+
+
+class Outport(Kernel):
+
+    """
+    Kernel for a model output port.
+
+    The output buffers of a pipeline step are appended to the list of
+    the port in the pipeline's `outputs` dictionary.
+    """
+
+
+    def __init__(self, block, input_widths, context):
+        super().__init__(block, input_widths, context)
+        self.values = context.outputs.setdefault(block.name, [])
+
+
+    def process(self, inputs, outputs):
+        self.values.append(inputs[0].copy())
+
+
+KERNEL_CLASSES = {
+    'Buffered Digital Clock': DigitalClock,
+    'Constant': Constant,
+    'Counter': Counter,
+    'Delay': Delay,
+    'EdgeDetect': EdgeDetect,
+    'FIFO': FIFO,
+    'From Wave File': Source,
+    'Gain': Gain,
+    'Gated Shift Register': GatedShiftRegister,
+    'Integrate': Integrate,
+    'Logic': Logic,
+    'Math': Math,
+    'MultiIntegrate': MultiIntegrate,
+    'Outport': Outport,
+    'OverlapSave': OverlapSave,
+    'Product': Product,
+    'PulseExtend': PulseExtend,
+    'PulseLimitedFlipFlop': PulseLimitedFlipFlop,
+    'RelationalOperator': RelationalOperator,
+    'SelectChannel': SelectChannel,
+    'Sum': Sum,
+    'WaveIn': Source,
+    'sclipnsave': ClipAndSave,
+    'stranspose': Transpose,
+}
+"""mapping from block types to kernel classes."""
+
+SOURCE_TYPES = frozenset(
+    t for t, c in KERNEL_CLASSES.items() if c is Source)
+"""types of audio source blocks."""
+
+SINK_TYPES = frozenset(['Outport', 'sclipnsave'])
+"""types of blocks whose outputs are the results of a pipeline."""
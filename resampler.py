@@ -0,0 +1,223 @@
+"""
+Module containing class `Resampler`, a streaming polyphase rational
+resampler.
+
+A resampler changes the sample rate of a signal by a rational factor
+`L / M`, where `L` and `M` are relatively prime positive integers.
+Conceptually, the signal is upsampled by inserting `L - 1` zeros after
+each sample, lowpass filtered, and then downsampled by keeping every
+`M`th sample. The resampler computes only the samples that survive
+downsampling, and for each of them only the products of filter
+coefficients with nonzero (i.e. not inserted) samples.
+
+This is the polyphase structure of the BufferedDSP distributor,
+commutator, and upsample & hold blocks (see `sdistributor.c`,
+`scommutator.c`, and `supsamplehold.c` in the `Old Bird` directory)
+generalized to a rational factor. The lowpass filter is split into `L`
+phase filters, phase `p` comprising coefficients `p, p + L, p + 2L, ...`
+of the lowpass filter. Output sample `n` corresponds to upsampled sample
+`n * M`, whose phase is `(n * M) % L` and whose most recent nonzero
+predecessor is input sample `(n * M) // L`, so it is the dot product of
+phase filter `(n * M) % L` with the input samples ending at that one.
+The phase filters are computed once, when the resampler is created. A
+call to `resample` processes its input a block of `_BLOCK_SIZE` samples
+at a time, computing the dot products for all of the output samples of
+a block together, so that its temporary memory use is bounded no matter
+how much input it is given.
+"""
+
+
+from fractions import Fraction
+
+import numpy as np
+import scipy.signal as signal
+
+
+_PHASE_FILTER_LENGTH = 32
+"""the default number of coefficients of each phase filter."""
+
+_BLOCK_SIZE = 2 ** 14
+"""
+the number of input samples for which the dot products of output
+samples are computed at once.
+
+Computing the dot products of a block uses temporary memory of about
+`_BLOCK_SIZE * (L / M) * phase_filter_length` floats.
+"""
+
+_CUTOFF_FACTOR = .95
+"""
+the lowpass filter cutoff frequency as a fraction of the lesser of
+the input and output Nyquist frequencies.
+"""
+
+_KAISER_BETA = 8
+"""the Kaiser window shape parameter for lowpass filter design."""
+
+
+class Resampler:
+
+    """
+    Streaming polyphase rational resampler.
+
+    The `resample` method of a resampler can be called repeatedly with
+    consecutive sample arrays. The resampler retains state across calls
+    as needed so that the concatenation of its outputs is the same as the
+    output would be for the concatenation of its inputs.
+    """
+
+
+    def __init__(
+            self, input_rate, output_rate,
+            phase_filter_length=_PHASE_FILTER_LENGTH):
+
+        factor = _get_rational(output_rate) / _get_rational(input_rate)
+
+        self._input_rate = input_rate
+        self._output_rate = output_rate
+        self._up_factor = factor.numerator
+        self._down_factor = factor.denominator
+        self._phase_filters = self._design_phase_filters(phase_filter_length)
+
+        # number of input samples received so far
+        self._input_count = 0
+
+        # number of output samples produced so far
+        self._output_count = 0
+
+        # most recent input samples, initially a prehistory of zeros
+        self._history = np.zeros(phase_filter_length - 1)
+
+
+    def _design_phase_filters(self, phase_filter_length):
+
+        L = self._up_factor
+        M = self._down_factor
+
+        # Design lowpass filter for upsampled signal, with unity passband
+        # gain at the original sample rate (hence the factor of `L`).
+        filter_length = L * phase_filter_length
+        cutoff = _CUTOFF_FACTOR / max(L, M)
+        coefficients = L * signal.firwin(
+            filter_length, cutoff, window=('kaiser', _KAISER_BETA))
+
+        # Split filter into phases, one per row, reversing each phase
+        # so that we can take dot products with input samples in order.
+        phase_filters = coefficients.reshape(phase_filter_length, L).T
+        return np.ascontiguousarray(phase_filters[:, ::-1])
+
+
+    @property
+    def input_rate(self):
+        return self._input_rate
+
+
+    @property
+    def output_rate(self):
+        return self._output_rate
+
+
+    @property
+    def up_factor(self):
+        return self._up_factor
+
+
+    @property
+    def down_factor(self):
+        return self._down_factor
+
+
+    @property
+    def delay(self):
+
+        """
+        the delay of the resampler output relative to its input, in
+        input sample periods.
+
+        Output sample `n` corresponds to input time
+        `n * down_factor / up_factor - delay`.
+        """
+
+        filter_length = self._phase_filters.size
+        return (filter_length - 1) / (2 * self._up_factor)
+
+
+    def get_input_index(self, output_index):
+
+        """
+        Gets the input index corresponding to the specified output index.
+
+        The result is rounded to the nearest integer and is never negative.
+        """
+
+        index = output_index * self._down_factor / self._up_factor - self.delay
+        return max(int(round(index)), 0)
+
+
+    def resample(self, samples):
+
+        """
+        Resamples the specified samples.
+
+        Returns the output samples that depend only on input samples
+        received so far.
+        """
+
+        samples = np.asarray(samples)
+
+        if len(samples) == 0:
+            return np.zeros(0)
+
+        num_outputs = \
+            self._get_output_count(self._input_count + len(samples)) - \
+            self._output_count
+        y = np.empty(num_outputs)
+
+        i = 0
+        for start in range(0, len(samples), _BLOCK_SIZE):
+            block = self._resample(samples[start:start + _BLOCK_SIZE])
+            y[i:i + len(block)] = block
+            i += len(block)
+
+        return y
+
+
+    def _get_output_count(self, input_count):
+
+        # Output sample `n` needs input samples up through
+        # `(n * M) // L`, so the first `input_count` input samples
+        # determine the output samples before the one returned.
+        return (input_count * self._up_factor - 1) // self._down_factor + 1
+
+
+    def _resample(self, samples):
+
+        L = self._up_factor
+        M = self._down_factor
+        K = self._phase_filters.shape[1]
+
+        x = np.concatenate((self._history, samples.astype('float')))
+
+        # `x[j]` is input sample `j + start`.
+        start = self._input_count - (K - 1)
+        self._input_count += len(samples)
+
+        end = self._get_output_count(self._input_count)
+        n = np.arange(self._output_count, end)
+        self._output_count = end
+
+        # Compute dot products of phase filters with input windows.
+        t = n * M
+        phases = t % L
+        window_starts = t // L - (K - 1) - start
+        windows = np.lib.stride_tricks.sliding_window_view(x, K)
+        y = np.einsum(
+            'ij,ij->i', windows[window_starts], self._phase_filters[phases])
+
+        self._history = x[len(x) - (K - 1):]
+
+        return y
+
+
+def _get_rational(rate):
+    return Fraction(rate).limit_denominator(1000)
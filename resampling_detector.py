@@ -0,0 +1,123 @@
+"""
+Module containing versions of the redux Old Bird detectors that resample
+their input to 22050 hertz.
+
+The redux detectors of the `old_bird_detector_redux_1_1` module adapt
+their filters to the input sample rate. The detectors of this module
+instead resample their input to the 22050 hertz sample rate of the
+original Old Bird detectors with a streaming polyphase resampler (see
+the `resampler` module) and then run a redux detector at that rate, so
+that all of the detector settings apply exactly as they did in the
+original detectors, regardless of the input sample rate. The start
+indices and lengths of detected clips are converted back to the input
+sample rate before they are passed to the listener.
+"""
+
+
+from old_bird_detector_redux_1_1 import _OLD_FS, ThrushDetector, TseepDetector
+from resampler import Resampler
+
+
+_CHUNK_DURATION = 10
+"""
+the duration in seconds of the chunks of samples that the `detect`
+function passes to a detector, which bounds its memory use for long
+recordings.
+"""
+
+
+class _ResamplingDetector:
+
+    """
+    Redux detector that resamples its input to 22050 hertz.
+
+    This class has the same interface as the `_Detector` class of the
+    `old_bird_detector_redux_1_1` module.
+    """
+
+
+    def __init__(self, detector_class, sample_rate, listener):
+        self._sample_rate = sample_rate
+        self._listener = listener
+        self._resampler = Resampler(sample_rate, _OLD_FS)
+        self._detector = detector_class(_OLD_FS, self)
+
+
+    @property
+    def settings(self):
+        return self._detector.settings
+
+
+    @property
+    def sample_rate(self):
+        return self._sample_rate
+
+
+    def detect(self, samples):
+        samples = self._resampler.resample(samples)
+        self._detector.detect(samples)
+
+
+    def complete_detection(self):
+
+        """
+        Completes detection after the `detect` method has been called
+        for all input.
+        """
+
+        self._detector.complete_detection()
+
+
+    def process_clip(self, start_index, length):
+        get_index = self._resampler.get_input_index
+        end_index = get_index(start_index + length)
+        start_index = get_index(start_index)
+        self._listener.process_clip(start_index, end_index - start_index)
+
+
+class ResamplingTseepDetector(_ResamplingDetector):
+
+
+    def __init__(self, sample_rate, listener):
+        super().__init__(TseepDetector, sample_rate, listener)
+
+
+class ResamplingThrushDetector(_ResamplingDetector):
+
+
+    def __init__(self, sample_rate, listener):
+        super().__init__(ThrushDetector, sample_rate, listener)
+
+
+def detect(samples, settings):
+
+    """
+    Runs a resampling Old Bird detector reimplementation on the
+    specified samples.
+    """
+
+    listener = _Listener()
+
+    if settings.detector_name == 'Thrush':
+        cls = ResamplingThrushDetector
+    else:
+        cls = ResamplingTseepDetector
+
+    detector = cls(settings.sample_rate, listener)
+
+    chunk_size = int(round(_CHUNK_DURATION * settings.sample_rate))
+    for i in range(0, len(samples), chunk_size):
+        detector.detect(samples[i:i + chunk_size])
+
+    detector.complete_detection()
+
+    return listener.clips
+
+
+class _Listener:
+
+    def __init__(self):
+        self.clips = []
+
+    def process_clip(self, start_index, length):
+        self.clips.append((start_index, length))
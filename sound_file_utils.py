@@ -23,7 +23,7 @@ def write_sound_file(file_path, samples, sample_rate):
             num_channels, sample_size, sample_rate, length,
             compression_type, compression_name))
 
-        writer.writeframes(samples.tostring())
+        writer.writeframes(samples.tobytes())
 
 
 def read_sound_file(file_path):
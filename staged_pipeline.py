@@ -0,0 +1,452 @@
+"""
+Module containing class `StagedPipeline`, which runs the kernels of a
+pipeline (see the `pipeline` module) in stages on separate threads.
+
+A staged pipeline divides the kernels of a pipeline into stages, by
+default three:
+
+1. the front end, i.e. the FIR filters of the model and the kernels
+   that feed them,
+
+2. the detection logic, and
+
+3. clip extraction, i.e. the Clip & Save blocks and output ports of
+   the model and the FIFOs that feed only them.
+
+Each stage runs on its own thread, optionally pinned to a CPU, so that
+while the clip stage processes one buffer the detection stage can
+process the next one and the front end the one after that. Each stage
+runs its kernels in schedule order on one buffer at a time, and on
+consecutive buffers in order, so each kernel sees exactly the same
+sequence of calls as in a serial pipeline and the results are the same.
+
+The stages are connected in a ring by bounded single-producer,
+single-consumer queues of *frames*. A frame holds the buffers that pass
+from one stage to a later one, including the pipeline input buffer.
+Frames are preallocated and recycled: the last stage returns each frame
+to the caller's thread, which fills the frame's input buffer with the
+next samples and passes it to the first stage. Before running its
+kernels on a frame, a stage rebinds the inputs and outputs of the
+kernels that read and write the frame's buffers to them, so no samples
+are copied between stages. Kernels that are private to a stage write
+buffers that are private to that stage, so the underlying pipeline is
+compiled without buffer sharing.
+
+The listener of a staged pipeline is called on the thread of the last
+stage.
+"""
+
+
+import os
+import threading
+
+import numpy as np
+
+from pipeline import Pipeline
+import pipeline_kernels as kernels
+
+
+FRONT_END_STAGE = 0
+DETECTION_STAGE = 1
+CLIP_STAGE = 2
+
+
+class SpscQueue:
+
+    """
+    Bounded single-producer, single-consumer queue.
+
+    The queue is a ring of item slots. Only the producer writes the
+    tail index and only the consumer writes the head index, so the
+    nonblocking `try_put` and `try_get` methods need no lock. The
+    blocking `put` and `get` methods wait on events while the queue is
+    full or empty, so an idle stage sleeps until there is work for it
+    rather than polling. Each successful `put` or `get` sets an event,
+    which costs a lock acquisition per item, or a few microseconds per
+    pipeline buffer.
+    """
+
+
+    def __init__(self, capacity):
+        self._items = [None] * (capacity + 1)
+        self._head = 0
+        self._tail = 0
+        self._not_empty = threading.Event()
+        self._not_full = threading.Event()
+
+
+    def try_put(self, item):
+        tail = self._tail
+        next_tail = (tail + 1) % len(self._items)
+        if next_tail == self._head:
+            return False
+        self._items[tail] = item
+        self._tail = next_tail
+        return True
+
+
+    def try_get(self):
+
+        """
+        Gets the next item of this queue, or returns `(False, None)` if
+        the queue is empty.
+        """
+
+        head = self._head
+        if head == self._tail:
+            return False, None
+        item = self._items[head]
+        self._items[head] = None
+        self._head = (head + 1) % len(self._items)
+        return True, item
+
+
+    def put(self, item):
+
+        # The event is cleared before the queue is checked again, so
+        # that a `get` that frees a slot after the first check sets it
+        # again and the wait does not miss the slot.
+        while not self.try_put(item):
+            self._not_full.clear()
+            if self.try_put(item):
+                break
+            self._not_full.wait()
+
+        self._not_empty.set()
+
+
+    def get(self):
+
+        while True:
+
+            got, item = self.try_get()
+
+            if not got:
+                # See comment in `put`.
+                self._not_empty.clear()
+                got, item = self.try_get()
+
+            if got:
+                self._not_full.set()
+                return item
+
+            self._not_empty.wait()
+
+
+class StagedPipeline:
+
+    """
+    Pipeline whose kernels run in stages on separate threads.
+
+    `stages` optionally maps block paths to stage indices. A block runs
+    in the stage of its map entry or in the latest stage of its inputs,
+    whichever is later, so that data always flow to the same or later
+    stages. By default blocks are assigned to the three stages described
+    in the module docstring.
+
+    `cpus` optionally specifies a CPU for each stage, to which the
+    thread of the stage is pinned where the platform supports it.
+
+    `queue_size` is the number of frames, i.e. the number of pipeline
+    input buffers that can be in flight at once.
+    """
+
+
+    def __init__(
+            self, graph, listener=None, stages=None, cpus=None,
+            queue_size=4, arena=None):
+
+        self._pipeline = Pipeline(graph, listener, arena, False)
+
+        steps = self._pipeline._steps
+        graph = self._pipeline.graph
+
+        if stages is None:
+            stages = _get_default_stages(graph, steps)
+        stages = _get_monotonic_stages(graph, steps, stages)
+        num_stages = max(stages.values()) + 1
+
+        self._stage_steps = [[] for _ in range(num_stages)]
+        for step in steps:
+            self._stage_steps[stages[step[0].block.path]].append(step)
+
+        source = self._pipeline._source
+        self._source_port = (source.block.path, 1)
+        frame_ports = _get_frame_ports(graph, stages, self._source_port)
+
+        self._frames = [
+            dict(
+                (port, self._pipeline.allocate(
+                    len(self._pipeline._buffers[port])))
+                for port in frame_ports)
+            for _ in range(queue_size)]
+
+        self._stage_bindings = [
+            _get_frame_bindings(graph, s, frame_ports)
+            for s in self._stage_steps]
+
+        # The queues form a ring: the caller puts frames in queue 0,
+        # stage i gets them from queue i and puts them in queue i + 1,
+        # and the caller gets them back from the last queue.
+        self._queues = [SpscQueue(queue_size) for _ in range(num_stages + 1)]
+        self._free_frames = list(range(queue_size))
+        self._error = None
+
+        self._threads = []
+        for i in range(num_stages):
+            cpu = cpus[i] if cpus is not None else None
+            thread = threading.Thread(
+                target=self._run_stage, args=(i, cpu), daemon=True)
+            thread.start()
+            self._threads.append(thread)
+
+        self._pending = np.zeros((0, source.num_channels))
+        self._num_samples_processed = 0
+        self._closed = False
+
+
+    @property
+    def pipeline(self):
+        return self._pipeline
+
+
+    @property
+    def num_stages(self):
+        return len(self._stage_steps)
+
+
+    @property
+    def stage_paths(self):
+
+        """Lists of the paths of the blocks of each stage."""
+
+        return [
+            [s[0].block.path for s in steps] for steps in self._stage_steps]
+
+
+    @property
+    def buffer_size(self):
+        return self._pipeline.buffer_size
+
+
+    @property
+    def num_samples_processed(self):
+        return self._num_samples_processed
+
+
+    def _run_stage(self, index, cpu):
+
+        if cpu is not None and hasattr(os, 'sched_setaffinity'):
+            # On Linux, process ID zero is the calling thread.
+            os.sched_setaffinity(0, [cpu])
+
+        input_queue = self._queues[index]
+        output_queue = self._queues[index + 1]
+        steps = self._stage_steps[index]
+        bindings = self._stage_bindings[index]
+        last = index == len(self._stage_steps) - 1
+
+        while True:
+
+            frame_index = input_queue.get()
+
+            if frame_index is None:
+                if not last:
+                    output_queue.put(None)
+                return
+
+            # After an error, frames pass through unprocessed, so that
+            # no stage waits forever.
+            if self._error is None:
+                try:
+                    frame = self._frames[frame_index]
+                    for buffers, i, port in bindings:
+                        buffers[i] = frame[port]
+                    for kernel, inputs, outputs in steps:
+                        kernel.process(inputs, outputs)
+                except Exception as e:
+                    self._error = e
+
+            output_queue.put(frame_index)
+
+
+    def process(self, samples):
+
+        """
+        Processes the specified samples.
+
+        The samples are a one-dimensional array for single-channel input,
+        or a two-dimensional array with one column per channel. This
+        method returns as soon as the samples are queued for processing:
+        call `flush` to wait for them to be processed.
+        """
+
+        self._check_state()
+
+        samples = np.asarray(samples, dtype='float64')
+        if samples.ndim == 1:
+            samples = samples[:, np.newaxis]
+
+        samples = np.concatenate((self._pending, samples))
+        n = self.buffer_size
+        num_buffers = len(samples) // n
+
+        for i in range(num_buffers):
+
+            frame_index = self._get_free_frame()
+            self._check_state()
+
+            output = self._frames[frame_index][self._source_port]
+            self._pipeline._write_source(samples[i * n:(i + 1) * n], output)
+
+            self._queues[0].put(frame_index)
+            self._num_samples_processed += n
+
+        self._pending = samples[num_buffers * n:]
+
+
+    def _get_free_frame(self):
+        if len(self._free_frames) == 0:
+            self._free_frames.append(self._queues[-1].get())
+        return self._free_frames.pop()
+
+
+    def _check_state(self):
+
+        if self._closed:
+            raise ValueError('Staged pipeline is closed.')
+
+        if self._error is not None:
+            raise self._error
+
+
+    def flush(self):
+
+        """Waits for all queued samples to be processed."""
+
+        while len(self._free_frames) != len(self._frames):
+            self._free_frames.append(self._queues[-1].get())
+
+        self._check_state()
+
+
+    def close(self):
+
+        """
+        Stops the stage threads of this pipeline, after they finish
+        processing all queued samples, and closes the underlying
+        pipeline.
+        """
+
+        if self._closed:
+            return
+
+        self._queues[0].put(None)
+        for thread in self._threads:
+            thread.join()
+
+        self._closed = True
+        self._stage_steps = []
+        self._stage_bindings = []
+        self._frames = []
+        self._pipeline.close()
+
+        if self._error is not None:
+            raise self._error
+
+
+def _get_default_stages(graph, steps):
+
+    stages = {}
+
+    # The front end comprises the FIR filters and their ancestors.
+    queue = [
+        s[0].block.path for s in steps
+        if isinstance(s[0], kernels.OverlapSave)]
+    while len(queue) != 0:
+        path = queue.pop()
+        if path not in stages:
+            stages[path] = FRONT_END_STAGE
+            queue.extend(e.src for e in graph.get_inputs(path))
+
+    for kernel, _, _ in steps:
+
+        path = kernel.block.path
+
+        if path in stages:
+            continue
+
+        elif kernel.block.type in kernels.SINK_TYPES or (
+                isinstance(kernel, kernels.FIFO) and all(
+                    graph.blocks[e.dst].type in kernels.SINK_TYPES
+                    for e in graph.get_outputs(path))):
+            stages[path] = CLIP_STAGE
+
+        else:
+            stages[path] = DETECTION_STAGE
+
+    return stages
+
+
+def _get_monotonic_stages(graph, steps, stages):
+
+    """
+    Assigns each block to the later of its specified stage and the
+    latest stage of its inputs.
+    """
+
+    result = {}
+
+    for kernel, _, _ in steps:
+        path = kernel.block.path
+        result[path] = max(
+            [stages.get(path, 0)] +
+            [result[e.src] for e in graph.get_inputs(path)])
+
+    # Renumber the stages to remove empty ones.
+    numbers = dict((s, i) for i, s in enumerate(sorted(set(result.values()))))
+
+    return dict((path, numbers[s]) for path, s in result.items())
+
+
+def _get_frame_ports(graph, stages, source_port):
+
+    """
+    Gets the block outputs that are read by a later stage than the one
+    that writes them, plus the source output.
+    """
+
+    ports = set([source_port])
+
+    for e in graph.edges:
+        if stages[e.dst] != stages[e.src]:
+            ports.add((e.src, e.src_port))
+
+    return sorted(ports)
+
+
+def _get_frame_bindings(graph, steps, frame_ports):
+
+    """
+    Gets the kernel input and output list slots of a stage that refer
+    to frame buffers, as `(list, index, port)` triples.
+    """
+
+    frame_ports = set(frame_ports)
+    bindings = []
+
+    for kernel, inputs, outputs in steps:
+
+        path = kernel.block.path
+
+        for i, e in enumerate(graph.get_inputs(path)):
+            port = (e.src, e.src_port)
+            if port in frame_ports:
+                bindings.append((inputs, i, port))
+
+        for i in range(len(outputs)):
+            port = (path, i + 1)
+            if port in frame_ports:
+                bindings.append((outputs, i, port))
+
+    return bindings
@@ -0,0 +1,344 @@
+"""
+Script that runs a redux detector on raw PCM audio as it arrives on
+standard input or a named pipe.
+
+Usage:
+
+    python stream_detector.py <detector name> <sample rate> [<input path>]
+
+where `<detector name>` is "Tseep" or "Thrush". The input must be
+single-channel, 16-bit, little-endian PCM. If no input path is
+specified the input is read from standard input. The script writes a
+line to standard output for each detected clip, comprising the start
+index and length of the clip in samples, and writes overrun and underrun
+counts to standard error when the input ends. By default samples that
+arrive when the jitter buffer is full are discarded, as they must be for
+live input. The `--no-overrun` option makes the script read more slowly
+instead, which is appropriate for input from a file.
+
+The `--bus` option makes the script read its input from the named
+audio bus (see the `audio_bus` module) instead, so that any number of
+detector processes can share the output of one recorder process. A bus
+reader needs no jitter buffer, since the bus ring plays that role, and
+the script writes the number of samples it lost by lagging behind the
+recorder, including any the recorder overwrote while the script was
+copying them, to standard error when the bus closes.
+
+This script takes the place of the WaveIn block of the original Old Bird
+detectors (see `Old Bird/Detector Source Code/MDL/tseepr.mdl`), which
+captured audio from a sound card in buffers of 8192 samples and kept up
+to twelve seconds of audio (the `bufTime` parameter of the block) queued
+for the detector. Here a separate recorder process captures the audio,
+and a reader thread moves it from the input into a jitter buffer as it
+arrives. The detector consumes whatever is in the jitter buffer, whether
+or not it amounts to a full block, as soon as either a block's worth of
+samples is available or the latency target has elapsed since it last
+consumed samples.
+"""
+
+
+import argparse
+import sys
+import threading
+import time
+
+import numpy as np
+
+from audio_bus import AudioBusReader, run_detector
+from old_bird_detector_redux_1_1 import ThrushDetector, TseepDetector
+
+
+_SAMPLE_DTYPE = np.dtype('<i2')
+
+_BLOCK_SIZE = 8192
+"""the number of samples the detector processes at once when it can."""
+
+_BUFFER_DURATION = 12
+"""the jitter buffer capacity, in seconds, after WaveIn's `bufTime`."""
+
+_LATENCY_TARGET = .1
+"""
+the maximum time in seconds an unprocessed sample waits in the jitter
+buffer before the detector processes it.
+"""
+
+_READ_SIZE = 4096
+"""the maximum number of bytes read from the input at once."""
+
+
+def main():
+
+    args = _parse_args()
+
+    cls = ThrushDetector if args.detector_name == 'Thrush' else TseepDetector
+    listener = _Listener()
+    detector = cls(args.sample_rate, listener)
+
+    if args.bus is not None:
+        reader = AudioBusReader(args.bus)
+        try:
+            lost_count = run_detector(reader, detector, _BLOCK_SIZE)
+        finally:
+            reader.close()
+        print('lost samples: {}'.format(lost_count), file=sys.stderr)
+        return
+
+    capacity = int(round(args.buffer_duration * args.sample_rate))
+    buffer = _JitterBuffer(capacity)
+
+    if args.input_path is None:
+        input_file = sys.stdin.buffer.raw
+    else:
+        input_file = open(args.input_path, 'rb', buffering=0)
+
+    with input_file:
+        reader = _Reader(input_file, buffer, args.no_overrun)
+        reader.start()
+        _run_detector(detector, buffer, args.latency_target, _BLOCK_SIZE)
+        reader.join()
+
+    print(
+        'overrun samples: {}, underruns: {}'.format(
+            buffer.overrun_count, buffer.underrun_count),
+        file=sys.stderr)
+
+
+def _parse_args():
+
+    parser = argparse.ArgumentParser(
+        description='Runs a redux detector on streaming PCM input.')
+    parser.add_argument('detector_name', choices=('Tseep', 'Thrush'))
+    parser.add_argument('sample_rate', type=float)
+    parser.add_argument('input_path', nargs='?')
+    parser.add_argument(
+        '--latency-target', type=float, default=_LATENCY_TARGET,
+        help='maximum wait for unprocessed samples, in seconds')
+    parser.add_argument(
+        '--buffer-duration', type=float, default=_BUFFER_DURATION,
+        help='jitter buffer capacity, in seconds')
+    parser.add_argument(
+        '--no-overrun', action='store_true',
+        help='wait for jitter buffer space instead of discarding samples')
+    parser.add_argument(
+        '--bus', help='name of audio bus from which to read input')
+
+    return parser.parse_args()
+
+
+def _run_detector(detector, buffer, latency_target, block_size):
+
+    """
+    Runs a detector on samples from a jitter buffer until the buffer
+    is closed and empty.
+    """
+
+    while True:
+
+        ready = buffer.wait(block_size, latency_target)
+
+        # Check whether the buffer is closed before reading from it,
+        # since the reader thread may write its last samples and close
+        # the buffer after we read. If the buffer was closed before we
+        # read and we got no samples, there are no more.
+        closed = buffer.closed
+        samples = buffer.read(block_size)
+
+        if len(samples) != 0:
+            detector.detect(samples)
+
+        elif closed:
+            break
+
+        elif not ready:
+            # latency target elapsed with no samples available
+            buffer.underrun_count += 1
+
+    detector.complete_detection()
+
+
+class _JitterBuffer:
+
+    """
+    Single-producer, single-consumer ring buffer of audio samples.
+
+    The producer thread calls `write` and `close`, and the consumer
+    thread calls `wait` and `read`. The producer only ever advances
+    the write count and the consumer only ever advances the read count,
+    so neither needs to lock the ring. The producer sets an event after
+    each write so that the consumer does not have to spin while it waits,
+    and the consumer likewise sets an event after each read.
+
+    When the producer writes more samples than there is room for, the
+    excess samples are discarded and counted as overrun samples, unless
+    the producer asks to wait for room instead. The
+    consumer counts an underrun each time it waits for the latency target
+    and no samples arrive.
+    """
+
+
+    def __init__(self, capacity):
+        self._ring = np.zeros(capacity, dtype=_SAMPLE_DTYPE)
+        self._write_count = 0
+        self._read_count = 0
+        self._closed = False
+        self._event = threading.Event()
+        self._space_event = threading.Event()
+        self.overrun_count = 0
+        self.underrun_count = 0
+
+
+    @property
+    def capacity(self):
+        return len(self._ring)
+
+
+    @property
+    def closed(self):
+        return self._closed
+
+
+    @property
+    def size(self):
+        return self._write_count - self._read_count
+
+
+    def write(self, samples, wait=False):
+
+        if wait:
+
+            # Write samples that cannot all fit at once in pieces.
+            while len(samples) > self.capacity:
+                self.write(samples[:self.capacity], wait=True)
+                samples = samples[self.capacity:]
+
+            while self.capacity - self.size < len(samples):
+                self._space_event.clear()
+                if self.capacity - self.size < len(samples):
+                    self._space_event.wait()
+
+        space = self.capacity - self.size
+
+        if len(samples) > space:
+            self.overrun_count += len(samples) - space
+            samples = samples[:space]
+
+        self._copy(samples, self._write_count)
+        self._write_count += len(samples)
+
+        self._event.set()
+
+
+    def close(self):
+        self._closed = True
+        self._event.set()
+
+
+    def wait(self, size, timeout):
+
+        """
+        Waits until at least `size` samples are available, the buffer
+        is closed, or `timeout` seconds have elapsed.
+
+        Returns `True` if and only if samples are available or the
+        buffer is closed.
+        """
+
+        deadline = time.monotonic() + timeout
+
+        while self.size < size and not self._closed:
+
+            remaining = deadline - time.monotonic()
+
+            if remaining <= 0:
+                break
+
+            self._event.clear()
+
+            # Check again after clearing the event to avoid missing
+            # a write that happened in between.
+            if self.size >= size or self._closed:
+                break
+
+            self._event.wait(remaining)
+
+        return self.size != 0 or self._closed
+
+
+    def read(self, max_size):
+
+        size = min(self.size, max_size)
+
+        start = self._read_count % self.capacity
+        end = start + size
+
+        if end <= self.capacity:
+            samples = self._ring[start:end].copy()
+        else:
+            samples = np.concatenate(
+                (self._ring[start:], self._ring[:end - self.capacity]))
+
+        self._read_count += size
+
+        self._space_event.set()
+
+        return samples
+
+
+    def _copy(self, samples, count):
+
+        start = count % self.capacity
+        n = min(len(samples), self.capacity - start)
+
+        self._ring[start:start + n] = samples[:n]
+        self._ring[:len(samples) - n] = samples[n:]
+
+
+class _Reader(threading.Thread):
+
+    """Thread that moves samples from an input file to a jitter buffer."""
+
+
+    def __init__(self, input_file, buffer, wait_for_space):
+        super().__init__(daemon=True)
+        self._file = input_file
+        self._buffer = buffer
+        self._wait_for_space = wait_for_space
+
+
+    def run(self):
+
+        sample_size = _SAMPLE_DTYPE.itemsize
+        data = bytearray(_READ_SIZE)
+        leftover = b''
+
+        try:
+
+            while True:
+
+                # Use `readinto` on the unbuffered file so that we get
+                # bytes as soon as they arrive instead of waiting to fill
+                # a buffer.
+                n = self._file.readinto(data)
+
+                if not n:
+                    break
+
+                bytes_ = leftover + bytes(data[:n])
+                n = len(bytes_) - len(bytes_) % sample_size
+                leftover = bytes_[n:]
+
+                samples = np.frombuffer(bytes_[:n], dtype=_SAMPLE_DTYPE)
+                self._buffer.write(samples, self._wait_for_space)
+
+        finally:
+            self._buffer.close()
+
+
+class _Listener:
+
+    def process_clip(self, start_index, length):
+        print('{} {}'.format(start_index, length), flush=True)
+
+
+if __name__ == '__main__':
+    main()
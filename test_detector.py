@@ -12,16 +12,20 @@ import numpy as np
 
 from bunch import Bunch
 import clip_utils
+from multi_detector import DETECTOR_SETTINGS
 import new_detector_0_0
 import new_detector_1_1
 import old_detector
+import parallel_detector
 import sound_file_utils
+import threshold_sweep
 
 
 _DETECTOR_MODULES = {
     'Old': old_detector,
     'New 0.0': new_detector_0_0,
-    'New 1.1': new_detector_1_1
+    'New 1.1': new_detector_1_1,
+    'New 1.1 Parallel': parallel_detector
 }
 
 _DETECTOR_VERSIONS = ('Old', 'New 1.1')
@@ -694,28 +698,21 @@ def _estimate_threshold_2(detector_info):
     impulse_index = _round(s.impulse_time * s.sample_rate)
     samples[impulse_index] = amplitude
     
-    low = 1.01
-    high = 5
+    # Detect clips for a grid of thresholds in one pass over the samples,
+    # and take the smallest threshold for which there are none as the
+    # estimate.
+    thresholds = np.arange(101, 501) / 100
+    settings = DETECTOR_SETTINGS[detector_info.detector_name]
+    clip_lists = threshold_sweep.detect(
+        samples, settings, thresholds, detector_info.sample_rate)
     
-    # Loop invariant: threshold is in (low, high].
-    
-    while high - low > .01:
-        
-        print('threshold is in ({}, {}]...'.format(low, high))
-        
-        mid = (low + high) / 2
-        
-        detector_info.threshold = mid
-        
-        clips = new_detector_1_1.detect(samples, detector_info)
-        
+    estimate = None
+    for threshold, clips in zip(thresholds, clip_lists):
         if len(clips) == 0:
-            high = mid
-            
-        else:
-            low = mid
+            estimate = threshold
+            break
             
-    print('threshold estimate:', high)
+    print('threshold estimate:', estimate)
 
     
 def _compare_detectors_on_impulses(detector_versions, detector_info):
@@ -0,0 +1,117 @@
+"""Unit tests for the `arena` module."""
+
+
+import io
+import unittest
+
+import numpy as np
+
+from arena import Arena
+from pipeline import compile_model
+from tests.test_mdl_graph import _TSEEPR_FILE_PATH
+
+
+class ArenaTests(unittest.TestCase):
+
+
+    def test_allocate(self):
+
+        arena = Arena()
+
+        arrays = [
+            arena.allocate((2, 3)), arena.allocate(5, 'int64'),
+            arena.allocate((2, 0)), arena.allocate(1)]
+
+        for array in arrays:
+            self.assertEqual(array.ctypes.data % arena.alignment, 0)
+            self.assertTrue(np.all(array == 0))
+            array[...] = 1
+
+        # Arrays are laid out in allocation order without overlapping.
+        addresses = [a.ctypes.data for a in arrays]
+        self.assertEqual(addresses[1] - addresses[0], 64)
+        self.assertEqual(addresses[3] - addresses[1], 64)
+        self.assertEqual(arena.size, 64 + 64 + 8)
+        self.assertEqual(arena.num_regions, 1)
+
+        del array, arrays
+        arena.close()
+        self.assertTrue(arena.closed)
+        self.assertRaises(ValueError, arena.allocate, 1)
+
+
+    def test_growth(self):
+        arena = Arena(capacity=100)
+        self.assertEqual(arena.num_regions, 1)
+        a = arena.allocate(1000)
+        self.assertEqual(arena.num_regions, 2)
+        self.assertEqual(a.shape, (1000,))
+        self.assertGreaterEqual(arena.capacity, 8000)
+
+
+    def test_close_with_arrays_in_use(self):
+
+        arena = Arena()
+        array = arena.allocate(10)
+        self.assertRaises(BufferError, arena.close)
+        del array
+        arena.close()
+
+        # A view of an array in the first region, which outlives the
+        # array, leaves all regions open, including free later ones.
+        arena = Arena()
+        arrays = [arena.allocate(10), arena.allocate(2 ** 18)]
+        self.assertEqual(arena.num_regions, 2)
+        view = arrays[0][1:]
+        del arrays
+        self.assertRaises(BufferError, arena.close)
+        self.assertFalse(arena.closed)
+        self.assertEqual(arena.num_regions, 2)
+        view[:] = 1
+        arena.allocate(10)[:] = 1
+
+        del view
+        arena.close()
+        self.assertTrue(arena.closed)
+
+
+    def test_save_and_load(self):
+
+        arenas = [Arena(), Arena()]
+        arrays = [
+            [a.allocate(10), a.allocate((3, 2 ** 17)), a.allocate(2, 'int64')]
+            for a in arenas]
+        self.assertGreater(arenas[0].num_regions, 1)
+
+        for i, x in enumerate(arrays[0]):
+            x[:] = np.arange(x.size).reshape(x.shape) + i
+
+        file = io.BytesIO()
+        arenas[0].save(file)
+        file.seek(0)
+        arenas[1].load(file)
+
+        for x, y in zip(*arrays):
+            self.assertTrue(np.array_equal(x, y))
+
+        # Views of the regions are released.
+        del arrays, x, y
+        for a in arenas:
+            a.close()
+
+
+    def test_pipeline(self):
+
+        pipeline = compile_model(_TSEEPR_FILE_PATH)
+        size = pipeline.arena.size
+
+        # An arena with the capacity of a first pipeline's arena holds
+        # all of the arrays of a second pipeline in one region.
+        arena = Arena(capacity=size)
+        other = compile_model(_TSEEPR_FILE_PATH, arena=arena)
+        self.assertEqual(arena.num_regions, 1)
+        self.assertEqual(arena.size, size)
+
+        for p in (pipeline, other):
+            p.close()
+            self.assertTrue(p.arena.closed)
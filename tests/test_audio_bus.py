@@ -0,0 +1,175 @@
+"""Unit tests for the `audio_bus` module."""
+
+
+import multiprocessing
+import os
+import time
+import unittest
+
+import numpy as np
+
+from audio_bus import (
+    BLOCK, OVERWRITE, AudioBusReader, AudioBusWriter, run_detector)
+from bunch import Bunch
+from old_bird_detector_redux_1_1 import ThrushDetector, TseepDetector
+from tests.test_parallel_detector import _SAMPLE_RATE, _create_test_signal
+import new_detector_1_1
+
+
+class AudioBusTests(unittest.TestCase):
+
+
+    def setUp(self):
+        self._name = 'test_audio_bus_{}'.format(os.getpid())
+
+
+    def test_detectors(self):
+
+        # Run Tseep and Thrush detectors in separate processes on one
+        # bus that is much smaller than the input.
+        samples = _create_test_signal(30)
+        writer = AudioBusWriter(self._name, 30000, _SAMPLE_RATE, BLOCK)
+
+        context = multiprocessing.get_context('fork')
+        results = context.Queue()
+        names = ('Tseep', 'Thrush', 'Tseep')
+        processes = [
+            context.Process(target=_detect, args=(self._name, n, results))
+            for n in names]
+        for process in processes:
+            process.start()
+
+        while writer.num_consumers != len(names):
+            time.sleep(.01)
+
+        for i in range(0, len(samples), 10000):
+            writer.write(samples[i:i + 10000])
+        writer.close()
+
+        actual = sorted(results.get(timeout=60) for _ in names)
+        for process in processes:
+            process.join()
+
+        expected = []
+        for name in names:
+            settings = Bunch(detector_name=name, sample_rate=_SAMPLE_RATE)
+            expected.append(
+                (name, 0, new_detector_1_1.detect(samples, settings)))
+        expected.sort()
+
+        self.assertNotEqual(len(expected[0][2]), 0)
+        self.assertEqual(actual, expected)
+
+
+    def test_overwrite(self):
+
+        writer = AudioBusWriter(self._name, 100, _SAMPLE_RATE, OVERWRITE)
+        reader = AudioBusReader(self._name)
+
+        writer.write(np.arange(50))
+        start, views = reader.peek()
+        self.assertEqual(start, 0)
+        self.assertTrue(np.array_equal(views[0], np.arange(50)))
+
+        # Samples overwritten while in use are reported.
+        writer.write(np.arange(50, 200))
+        self.assertEqual(writer.get_consumer_lags(), {os.getpid(): 200})
+        self.assertFalse(reader.advance(50))
+
+        # A lagging reader skips to the oldest sample in the ring.
+        start, views = reader.peek()
+        self.assertEqual(start, 100)
+        self.assertEqual(reader.lost_count, 50)
+        self.assertTrue(
+            np.array_equal(np.concatenate(views), np.arange(100, 200)))
+        self.assertEqual(len(views), 1)
+        self.assertTrue(reader.advance(100))
+
+        # Views wrap around the end of the ring.
+        writer.write(np.arange(200, 260))
+        reader.advance(60)
+        writer.write(np.arange(260, 350))
+        start, views = reader.peek()
+        self.assertEqual(start, 260)
+        self.assertEqual([len(v) for v in views], [40, 50])
+        self.assertTrue(
+            np.array_equal(np.concatenate(views), np.arange(260, 350)))
+
+        del views
+        reader.close()
+        writer.close()
+
+
+    def test_run_detector_overwrite(self):
+
+        writer = AudioBusWriter(self._name, 100, _SAMPLE_RATE, OVERWRITE)
+        reader = _LappedReader(AudioBusReader(self._name), writer)
+        detector = _Detector()
+
+        writer.write(np.arange(60))
+        lost_count = run_detector(reader, detector)
+
+        # The writer overwrote the first 60 samples while they were
+        # copied, and the reader then skipped 100 samples.
+        self.assertEqual(lost_count, 160)
+        samples = np.concatenate(detector.samples)
+        self.assertEqual(len(samples), 160)
+        self.assertTrue(np.array_equal(samples[60:], np.arange(160, 260)))
+
+        # The detector got copies of the samples rather than views of
+        # the bus ring.
+        self.assertTrue(all(s.base is None for s in detector.samples))
+
+        reader.close()
+
+
+def _detect(name, detector_name, results):
+    cls = TseepDetector if detector_name == 'Tseep' else ThrushDetector
+    listener = _Listener()
+    reader = AudioBusReader(name)
+    lost_count = run_detector(reader, cls(reader.sample_rate, listener))
+    reader.close()
+    results.put((detector_name, lost_count, listener.clips))
+
+
+class _Listener:
+
+    def __init__(self):
+        self.clips = []
+
+    def process_clip(self, start_index, length):
+        self.clips.append((start_index, length))
+
+
+class _LappedReader:
+
+    """
+    Audio bus reader whose writer laps it right after its first peek.
+    """
+
+    def __init__(self, reader, writer):
+        self._reader = reader
+        self._writer = writer
+
+    def __getattr__(self, name):
+        return getattr(self._reader, name)
+
+    def peek(self, max_size=None):
+        result = self._reader.peek(max_size)
+        if self._writer is not None:
+            self._writer.write(np.arange(60, 260))
+            self._writer.close()
+            self._writer = None
+        return result
+
+
+class _Detector:
+
+    def __init__(self):
+        self.samples = []
+
+    def detect(self, samples):
+        self.samples.append(samples)
+
+    def complete_detection(self):
+        pass
@@ -0,0 +1,109 @@
+"""Unit tests for the `baseband_detector` module."""
+
+
+import unittest
+
+import numpy as np
+
+from baseband_detector import BasebandThrushDetector, BasebandTseepDetector
+from old_bird_detector_redux_1_1 import ThrushDetector, TseepDetector
+from tests.test_parallel_detector import _create_test_signal
+import clip_utils
+
+
+_SAMPLE_RATE = 22050
+
+
+class BasebandDetectorTests(unittest.TestCase):
+
+
+    def test_detect(self):
+
+        samples = _create_test_signal(60)
+
+        detector_classes = (
+            (TseepDetector, BasebandTseepDetector),
+            (ThrushDetector, BasebandThrushDetector))
+
+        for expected_class, actual_class in detector_classes:
+
+            for chunk_size in (None, 1000, 100000):
+                expected = _detect(expected_class, samples, chunk_size)
+                actual = _detect(actual_class, samples, chunk_size)
+                self.assertNotEqual(len(expected), 0)
+                self.assertEqual(actual, expected)
+
+
+    def test_band_edges(self):
+
+        # For weak tones at the band edges the approximate ratio of a
+        # baseband detector is least accurate, and the detector may
+        # miss a few clips, but most of its clips are the same as
+        # those of the redux detector, and it detects no others.
+
+        detector_classes = (
+            (TseepDetector, BasebandTseepDetector, (6000, 10000)),
+            (ThrushDetector, BasebandThrushDetector, (2800, 5000)))
+
+        for expected_class, actual_class, frequencies in detector_classes:
+
+            samples = _create_band_edge_signal(30, frequencies)
+
+            expected = _detect(expected_class, samples, None)
+            actual = _detect(actual_class, samples, None)
+            self.assertNotEqual(len(expected), 0)
+
+            num_same = len(set(actual) & set(expected))
+            self.assertGreaterEqual(num_same, .8 * len(expected))
+
+            matches = clip_utils.match_clips(expected, actual)
+            self.assertFalse(any(e is None for e, _ in matches))
+
+
+def _create_band_edge_signal(duration, frequencies):
+
+    """
+    Creates a noise signal with weak tones at the specified band edge
+    frequencies.
+    """
+
+    random = np.random.RandomState(5)
+
+    length = int(round(duration * _SAMPLE_RATE))
+    samples = random.randn(length) * 100
+
+    for time in np.arange(.5, duration - 1, .9):
+        start_index = int(round(time * _SAMPLE_RATE))
+        tone_length = int(round(random.uniform(.05, .4) * _SAMPLE_RATE))
+        frequency = random.choice(frequencies)
+        amplitude = random.uniform(20, 300)
+        n = np.arange(tone_length)
+        tone = amplitude * np.sin(2 * np.pi * frequency * n / _SAMPLE_RATE)
+        samples[start_index:start_index + tone_length] += tone
+
+    return np.round(samples).astype('<i2')
+
+
+def _detect(detector_class, samples, chunk_size):
+
+    listener = _Listener()
+    detector = detector_class(_SAMPLE_RATE, listener)
+
+    if chunk_size is None:
+        chunk_size = len(samples)
+
+    for i in range(0, len(samples), chunk_size):
+        detector.detect(np.array(samples[i:i + chunk_size], dtype='float'))
+
+    detector.complete_detection()
+
+    return listener.clips
+
+
+class _Listener:
+
+    def __init__(self):
+        self.clips = []
+
+    def process_clip(self, start_index, length):
+        self.clips.append((start_index, length))
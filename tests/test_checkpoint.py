@@ -0,0 +1,127 @@
+"""Unit tests for the `checkpoint` module."""
+
+
+import os
+import shutil
+import tempfile
+import unittest
+
+from checkpoint import Checkpointer, restore_checkpoint, save_checkpoint
+from mdl_graph import load_graph
+from pipeline import Pipeline, compile_model
+from tests.test_mdl_graph import _TSEEPR_FILE_PATH
+from tests.test_parallel_detector import _create_test_signal
+
+
+class CheckpointTests(unittest.TestCase):
+
+
+    def setUp(self):
+        self._dir_path = tempfile.mkdtemp()
+        self._file_path = os.path.join(self._dir_path, 'Test.checkpoint')
+
+
+    def tearDown(self):
+        shutil.rmtree(self._dir_path)
+
+
+    def test_resume(self):
+
+        samples = _create_test_signal(60)
+        chunk_size = 10000
+
+        listener = _Listener()
+        pipeline = compile_model(_TSEEPR_FILE_PATH, listener)
+        for i in range(0, len(samples), chunk_size):
+            pipeline.process(samples[i:i + chunk_size])
+        expected = listener.clips
+        self.assertGreater(len(expected), 10)
+
+        # Run until partway through the input, with a checkpoint every
+        # `interval` samples, and then stop as if the run died.
+        interval = 100000
+        listener = _Listener()
+        pipeline = compile_model(_TSEEPR_FILE_PATH, listener)
+        checkpointer = Checkpointer(
+            pipeline, self._file_path, interval,
+            lambda: {'num_clips': len(listener.clips)})
+        for i in range(0, len(samples) // 2, chunk_size):
+            checkpointer.process(samples[i:i + chunk_size])
+        pipeline.close()
+
+        # Resume from the last checkpoint.
+        clips = listener.clips
+        listener = _Listener()
+        pipeline = compile_model(_TSEEPR_FILE_PATH, listener)
+        metadata = restore_checkpoint(pipeline, self._file_path)
+
+        # The last checkpoint was saved partway through the input,
+        # when the pipeline held samples that did not fill a buffer.
+        start = pipeline.num_samples_received
+        self.assertNotEqual(metadata['num_clips'], 0)
+        self.assertEqual(start % interval, 0)
+        self.assertGreater(start, 0)
+        self.assertLess(start, len(samples) // 2)
+        self.assertLess(pipeline.num_samples_processed, start)
+
+        # Resume with a new checkpointer, which continues on the same
+        # checkpoint schedule.
+        clips = clips[:metadata['num_clips']]
+        checkpointer = Checkpointer(pipeline, self._file_path, interval)
+        for i in range(start, len(samples), chunk_size):
+            checkpointer.process(samples[i:i + chunk_size])
+        clips += listener.clips
+
+        self.assertEqual(clips, expected)
+
+        # The last checkpoint of the resumed run is at the last multiple
+        # of `interval` in the input.
+        pipeline.close()
+        pipeline = compile_model(_TSEEPR_FILE_PATH)
+        restore_checkpoint(pipeline, self._file_path)
+        self.assertEqual(
+            pipeline.num_samples_received,
+            len(samples) // interval * interval)
+        pipeline.close()
+
+        self.assertEqual(os.listdir(self._dir_path), ['Test.checkpoint'])
+
+
+    def test_wrong_pipeline(self):
+
+        pipeline = compile_model(_TSEEPR_FILE_PATH)
+        pipeline.process(_create_test_signal(1))
+        save_checkpoint(pipeline, self._file_path)
+
+        # A pipeline that has processed samples cannot be restored.
+        self.assertRaises(
+            ValueError, restore_checkpoint, pipeline, self._file_path)
+
+        # Neither can a pipeline of another model.
+        directory = os.path.dirname(_TSEEPR_FILE_PATH)
+        pipeline = compile_model(os.path.join(directory, 'detector2.mdl'))
+        self.assertRaises(
+            ValueError, restore_checkpoint, pipeline, self._file_path)
+
+        # Nor can a pipeline of the same model with another threshold.
+        graph = load_graph(_TSEEPR_FILE_PATH)
+        block = graph.blocks[
+            'Detect, Clip & Save/Detector/Peak detector/Constant']
+        threshold = block.scope['threshold']
+        block.scope = dict(block.scope, threshold=2 * threshold)
+        pipeline = Pipeline(graph)
+        self.assertRaises(
+            ValueError, restore_checkpoint, pipeline, self._file_path)
+
+        # A pipeline of the same model with the same parameters can.
+        pipeline = compile_model(_TSEEPR_FILE_PATH)
+        restore_checkpoint(pipeline, self._file_path)
+
+
+class _Listener:
+
+    def __init__(self):
+        self.clips = []
+
+    def process_clip(self, start_index, length):
+        self.clips.append((start_index, length))
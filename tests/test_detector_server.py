@@ -0,0 +1,237 @@
+"""Unit tests for the `detector_server` module."""
+
+
+import collections
+import contextlib
+import glob
+import io
+import os
+import shutil
+import socket
+import tempfile
+import threading
+import time
+import unittest
+
+from bunch import Bunch
+from detector_server import DetectorServer
+from sound_file_utils import read_sound_file
+from tests.test_parallel_detector import _SAMPLE_RATE, _create_test_signal
+import detector_server
+import new_detector_1_1
+
+
+class DetectorServerTests(unittest.TestCase):
+
+
+    def setUp(self):
+        self._dir_path = tempfile.mkdtemp()
+
+
+    def tearDown(self):
+        shutil.rmtree(self._dir_path)
+
+
+    def test_streams(self):
+
+        socket_path = os.path.join(self._dir_path, 'server.sock')
+        clip_dir = os.path.join(self._dir_path, 'Clips')
+
+        server = DetectorServer(socket_path, clip_dir, num_workers=2)
+        server_thread = threading.Thread(target=server.serve_forever)
+        server_thread.start()
+
+        samples = _create_test_signal(20)
+        streams = [
+            ('Tseep', 'Station {}'.format(i), samples[i * 1000:])
+            for i in range(3)]
+        streams.append(('Thrush', 'Station 0', samples))
+        streams.append(('Tseep,Thrush', 'Station 3', samples))
+
+        # A station that reconnects gets new clip files.
+        streams.append(('Tseep', 'Station 3', samples))
+
+        replies = [None] * len(streams)
+
+        def send(i):
+            detector_names, station_name, samples = streams[i]
+            replies[i] = _send_stream(
+                socket_path, detector_names, station_name, samples)
+
+        threads = [
+            threading.Thread(target=send, args=(i,))
+            for i in range(len(streams))]
+        for thread in threads:
+            thread.start()
+        for thread in threads:
+            thread.join()
+
+        bad_headers = [
+            b'Bobolink 22050 Station\n', b'Tseep 22050 /tmp/x\n',
+            b'Tseep 22050 ../../x\n', b'Tseep 22050 x/../../y\n']
+        bad_replies = [
+            _send_header(socket_path, header) for header in bad_headers]
+
+        server.shutdown()
+        server_thread.join()
+        server.close()
+
+        for reply in bad_replies:
+            self.assertEqual(reply[:6], 'error:')
+
+        self.assertEqual(
+            sorted(os.listdir(clip_dir)),
+            sorted(set(station_name for _, station_name, _ in streams)))
+
+        self._check_clips(clip_dir, streams, replies)
+
+
+    def _check_clips(self, clip_dir, streams, replies):
+
+        clip_counts = collections.Counter()
+
+        for (detector_names, station_name, samples), reply in \
+                zip(streams, replies):
+
+            num_clips = 0
+
+            for detector_name in detector_names.split(','):
+
+                settings = Bunch(
+                    detector_name=detector_name, sample_rate=_SAMPLE_RATE)
+                expected = new_detector_1_1.detect(samples, settings)
+                self.assertNotEqual(len(expected), 0)
+                num_clips += len(expected)
+
+                for start_index, length in expected:
+                    pattern = os.path.join(
+                        clip_dir, station_name,
+                        '{}_*_{}.wav'.format(detector_name, start_index))
+                    paths = glob.glob(pattern)
+                    self.assertGreater(len(paths), 0)
+                    for path in paths:
+                        clip = read_sound_file(path)
+                        self.assertEqual(
+                            list(clip), list(samples[start_index:][:length]))
+
+                clip_counts[station_name] += len(expected)
+
+            self.assertEqual(reply, str(num_clips))
+
+        for station_name, num_clips in clip_counts.items():
+            file_names = os.listdir(os.path.join(clip_dir, station_name))
+            self.assertEqual(len(file_names), num_clips)
+
+
+    def test_backpressure(self):
+
+        socket_path = os.path.join(self._dir_path, 'server.sock')
+        clip_dir = os.path.join(self._dir_path, 'Clips')
+
+        server = DetectorServer(socket_path, clip_dir, num_workers=1)
+        server_thread = threading.Thread(target=server.serve_forever)
+        server_thread.start()
+
+        # Hold up the only worker so that the stream's blocks pile up.
+        release = threading.Event()
+        self.addCleanup(release.set)
+        server._pool.submit(release.wait)
+
+        samples = _create_test_signal(20)
+        streams = [('Tseep', 'Station', samples)]
+        replies = [None]
+
+        def send():
+            replies[0] = _send_stream(socket_path, 'Tseep', 'Station', samples)
+
+        thread = threading.Thread(target=send)
+        thread.start()
+
+        # The server stops reading the stream when it has the maximum
+        # number of pending blocks.
+        for _ in range(500):
+            if len(server._paused_streams) != 0:
+                break
+            time.sleep(.01)
+        self.assertEqual(len(server._paused_streams), 1)
+        # A read can add a few blocks past the limit.
+        stream = next(iter(server._paused_streams))
+        max_blocks = detector_server._MAX_PENDING_BLOCKS
+        read_blocks = detector_server._READ_SIZE // (
+            2 * detector_server._BLOCK_SIZE)
+        self.assertGreaterEqual(len(stream._blocks), max_blocks)
+        self.assertLessEqual(len(stream._blocks), max_blocks + read_blocks)
+
+        # The stream resumes when the worker catches up.
+        release.set()
+        thread.join()
+
+        server.shutdown()
+        server_thread.join()
+        server.close()
+
+        self._check_clips(clip_dir, streams, replies)
+
+
+    def test_write_failure(self):
+
+        socket_path = os.path.join(self._dir_path, 'server.sock')
+        clip_dir = os.path.join(self._dir_path, 'Clips')
+
+        # A file in place of a station's clip directory makes the
+        # station's clips unwritable.
+        os.makedirs(clip_dir)
+        with open(os.path.join(clip_dir, 'Bad Station'), 'w'):
+            pass
+
+        server = DetectorServer(socket_path, clip_dir, num_workers=1)
+        server_thread = threading.Thread(target=server.serve_forever)
+        server_thread.start()
+
+        samples = _create_test_signal(20)
+
+        with contextlib.redirect_stderr(io.StringIO()) as stderr:
+            bad_reply = _send_stream(
+                socket_path, 'Tseep', 'Bad Station', samples)
+            reply = _send_stream(socket_path, 'Tseep', 'Station', samples)
+
+        server.shutdown()
+        server_thread.join()
+        server.close()
+
+        # The failures are reported, and the clip writer keeps writing
+        # the clips of other stations.
+        self.assertEqual(bad_reply[:6], 'error:')
+        self.assertIn('could not write clip', stderr.getvalue())
+        self._check_clips(
+            clip_dir, [('Tseep', 'Station', samples)], [reply])
+
+
+def _send_stream(socket_path, detector_names, station_name, samples):
+
+    header = '{} {} {}\n'.format(detector_names, _SAMPLE_RATE, station_name)
+
+    with socket.socket(socket.AF_UNIX, socket.SOCK_STREAM) as s:
+        s.connect(socket_path)
+        s.sendall(header.encode('ascii'))
+        data = samples.tobytes()
+        for i in range(0, len(data), 10000):
+            s.sendall(data[i:i + 10000])
+        s.shutdown(socket.SHUT_WR)
+        return _read_reply(s)
+
+
+def _send_header(socket_path, header):
+    with socket.socket(socket.AF_UNIX, socket.SOCK_STREAM) as s:
+        s.connect(socket_path)
+        s.sendall(header)
+        return _read_reply(s)
+
+
+def _read_reply(s):
+    reply = b''
+    while True:
+        data = s.recv(1024)
+        if not data:
+            return reply.decode('ascii').strip()
+        reply += data
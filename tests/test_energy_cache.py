@@ -0,0 +1,119 @@
+"""Unit tests for the `energy_cache` module."""
+
+
+import os
+import shutil
+import tempfile
+import unittest
+
+from bunch import Bunch
+from energy_cache import CachedDetector, EnergyCache, EnergyCacheWriter
+from multi_detector import DETECTOR_SETTINGS
+from old_bird_detector_redux_1_1 import _Detector
+from tests.test_parallel_detector import _SAMPLE_RATE, _create_test_signal
+import energy_cache
+
+
+class EnergyCacheTests(unittest.TestCase):
+
+
+    def setUp(self):
+        self._dir_path = tempfile.mkdtemp()
+        self._file_path = os.path.join(self._dir_path, 'Test.cache')
+
+
+    def tearDown(self):
+        shutil.rmtree(self._dir_path)
+
+
+    def test_detect(self):
+
+        samples = _create_test_signal(60)
+        chunk_size = 22050
+
+        for name in ('Tseep', 'Thrush'):
+
+            settings = DETECTOR_SETTINGS[name]
+
+            with EnergyCacheWriter(
+                    self._file_path, settings, _SAMPLE_RATE,
+                    chunk_size=4096) as writer:
+                for i in range(0, len(samples), chunk_size):
+                    writer.write(samples[i:i + chunk_size])
+
+            # The cache is smaller than the energy signal.
+            self.assertLess(
+                os.path.getsize(self._file_path), 8 * len(samples))
+
+            with EnergyCache(self._file_path) as cache:
+
+                self.assertEqual(cache.num_samples, len(samples))
+                self.assertEqual(
+                    cache.start_index + cache.num_values, len(samples))
+
+                # Detection with the settings of the cache and with
+                # other downstream settings matches detection on the
+                # samples.
+                for threshold, delay, max_duration in (
+                        (settings.ratio_threshold, settings.ratio_delay,
+                         settings.max_duration),
+                        (3, .05, .3),
+                        (1.2, .01, .5)):
+
+                    s = Bunch(
+                        settings, ratio_threshold=threshold,
+                        ratio_delay=delay, max_duration=max_duration)
+
+                    listener = _Listener()
+                    detector = _Detector(s, _SAMPLE_RATE, listener)
+                    for i in range(0, len(samples), chunk_size):
+                        detector.detect(samples[i:i + chunk_size])
+                    detector.complete_detection()
+                    expected = listener.clips
+                    self.assertNotEqual(len(expected), 0)
+
+                    listener = _Listener()
+                    detector = CachedDetector(cache, s, listener)
+                    detector.detect()
+                    detector.complete_detection()
+                    self.assertEqual(listener.clips, expected)
+                    self.assertGreater(detector.num_chunks_skipped, 0)
+
+                    self.assertEqual(
+                        energy_cache.detect(cache, s), expected)
+
+
+    def test_settings_mismatch(self):
+
+        settings = DETECTOR_SETTINGS['Tseep']
+        with EnergyCacheWriter(
+                self._file_path, settings, _SAMPLE_RATE) as writer:
+            writer.write(_create_test_signal(2))
+
+        with EnergyCache(self._file_path) as cache:
+            s = Bunch(settings, integration_time=.05)
+            self.assertRaises(
+                ValueError, CachedDetector, cache, s, _Listener())
+
+
+    def test_incomplete_cache(self):
+
+        settings = DETECTOR_SETTINGS['Tseep']
+
+        # An incomplete cache does not appear under its final name.
+        with self.assertRaises(RuntimeError):
+            with EnergyCacheWriter(
+                    self._file_path, settings, _SAMPLE_RATE) as writer:
+                writer.write(_create_test_signal(2))
+                raise RuntimeError()
+
+        self.assertEqual(os.listdir(self._dir_path), [])
+
+
+class _Listener:
+
+    def __init__(self):
+        self.clips = []
+
+    def process_clip(self, start_index, length):
+        self.clips.append((start_index, length))
@@ -0,0 +1,111 @@
+"""Unit tests for the `grid_search` module."""
+
+
+import unittest
+
+from bunch import Bunch
+from grid_search import GridSearch, get_configurations, score_clips
+from multi_detector import DETECTOR_SETTINGS
+from old_bird_detector_redux_1_1 import _Detector
+from tests.test_parallel_detector import _SAMPLE_RATE, _create_test_signal
+import grid_search
+
+
+class GridSearchTests(unittest.TestCase):
+
+
+    def test_grid_search(self):
+
+        samples = _create_test_signal(30)
+
+        configurations = get_configurations(
+            DETECTOR_SETTINGS['Tseep'],
+            integration_time=(1000 / _SAMPLE_RATE, 2000 / _SAMPLE_RATE),
+            ratio_delay=(.01, .02),
+            ratio_threshold=(1.5, 2, 3),
+            max_duration=(.3, .4))
+        configurations.append(DETECTOR_SETTINGS['Thrush'])
+
+        expected = []
+        for settings in configurations:
+            listener = _Listener()
+            detector = _Detector(settings, _SAMPLE_RATE, listener)
+            detector.detect(samples)
+            detector.complete_detection()
+            expected.append(listener.clips)
+
+        self.assertNotEqual(len(expected[0]), 0)
+
+        for chunk_size in (1000, 22050, len(samples)):
+
+            search = GridSearch(configurations, _SAMPLE_RATE)
+            for i in range(0, len(samples), chunk_size):
+                search.process(samples[i:i + chunk_size])
+            search.complete_processing()
+
+            self.assertEqual(search.clips, expected)
+
+        self.assertEqual(search.num_configurations, 25)
+        self.assertEqual(search.stage_node_counts, {
+            'filter': 2,
+            'squarer': 2,
+            'integrator': 3,
+            'ratio': 5,
+            'threshold': 13,
+            'series': 25
+        })
+
+
+    def test_get_configurations(self):
+
+        settings = Bunch(a=1, b=2, c=3)
+        configurations = get_configurations(settings, b=(4, 5), c=(6, 7))
+
+        self.assertEqual(
+            [(s.a, s.b, s.c) for s in configurations],
+            [(1, 4, 6), (1, 4, 7), (1, 5, 6), (1, 5, 7)])
+
+
+    def test_score_clips(self):
+
+        reference_clips = [(0, 10), (20, 10), (40, 10)]
+        clips = [(5, 10), (25, 2), (28, 5), (60, 10)]
+
+        score = score_clips(clips, reference_clips)
+
+        self.assertEqual(score.num_hits, 2)
+        self.assertEqual(score.num_misses, 1)
+        self.assertEqual(score.num_false_alarms, 1)
+        self.assertEqual(score.recall, 2 / 3)
+        self.assertEqual(score.precision, 3 / 4)
+
+
+    def test_search(self):
+
+        samples = _create_test_signal(10)
+        settings = DETECTOR_SETTINGS['Tseep']
+        configurations = get_configurations(
+            settings, ratio_threshold=(2, 100))
+
+        reference_clips = grid_search.search(
+            samples, _SAMPLE_RATE, [settings], [])[0][1]
+        self.assertNotEqual(len(reference_clips), 0)
+
+        results = grid_search.search(
+            samples, _SAMPLE_RATE, configurations, reference_clips,
+            chunk_size=5000)
+
+        (_, clips, score), (_, _, high_score) = results
+        self.assertEqual(clips, reference_clips)
+        self.assertEqual(score.recall, 1)
+        self.assertEqual(score.precision, 1)
+        self.assertLess(high_score.recall, 1)
+
+
+class _Listener:
+
+    def __init__(self):
+        self.clips = []
+
+    def process_clip(self, start_index, length):
+        self.clips.append((start_index, length))
@@ -0,0 +1,143 @@
+"""Unit tests for the `layout_pass` module."""
+
+
+import os
+import unittest
+
+from layout_pass import (
+    COL_MAJOR, ROW_MAJOR, get_conversion_cost, propagate_layouts)
+from mdl_graph import load_graph
+from tests.test_mdl_graph import _TSEEPR_FILE_PATH, _write_mdl_file
+
+
+_BUFFER_SIZE = 8
+
+
+class LayoutPassTests(unittest.TestCase):
+
+
+    def test_redundant_transposes(self):
+
+        # The delay supports both layouts, so neither transpose is needed.
+        graph = _load_graph(
+            [_wave_in(), _transpose('T1'), _delay('Delay', COL_MAJOR),
+             _transpose('T2'), _edge_detect('Edge Detect', ROW_MAJOR)],
+            [('WaveIn', 1, 'T1', 1), ('T1', 1, 'Delay', 1),
+             ('Delay', 1, 'T2', 1), ('T2', 1, 'Edge Detect', 1)])
+
+        self.assertEqual(get_conversion_cost(graph), 4 * _BUFFER_SIZE)
+
+        graph = propagate_layouts(graph)
+
+        self.assertEqual(get_conversion_cost(graph), 0)
+        self.assertEqual(graph.get_blocks('stranspose'), [])
+        self.assertEqual(graph.blocks['Delay'].params['col_major'], '0')
+
+
+    def test_needed_transpose(self):
+
+        # The source and destination layouts differ, so one transpose is
+        # needed. It is shared by both branches.
+        graph = _load_graph(
+            [_wave_in(), _delay('Delay', ROW_MAJOR),
+             _edge_detect('Edge Detect', COL_MAJOR),
+             _edge_detect('Edge Detect 2', COL_MAJOR)],
+            [('WaveIn', 1, 'Delay', 1), ('Delay', 1, 'Edge Detect', 1),
+             ('Delay', 1, 'Edge Detect 2', 1)])
+
+        graph = propagate_layouts(graph)
+
+        self.assertEqual(get_conversion_cost(graph), 2 * _BUFFER_SIZE)
+        self.assertEqual(len(graph.get_blocks('stranspose')), 1)
+
+        # Transposing the input of the delay costs the same as
+        # transposing its output, since the two consumers of the output
+        # share a transpose, so the delay keeps its declared layout.
+        self.assertEqual(graph.blocks['Delay'].params['col_major'], '0')
+        transpose = graph.get_blocks('stranspose')[0]
+        self.assertEqual(graph.get_inputs(transpose.path)[0].src, 'Delay')
+        self.assertEqual(transpose.evaluate('M'), _BUFFER_SIZE)
+        self.assertEqual(transpose.evaluate('N'), 2)
+
+
+    def test_shared_transpose(self):
+
+        # The delay prefers the column-major layout, and three of its four
+        # consumers want that layout. Since its three column-major
+        # consumers can share one transpose, however, it is cheapest to
+        # make the delay row-major like its input and one consumer.
+        # Charging each edge separately would make the delay
+        # column-major, needing two transposes.
+        names = ['Edge Detect {}'.format(i) for i in range(4)]
+        layouts = [COL_MAJOR, COL_MAJOR, COL_MAJOR, ROW_MAJOR]
+        graph = _load_graph(
+            [_wave_in(), _delay('Delay', COL_MAJOR)] +
+            [_edge_detect(n, l) for n, l in zip(names, layouts)],
+            [('WaveIn', 1, 'Delay', 1)] +
+            [('Delay', 1, n, 1) for n in names])
+
+        graph = propagate_layouts(graph)
+
+        self.assertEqual(graph.blocks['Delay'].params['col_major'], '0')
+        self.assertEqual(len(graph.get_blocks('stranspose')), 1)
+        self.assertEqual(get_conversion_cost(graph), 2 * _BUFFER_SIZE)
+
+
+    def test_single_channel(self):
+
+        # Single-channel buffers need no transposes.
+        graph = _load_graph(
+            [_wave_in('off'), _transpose('T1'),
+             _edge_detect('Edge Detect', COL_MAJOR)],
+            [('WaveIn', 1, 'T1', 1), ('T1', 1, 'Edge Detect', 1)])
+
+        graph = propagate_layouts(graph)
+
+        self.assertEqual(graph.get_blocks('stranspose'), [])
+
+
+    def test_tseepr(self):
+
+        graph = load_graph(_TSEEPR_FILE_PATH)
+
+        for layout in (ROW_MAJOR, COL_MAJOR):
+            result = propagate_layouts(graph, layout)
+            self.assertEqual(get_conversion_cost(result), 0)
+            self.assertEqual(
+                result.blocks['Detect, Clip & Save/Delay'].params[
+                    'col_major'],
+                str(layout))
+
+
+def _load_graph(blocks, lines):
+    path = _write_mdl_file(blocks, lines)
+    try:
+        return load_graph(path)
+    finally:
+        os.remove(path)
+
+
+def _wave_in(stereo='on'):
+    return {
+        'BlockType': 'Reference', 'Name': 'WaveIn', 'SourceType': 'WaveIn',
+        'stereo': stereo, 'col_major': 0, 'buffersize': _BUFFER_SIZE}
+
+
+def _transpose(name):
+    return {
+        'BlockType': 'S-Function', 'Name': name,
+        'FunctionName': 'stranspose', 'Parameters': '1 1'}
+
+
+def _delay(name, col_major):
+    return {
+        'BlockType': 'Reference', 'Name': name, 'SourceType': 'Delay',
+        'buffersize': _BUFFER_SIZE, 'delay': 3, 'numChannels': 2,
+        'col_major': col_major}
+
+
+def _edge_detect(name, col_major):
+    return {
+        'BlockType': 'Reference', 'Name': name, 'SourceType': 'EdgeDetect',
+        'buffersize': _BUFFER_SIZE, 'numChannels': 2,
+        'col_major': col_major}
@@ -0,0 +1,104 @@
+"""Unit tests for the `mdl_graph` module."""
+
+
+import os
+import tempfile
+import unittest
+
+import numpy as np
+
+from mdl_graph import Edge, evaluate, load_graph
+
+
+_TSEEPR_FILE_PATH = 'Old Bird/Detector Source Code/MDL/tseepr.mdl'
+
+
+class MdlGraphTests(unittest.TestCase):
+
+
+    def test_tseepr(self):
+
+        graph = load_graph(_TSEEPR_FILE_PATH)
+
+        # Subsystems and subsystem ports are flattened away.
+        types = set(b.type for b in graph.blocks.values())
+        self.assertNotIn('SubSystem', types)
+        self.assertNotIn('Inport', types)
+
+        # Both branches of the line from the subsystem input are kept.
+        destinations = set(e.dst for e in graph.get_outputs('WaveIn'))
+        self.assertEqual(destinations, set([
+            'Detect, Clip & Save/Delay',
+            'Detect, Clip & Save/Select Channel']))
+
+        # Edges into and out of subsystems connect leaf blocks.
+        self.assertIn(
+            Edge(
+                'Detect, Clip & Save/Detector/Peak detector/'
+                'Pulse Limited\\nFlip Flop', 1,
+                'Detect, Clip & Save/Pulse Extend', 1),
+            graph.edges)
+
+        # Parameters evaluate in the scopes of enclosing masks.
+        block = graph.blocks['Detect, Clip & Save/Clip & Save/FIFO']
+        self.assertEqual(block.evaluate('output_width'), 4 * 8192)
+        block = graph.blocks['Detect, Clip & Save/Clip & Save/S-Function']
+        self.assertEqual(block.evaluate('ftype'), 1)
+        self.assertEqual(block.evaluate('fs'), 22050)
+        block = graph.blocks[
+            'Detect, Clip & Save/Detector/Peak detector/Delay']
+        self.assertEqual(block.evaluate('delay'), 441)
+
+
+    def test_all_models(self):
+        directory = os.path.dirname(_TSEEPR_FILE_PATH)
+        for name in os.listdir(directory):
+            if name.endswith('.mdl'):
+                graph = load_graph(os.path.join(directory, name))
+                for e in graph.edges:
+                    self.assertIn(e.src, graph.blocks)
+                    self.assertIn(e.dst, graph.blocks)
+
+
+    def test_evaluate(self):
+        scope = {'f0': 6000, 'f1': 10000, 'fs': 22050}
+        actual = evaluate('[0 f0-100 f0 f1 f1+100 fs/2]/(fs/2)', scope)
+        expected = np.array([0, 5900, 6000, 10000, 10100, 11025]) / 11025
+        self.assertTrue(np.allclose(actual, expected))
+        self.assertEqual(evaluate('fix(-2.5)', {}), -2)
+        self.assertEqual(evaluate('round(2.5)', {}), 3)
+        self.assertEqual(evaluate('round(-2.5)', {}), -3)
+        self.assertRaises(ValueError, evaluate, 'Local time', {})
+
+
+def _write_mdl_file(blocks, lines):
+
+    """
+    Writes a single-system .mdl file with the specified blocks and lines
+    to a temporary file and returns its path.
+
+    Each block is a dictionary of .mdl file block keys and values, and
+    each line is a `(src, src_port, dst, dst_port)` tuple.
+    """
+
+    text = 'Model {\n  Name "test"\n  System {\n    Name "test"\n'
+
+    for block in blocks:
+        text += '    Block {\n'
+        for key, value in block.items():
+            text += '      {} "{}"\n'.format(key, value)
+        text += '    }\n'
+
+    for src, src_port, dst, dst_port in lines:
+        text += (
+            '    Line {{\n      SrcBlock "{}"\n      SrcPort {}\n'
+            '      DstBlock "{}"\n      DstPort {}\n    }}\n').format(
+                src, src_port, dst, dst_port)
+
+    text += '  }\n}\n'
+
+    file_ = tempfile.NamedTemporaryFile('w', suffix='.mdl', delete=False)
+    with file_:
+        file_.write(text)
+
+    return file_.name
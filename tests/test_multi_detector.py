@@ -0,0 +1,107 @@
+"""Unit tests for the `multi_detector` module."""
+
+
+import unittest
+
+from bunch import Bunch
+from multi_detector import DETECTOR_SETTINGS, MultiDetector, create_detector
+from old_bird_detector_redux_1_1 import (
+    ThrushDetector, TseepDetector, _Detector)
+from resampling_detector import (
+    ResamplingThrushDetector, ResamplingTseepDetector)
+from tests.test_parallel_detector import _SAMPLE_RATE, _create_test_signal
+
+
+class MultiDetectorTests(unittest.TestCase):
+
+
+    def setUp(self):
+        self._samples = _create_test_signal(60)
+
+
+    def test_tseep_and_thrush(self):
+
+        expected = [
+            _detect(
+                lambda l: cls(_SAMPLE_RATE, l), _Listener(), self._samples,
+                22050)
+            for cls in (TseepDetector, ThrushDetector)]
+        self.assertNotEqual(len(expected[0]), 0)
+        self.assertNotEqual(len(expected[1]), 0)
+
+        # Clips do not depend on how the input is divided into chunks.
+        for chunk_size in (1000, 22050, len(self._samples)):
+            actual = _detect(
+                lambda l: create_detector(
+                    ['Tseep', 'Thrush'], _SAMPLE_RATE, l),
+                _MultiListener(2), self._samples, chunk_size)
+            self.assertEqual(actual, expected)
+
+
+    def test_different_filter_lengths(self):
+
+        # The filter of the second detector is longer than that of the
+        # first, so the two are computed separately.
+        settings_list = [
+            DETECTOR_SETTINGS['Thrush'],
+            Bunch(DETECTOR_SETTINGS['Tseep'], filter_duration=.007)]
+
+        expected = [
+            _detect(
+                lambda l: _Detector(s, _SAMPLE_RATE, l), _Listener(),
+                self._samples, 5000)
+            for s in settings_list]
+
+        actual = _detect(
+            lambda l: MultiDetector(settings_list, _SAMPLE_RATE, l),
+            _MultiListener(2), self._samples, 5000)
+
+        self.assertEqual(actual, expected)
+
+
+    def test_resampling(self):
+
+        sample_rate = 24000
+
+        expected = [
+            _detect(
+                lambda l: cls(sample_rate, l), _Listener(), self._samples,
+                7000)
+            for cls in (ResamplingTseepDetector, ResamplingThrushDetector)]
+
+        actual = _detect(
+            lambda l: create_detector(
+                ['Tseep', 'Thrush'], sample_rate, l, resample=True),
+            _MultiListener(2), self._samples, 7000)
+
+        self.assertEqual(actual, expected)
+
+
+class _Listener:
+
+    def __init__(self):
+        self.clips = []
+
+    def process_clip(self, start_index, length):
+        self.clips.append((start_index, length))
+
+
+class _MultiListener:
+
+    def __init__(self, num_detectors):
+        self.clips = [[] for _ in range(num_detectors)]
+
+    def process_clip(self, detector_num, start_index, length):
+        self.clips[detector_num].append((start_index, length))
+
+
+def _detect(create_detector, listener, samples, chunk_size):
+
+    """Runs a detector on the specified samples and returns its clips."""
+
+    detector = create_detector(listener)
+    for i in range(0, len(samples), chunk_size):
+        detector.detect(samples[i:i + chunk_size])
+    detector.complete_detection()
+
+    return listener.clips
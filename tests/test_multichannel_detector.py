@@ -0,0 +1,100 @@
+"""Unit tests for the `multichannel_detector` module."""
+
+
+import unittest
+
+import numpy as np
+
+from multichannel_detector import (
+    MultichannelThrushDetector, MultichannelTseepDetector)
+from old_bird_detector_redux_1_1 import ThrushDetector, TseepDetector
+from tests.test_parallel_detector import _SAMPLE_RATE, _create_test_signal
+
+
+_NUM_CHANNELS = 4
+
+
+class MultichannelDetectorTests(unittest.TestCase):
+
+
+    def setUp(self):
+
+        # Make each channel different by rotating and scaling a test
+        # signal.
+        samples = _create_test_signal(30).astype('float')
+        shift = len(samples) // _NUM_CHANNELS
+        self._samples = np.stack(
+            [np.roll(samples, i * shift) * (1 + .25 * i)
+             for i in range(_NUM_CHANNELS)],
+            axis=1)
+
+
+    def test_detect(self):
+
+        detector_classes = (
+            (TseepDetector, MultichannelTseepDetector),
+            (ThrushDetector, MultichannelThrushDetector))
+
+        for mono_class, multichannel_class in detector_classes:
+
+            # The clips of each channel are those of a mono detector
+            # run on that channel alone.
+            expected = [
+                _detect(
+                    lambda l: mono_class(_SAMPLE_RATE, l), _Listener(),
+                    self._samples[:, i], 5000)
+                for i in range(_NUM_CHANNELS)]
+            for clips in expected:
+                self.assertNotEqual(len(clips), 0)
+            self.assertNotEqual(expected[0], expected[1])
+
+            # Clips do not depend on how the input is divided into
+            # chunks.
+            for chunk_size in (1000, 22050, len(self._samples)):
+                actual = _detect(
+                    lambda l: multichannel_class(
+                        _SAMPLE_RATE, _NUM_CHANNELS, l),
+                    _MultichannelListener(_NUM_CHANNELS), self._samples,
+                    chunk_size)
+                self.assertEqual(actual, expected)
+
+
+    def test_single_channel(self):
+        samples = self._samples[:, :1]
+        expected = _detect(
+            lambda l: TseepDetector(_SAMPLE_RATE, l), _Listener(),
+            samples[:, 0], 5000)
+        actual = _detect(
+            lambda l: MultichannelTseepDetector(_SAMPLE_RATE, 1, l),
+            _MultichannelListener(1), samples, 5000)
+        self.assertEqual(actual, [expected])
+
+
+class _Listener:
+
+    def __init__(self):
+        self.clips = []
+
+    def process_clip(self, start_index, length):
+        self.clips.append((start_index, length))
+
+
+class _MultichannelListener:
+
+    def __init__(self, num_channels):
+        self.clips = [[] for _ in range(num_channels)]
+
+    def process_clip(self, channel_num, start_index, length):
+        self.clips[channel_num].append((start_index, length))
+
+
+def _detect(create_detector, listener, samples, chunk_size):
+
+    """Runs a detector on the specified samples and returns its clips."""
+
+    detector = create_detector(listener)
+    for i in range(0, len(samples), chunk_size):
+        detector.detect(samples[i:i + chunk_size])
+    detector.complete_detection()
+
+    return listener.clips
@@ -0,0 +1,67 @@
+"""Unit tests for the `old_bird_detector_redux_1_1` module."""
+
+
+import unittest
+
+import numpy as np
+
+from old_bird_detector_redux_1_1 import _ClipSuppressor, _EventRateLimiter
+
+
+class EventRateLimiterTests(unittest.TestCase):
+
+
+    def test_is_allowed(self):
+
+        random = np.random.RandomState(0)
+
+        for count in (1, 2, 3, 10, 15):
+            for period in (1, 100, 1000):
+
+                times = np.cumsum(random.randint(0, 200, 1000)).tolist()
+
+                limiter = _EventRateLimiter(count, period)
+                actual = [limiter.is_allowed(t) for t in times]
+
+                expected = _is_allowed(times, count, period)
+
+                self.assertEqual(actual, expected)
+
+
+    def test_clip_suppressor(self):
+
+        clips = [(i, 10) for i in (0, 1, 2, 3, 100, 101, 102, 300)]
+        suppressor = _ClipSuppressor(3, 50)
+
+        # Clips are processed the same way whether they arrive together
+        # or separately.
+        self.assertEqual(suppressor.process(clips[:2]), clips[:2])
+        self.assertEqual(
+            suppressor.process(clips[2:]),
+            [(100, 10), (101, 10), (300, 10)])
+
+
+    def test_nonpositive_count_error(self):
+        self.assertRaises(ValueError, _EventRateLimiter, 0, 100)
+
+
+def _is_allowed(times, count, period):
+
+    """
+    Straightforward implementation of rate limiting with a list of
+    recent event times.
+    """
+
+    recent_times = []
+    results = []
+
+    for time in times:
+
+        recent_times.append(time)
+        recent_times = recent_times[-count:]
+
+        results.append(
+            len(recent_times) < count or
+            recent_times[-1] - recent_times[0] >= period)
+
+    return results
@@ -0,0 +1,72 @@
+"""Unit tests for the `parallel_detector` module."""
+
+
+import unittest
+
+import numpy as np
+
+from bunch import Bunch
+import new_detector_1_1
+import parallel_detector
+
+
+_SAMPLE_RATE = 22050
+
+
+class ParallelDetectorTests(unittest.TestCase):
+
+
+    def setUp(self):
+        self._segment_durations = (
+            parallel_detector._SEGMENT_DURATION,
+            parallel_detector._MIN_SEGMENT_DURATION)
+        parallel_detector._MIN_SEGMENT_DURATION = .1
+
+
+    def tearDown(self):
+        parallel_detector._SEGMENT_DURATION, \
+            parallel_detector._MIN_SEGMENT_DURATION = self._segment_durations
+
+
+    def test_detect(self):
+
+        samples = _create_test_signal(60)
+
+        for detector_name in ('Tseep', 'Thrush'):
+
+            settings = Bunch(
+                detector_name=detector_name, sample_rate=_SAMPLE_RATE)
+
+            expected = new_detector_1_1.detect(samples, settings)
+            self.assertNotEqual(len(expected), 0)
+
+            for segment_duration in (.5, 3.7, 100):
+                parallel_detector._SEGMENT_DURATION = segment_duration
+                for num_workers in (1, 2):
+                    actual = parallel_detector.detect(
+                        samples, settings, num_workers)
+                    self.assertEqual(actual, expected)
+
+
+def _create_test_signal(duration):
+
+    """
+    Creates a noise signal with tones in the Tseep and Thrush bands
+    of various durations and amplitudes.
+    """
+
+    random = np.random.RandomState(0)
+
+    length = int(round(duration * _SAMPLE_RATE))
+    samples = random.randn(length) * 100
+
+    for time in np.arange(1, duration - 1, 1.3):
+        start_index = int(round(time * _SAMPLE_RATE))
+        tone_length = int(round(random.uniform(.02, .5) * _SAMPLE_RATE))
+        frequency = random.choice([3500, 8000])
+        amplitude = random.uniform(200, 3000)
+        n = np.arange(tone_length)
+        tone = amplitude * np.sin(2 * np.pi * frequency * n / _SAMPLE_RATE)
+        samples[start_index:start_index + tone_length] += tone
+
+    return np.round(samples).astype('<i2')
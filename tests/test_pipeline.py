@@ -0,0 +1,268 @@
+"""Unit tests for the `pipeline` and `pipeline_kernels` modules."""
+
+
+import os
+import unittest
+
+import numpy as np
+
+from bunch import Bunch
+from mdl_graph import Block, load_graph
+from pipeline import Pipeline, compile_model
+from tests.test_mdl_graph import _TSEEPR_FILE_PATH, _write_mdl_file
+from tests.test_parallel_detector import _SAMPLE_RATE, _create_test_signal
+import new_detector_1_1
+import pipeline_kernels as kernels
+
+
+# Offset of `tseepr.mdl` clips relative to those of the new Tseep
+# detector, which pads clips with 1000 fewer samples at their starts.
+_CLIP_START_OFFSET = 1000
+
+
+class PipelineTests(unittest.TestCase):
+
+
+    def test_tseepr(self):
+
+        samples = _create_test_signal(60)
+
+        settings = Bunch(detector_name='Tseep', sample_rate=_SAMPLE_RATE)
+        expected = [
+            (start + _CLIP_START_OFFSET, length - _CLIP_START_OFFSET)
+            for start, length in new_detector_1_1.detect(samples, settings)]
+        self.assertNotEqual(len(expected), 0)
+
+        # Clips do not depend on how the input is divided into chunks.
+        for chunk_size in (1000, 22050, len(samples)):
+
+            listener = _Listener()
+            pipeline = compile_model(_TSEEPR_FILE_PATH, listener)
+
+            for i in range(0, len(samples), chunk_size):
+                pipeline.process(samples[i:i + chunk_size])
+
+            # The pipeline has not yet processed the end of the input.
+            self.assertEqual(listener.clips, expected[:len(listener.clips)])
+            self.assertGreater(len(listener.clips), len(expected) - 2)
+
+
+    def test_buffer_sharing(self):
+
+        samples = _create_test_signal(20)
+        clips = []
+        num_buffers = []
+
+        for share_buffers in (False, True):
+            listener = _Listener()
+            pipeline = compile_model(
+                _TSEEPR_FILE_PATH, listener, share_buffers=share_buffers)
+            pipeline.process(samples)
+            clips.append(listener.clips)
+            num_buffers.append(pipeline.num_buffers)
+
+        self.assertNotEqual(len(clips[0]), 0)
+        self.assertEqual(clips[1], clips[0])
+        self.assertLess(num_buffers[1], num_buffers[0] / 2)
+
+
+    def test_in_place_delays(self):
+
+        n = 4
+        blocks = [
+            {'BlockType': 'Reference', 'Name': 'WaveIn',
+             'SourceType': 'WaveIn', 'stereo': 'off', 'buffersize': n},
+            _delay('Delay 1', 0, n),
+            {'BlockType': 'Gain', 'Name': 'Gain', 'Gain': '2'},
+            _delay('Delay 2', 2 * n, n),
+            _delay('Delay 3', 3, n),
+            {'BlockType': 'Outport', 'Name': 'Out', 'Port': '1'}]
+        lines = [
+            ('WaveIn', 1, 'Delay 1', 1), ('Delay 1', 1, 'Gain', 1),
+            ('Gain', 1, 'Delay 2', 1), ('Delay 2', 1, 'Delay 3', 1),
+            ('Delay 3', 1, 'Out', 1)]
+
+        path = _write_mdl_file(blocks, lines)
+        try:
+            graph = load_graph(path)
+        finally:
+            os.remove(path)
+
+        x = np.arange(1, 41, dtype='float64')
+        expected = np.concatenate((np.zeros(2 * n + 3), 2 * x))[:len(x)]
+
+        for share_buffers in (False, True):
+            pipeline = Pipeline(graph, share_buffers=share_buffers)
+            pipeline.process(x)
+            actual = np.concatenate(pipeline.outputs['Out'])
+            self.assertTrue(np.array_equal(actual, expected))
+
+        # The zero delay does not run, and the gain and the second delay
+        # run in place, so only the input and the output of the last
+        # delay need buffers.
+        self.assertEqual(pipeline.num_buffers, 2)
+
+
+    def test_merged_integrators(self):
+
+        n = 8
+        times = (3, 20, 7)
+        blocks = [
+            {'BlockType': 'Reference', 'Name': 'WaveIn',
+             'SourceType': 'WaveIn', 'stereo': 'off', 'buffersize': n},
+            {'BlockType': 'Math', 'Name': 'Square', 'Operator': 'square'}]
+        lines = [('WaveIn', 1, 'Square', 1)]
+
+        for i, time in enumerate(times):
+            name = 'Integrate {}'.format(i)
+            blocks += [
+                {'BlockType': 'Reference', 'Name': name,
+                 'SourceType': 'Integrate', 'buffersize': n,
+                 'integration_time': time, 'normalize': 'on',
+                 'initial_value': 0},
+                {'BlockType': 'Outport', 'Name': 'Out {}'.format(i),
+                 'Port': i + 1}]
+            lines += [
+                ('Square', 1, name, 1), (name, 1, 'Out {}'.format(i), 1)]
+
+        path = _write_mdl_file(blocks, lines)
+        try:
+            pipeline = compile_model(path)
+        finally:
+            os.remove(path)
+
+        # The integrators are merged into one kernel.
+        integrators = [
+            k for k in pipeline.kernels.values()
+            if isinstance(k, kernels.MultiIntegrate)]
+        self.assertEqual(len(integrators), 1)
+        self.assertEqual(integrators[0].integration_times, list(times))
+
+        x = np.random.RandomState(0).randn(100 * n) + 10
+        pipeline.process(x)
+
+        squares = np.concatenate((np.zeros(max(times)), x * x))
+        for i, time in enumerate(times):
+            actual = np.concatenate(pipeline.outputs['Out {}'.format(i)])
+            expected = np.convolve(squares, np.ones(time) / time, 'valid')
+            expected = expected[len(expected) - len(x):]
+            self.assertTrue(np.allclose(actual, expected, atol=0))
+
+
+    def test_all_models(self):
+
+        # Models are either compiled or rejected with a `ValueError`.
+        directory = os.path.dirname(_TSEEPR_FILE_PATH)
+        num_compiled = 0
+        for name in os.listdir(directory):
+            if name.endswith('.mdl'):
+                try:
+                    compile_model(os.path.join(directory, name))
+                except ValueError:
+                    pass
+                else:
+                    num_compiled += 1
+        self.assertGreaterEqual(num_compiled, 6)
+
+
+    def test_pulse_extend(self):
+
+        x = np.random.RandomState(0).randint(0, 100, 100).astype('float64')
+        kernel = _create_kernel(
+            kernels.PulseExtend, 'PulseExtend', {'lag': '5'}, 10)
+
+        actual = _run_kernel(kernel, [x])
+        expected = [x[max(i - 5, 0):i + 1].max() for i in range(len(x))]
+        self.assertTrue(np.array_equal(actual, expected))
+
+
+    def test_gated_shift_register(self):
+
+        random = np.random.RandomState(0)
+        x = random.randn(100)
+        gate = (random.uniform(size=100) < .2).astype('float64')
+        kernel = _create_kernel(
+            kernels.GatedShiftRegister, 'GatedShiftRegister',
+            {'reg_size': '3'}, 10)
+
+        actual = _run_kernel(kernel, [x, gate])
+
+        register = [0, 0, 0]
+        expected = []
+        for value, g in zip(x, gate):
+            if g:
+                register = register[1:] + [value]
+            expected.append(register[0])
+
+        self.assertTrue(np.array_equal(actual, expected))
+
+
+    def test_counter(self):
+
+        random = np.random.RandomState(0)
+        enable = random.choice([0., 1., .5], 320)
+        reset = (random.uniform(size=320) < .05).astype('float64')
+        preset = (random.uniform(size=320) < .05).astype('float64')
+        kernel = _create_kernel(
+            kernels.Counter, 'Counter',
+            {'has_enable': 'on', 'has_reset': 'on', 'has_preset': 'on',
+             'count_direction': 'Down', 'has_stop_count': 'on',
+             'stop_count': '2', 'initial_count': '9.7', 'preset': '6.3'},
+            16)
+
+        actual = _run_kernel(kernel, [enable, reset, preset])
+
+        count = 9.7
+        expected = []
+        for e, r, p in zip(enable, reset, preset):
+            if r:
+                count = 0.
+            elif p:
+                count = 6.3
+            elif count > 2:
+                count -= e
+            expected.append(count)
+
+        self.assertTrue(np.array_equal(actual, expected))
+
+
+class _Listener:
+
+    def __init__(self):
+        self.clips = []
+
+    def process_clip(self, start_index, length):
+        self.clips.append((start_index, length))
+
+
+class _Context:
+
+    def allocate(self, shape, dtype='float64'):
+        return np.zeros(shape, dtype)
+
+
+def _delay(name, delay, buffer_size):
+    return {
+        'BlockType': 'Reference', 'Name': name, 'SourceType': 'Delay',
+        'buffersize': buffer_size, 'delay': delay, 'numChannels': 1}
+
+
+def _create_kernel(cls, type_, params, buffer_size):
+    params = dict(params, buffersize=str(buffer_size))
+    block = Block(type_, type_, params, {})
+    return cls(block, [buffer_size], _Context())
+
+
+def _run_kernel(kernel, inputs):
+
+    """Runs a single-output kernel on the specified inputs a buffer at a time."""
+
+    n = kernel.output_widths[0]
+    output = np.zeros(n)
+    result = []
+
+    for i in range(0, len(inputs[0]), n):
+        kernel.process([x[i:i + n] for x in inputs], [output])
+        result.append(output.copy())
+
+    return np.concatenate(result)
@@ -0,0 +1,48 @@
+"""Unit tests for the `resampler` module."""
+
+
+import unittest
+
+import numpy as np
+import scipy.signal as signal
+
+from resampler import Resampler
+
+
+class ResamplerTests(unittest.TestCase):
+
+
+    def test_resample(self):
+
+        random = np.random.RandomState(0)
+
+        for input_rate in (24000, 32000, 44100, 48000):
+
+            resampler = Resampler(input_rate, 22050)
+            self.assertEqual(
+                resampler.up_factor * input_rate,
+                resampler.down_factor * 22050)
+
+            x = random.randn(input_rate)
+
+            # Resample in chunks of various sizes, including empty ones
+            # and ones of several blocks.
+            chunk_sizes = [0, 1, 2, 3, 1000, 0, 4097, 30000]
+            outputs = []
+            start = 0
+            i = 0
+            while start < len(x):
+                size = chunk_sizes[i % len(chunk_sizes)]
+                outputs.append(resampler.resample(x[start:start + size]))
+                start += size
+                i += 1
+            actual = np.concatenate(outputs)
+
+            # Compare to direct (non-polyphase) computation.
+            h = resampler._phase_filters[:, ::-1].T.reshape(-1)
+            L = resampler.up_factor
+            M = resampler.down_factor
+            expected = signal.upfirdn(h, x, L, M)[:len(actual)]
+
+            self.assertEqual(len(actual), (len(x) * L - 1) // M + 1)
+            self.assertTrue(np.allclose(actual, expected, rtol=0, atol=1e-12))
@@ -0,0 +1,122 @@
+"""Unit tests for the `resampling_detector` module."""
+
+
+import unittest
+
+import numpy as np
+
+from bunch import Bunch
+from old_bird_detector_redux_1_1 import _OLD_FS, ThrushDetector, TseepDetector
+from resampling_detector import (
+    ResamplingThrushDetector, ResamplingTseepDetector)
+import resampling_detector
+
+
+_MAX_CLIP_TIME_ERROR = .05
+"""
+the maximum difference in seconds between the start and end times of
+corresponding clips detected at different sample rates.
+"""
+
+
+class ResamplingDetectorTests(unittest.TestCase):
+
+
+    def setUp(self):
+        self._chunk_duration = resampling_detector._CHUNK_DURATION
+        resampling_detector._CHUNK_DURATION = 7.3
+
+
+    def tearDown(self):
+        resampling_detector._CHUNK_DURATION = self._chunk_duration
+
+
+    def test_detect(self):
+
+        # Clips detected in a signal at other sample rates are at about
+        # the same times as those detected by a redux detector in the
+        # same signal at 22050 hertz.
+
+        duration = 30
+
+        detector_classes = (
+            ('Tseep', TseepDetector, ResamplingTseepDetector),
+            ('Thrush', ThrushDetector, ResamplingThrushDetector))
+
+        for name, expected_class, actual_class in detector_classes:
+
+            samples = _create_test_signal(duration, _OLD_FS)
+            expected = _detect(expected_class, _OLD_FS, samples, 10000)
+            self.assertNotEqual(len(expected), 0)
+            expected = _get_clip_times(expected, _OLD_FS)
+
+            for sample_rate in (24000, 44100, 48000):
+
+                samples = _create_test_signal(duration, sample_rate)
+
+                settings = Bunch(detector_name=name, sample_rate=sample_rate)
+                clips = resampling_detector.detect(samples, settings)
+                actual = _get_clip_times(clips, sample_rate)
+
+                self.assertEqual(len(actual), len(expected))
+                error = np.abs(np.array(actual) - np.array(expected)).max()
+                self.assertLess(error, _MAX_CLIP_TIME_ERROR)
+
+                # Clips do not depend on how the input is divided into
+                # chunks.
+                self.assertEqual(
+                    _detect(actual_class, sample_rate, samples, 1000), clips)
+
+
+def _create_test_signal(duration, sample_rate):
+
+    """
+    Creates a noise signal with tones in the Tseep and Thrush bands.
+
+    The tones are the same for all sample rates.
+    """
+
+    tone_random = np.random.RandomState(0)
+    noise_random = np.random.RandomState(1)
+
+    length = int(round(duration * sample_rate))
+    samples = noise_random.randn(length) * 100
+
+    for time in np.arange(1, duration - 1, 1.3):
+        start_index = int(round(time * sample_rate))
+        tone_length = int(round(tone_random.uniform(.02, .5) * sample_rate))
+        frequency = tone_random.choice([3500, 8000])
+        amplitude = tone_random.uniform(200, 3000)
+        n = np.arange(tone_length)
+        tone = amplitude * np.sin(2 * np.pi * frequency * n / sample_rate)
+        samples[start_index:start_index + tone_length] += tone
+
+    return np.round(samples).astype('<i2')
+
+
+def _detect(detector_class, sample_rate, samples, chunk_size):
+
+    listener = _Listener()
+    detector = detector_class(sample_rate, listener)
+
+    for i in range(0, len(samples), chunk_size):
+        detector.detect(np.array(samples[i:i + chunk_size], dtype='float'))
+
+    detector.complete_detection()
+
+    return listener.clips
+
+
+def _get_clip_times(clips, sample_rate):
+    return [
+        (start_index / sample_rate, (start_index + length) / sample_rate)
+        for start_index, length in clips]
+
+
+class _Listener:
+
+    def __init__(self):
+        self.clips = []
+
+    def process_clip(self, start_index, length):
+        self.clips.append((start_index, length))
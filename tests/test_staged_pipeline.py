@@ -0,0 +1,102 @@
+"""Unit tests for the `staged_pipeline` module."""
+
+
+import threading
+import time
+import unittest
+
+from mdl_graph import load_graph
+from pipeline import Pipeline
+from staged_pipeline import SpscQueue, StagedPipeline
+from tests.test_mdl_graph import _TSEEPR_FILE_PATH
+from tests.test_parallel_detector import _create_test_signal
+from tests.test_pipeline import _Listener
+
+
+class StagedPipelineTests(unittest.TestCase):
+
+
+    @classmethod
+    def setUpClass(cls):
+
+        cls.graph = load_graph(_TSEEPR_FILE_PATH)
+        cls.samples = _create_test_signal(30)
+
+        listener = _Listener()
+        pipeline = Pipeline(cls.graph, listener)
+        pipeline.process(cls.samples)
+        cls.expected = listener.clips
+
+
+    def test_default_stages(self):
+
+        self.assertNotEqual(len(self.expected), 0)
+
+        for chunk_size in (1000, 100000):
+
+            listener = _Listener()
+            pipeline = StagedPipeline(self.graph, listener)
+            self.assertEqual(pipeline.num_stages, 3)
+
+            for i in range(0, len(self.samples), chunk_size):
+                pipeline.process(self.samples[i:i + chunk_size])
+
+            pipeline.flush()
+            self.assertEqual(listener.clips, self.expected)
+            pipeline.close()
+
+
+    def test_one_block_per_stage(self):
+
+        paths = Pipeline(self.graph).graph.blocks
+        stages = dict((path, i) for i, path in enumerate(paths))
+
+        listener = _Listener()
+        pipeline = StagedPipeline(
+            self.graph, listener, stages=stages, queue_size=2)
+        pipeline.process(self.samples)
+        pipeline.close()
+
+        self.assertEqual(listener.clips, self.expected)
+
+
+    def test_spsc_queue(self):
+
+        queue = SpscQueue(3)
+        count = 10000
+        received = []
+
+        def consume():
+            for _ in range(count):
+                received.append(queue.get())
+
+        thread = threading.Thread(target=consume)
+        thread.start()
+        for i in range(count):
+            queue.put(i)
+        thread.join()
+
+        self.assertEqual(received, list(range(count)))
+        self.assertEqual(queue.try_get(), (False, None))
+
+
+    def test_spsc_queue_idle(self):
+
+        # A consumer waiting on an empty queue sleeps rather than
+        # polling, so it uses almost no CPU time.
+        queue = SpscQueue(3)
+        result = []
+
+        def consume():
+            start_time = time.thread_time()
+            result.append(queue.get())
+            result.append(time.thread_time() - start_time)
+
+        thread = threading.Thread(target=consume)
+        thread.start()
+        time.sleep(.5)
+        queue.put(1)
+        thread.join()
+
+        self.assertEqual(result[0], 1)
+        self.assertLess(result[1], .005)
@@ -0,0 +1,177 @@
+"""Unit tests for the `stream_detector` module."""
+
+
+import threading
+import time
+import unittest
+
+import numpy as np
+
+from stream_detector import _JitterBuffer, _run_detector
+
+
+class JitterBufferTests(unittest.TestCase):
+
+
+    def test_wraparound(self):
+
+        buffer = _JitterBuffer(10)
+        x = np.arange(100, dtype='<i2')
+        actual = []
+
+        # Reads and writes of various sizes wrap around the ring.
+        i = 0
+        for size in (3, 7, 4, 9, 1, 10, 6, 8, 5, 10, 2, 10, 10, 10, 5):
+            buffer.write(x[i:i + size])
+            i += size
+            actual.append(buffer.read(buffer.size))
+            self.assertEqual(buffer.size, 0)
+
+        self.assertEqual(i, len(x))
+        self.assertTrue(np.array_equal(np.concatenate(actual), x))
+        self.assertEqual(buffer.overrun_count, 0)
+
+
+    def test_overrun(self):
+
+        buffer = _JitterBuffer(10)
+        x = np.arange(20, dtype='<i2')
+
+        buffer.write(x[:6])
+        buffer.write(x[6:15])
+        self.assertEqual(buffer.size, 10)
+        self.assertEqual(buffer.overrun_count, 5)
+
+        # Samples that do not fit are discarded.
+        self.assertTrue(np.array_equal(buffer.read(4), x[:4]))
+        buffer.write(x[15:])
+        self.assertEqual(buffer.overrun_count, 6)
+        self.assertTrue(
+            np.array_equal(
+                buffer.read(20), np.concatenate((x[4:10], x[15:19]))))
+
+
+    def test_write_wait(self):
+
+        buffer = _JitterBuffer(10)
+        x = np.arange(30, dtype='<i2')
+        actual = []
+
+        def read():
+            while len(actual) < len(x):
+                buffer.wait(1, .01)
+                actual.extend(buffer.read(3))
+                time.sleep(.001)
+
+        thread = threading.Thread(target=read)
+        thread.start()
+
+        # A producer that waits for space does not overrun.
+        buffer.write(x[:8], wait=True)
+        buffer.write(x[8:], wait=True)
+        thread.join()
+
+        self.assertEqual(buffer.overrun_count, 0)
+        self.assertEqual(actual, list(x))
+
+
+    def test_wait(self):
+
+        buffer = _JitterBuffer(10)
+
+        # A wait with no samples times out.
+        start_time = time.monotonic()
+        self.assertFalse(buffer.wait(4, .05))
+        self.assertGreaterEqual(time.monotonic() - start_time, .05)
+
+        # A wait with too few samples times out, but reports that
+        # samples are available.
+        buffer.write(np.zeros(2, dtype='<i2'))
+        self.assertTrue(buffer.wait(4, .01))
+
+        # A wait ends when enough samples are written.
+        def write():
+            time.sleep(.05)
+            buffer.write(np.zeros(2, dtype='<i2'))
+
+        thread = threading.Thread(target=write)
+        thread.start()
+        start_time = time.monotonic()
+        self.assertTrue(buffer.wait(4, 10))
+        self.assertLess(time.monotonic() - start_time, 5)
+        self.assertEqual(buffer.size, 4)
+        thread.join()
+
+        # A wait ends when the buffer is closed.
+        buffer.read(4)
+        threading.Timer(.05, buffer.close).start()
+        self.assertTrue(buffer.wait(4, 10))
+        self.assertTrue(buffer.closed)
+
+
+    def test_run_detector(self):
+
+        buffer = _JitterBuffer(100)
+        detector = _Detector()
+        x = np.arange(1000, dtype='<i2')
+
+        def write():
+            for i in range(0, 500, 50):
+                buffer.write(x[i:i + 50], wait=True)
+            # Pause for longer than the latency target, so that the
+            # detector counts underruns.
+            time.sleep(.1)
+            buffer.write(x[500:], wait=True)
+            buffer.close()
+
+        thread = threading.Thread(target=write)
+        thread.start()
+        _run_detector(detector, buffer, .01, 30)
+        thread.join()
+
+        # The detector gets all of the samples, including those written
+        # just before the buffer was closed.
+        self.assertTrue(np.array_equal(np.concatenate(detector.samples), x))
+        self.assertTrue(detector.completed)
+        self.assertLessEqual(max(len(s) for s in detector.samples), 30)
+        self.assertGreater(buffer.underrun_count, 0)
+        self.assertEqual(buffer.overrun_count, 0)
+
+
+    def test_run_detector_close_race(self):
+
+        # The reader thread writes its last samples and closes the
+        # buffer just after the detector finds the buffer empty.
+        buffer = _RacingBuffer(100, np.arange(10, dtype='<i2'))
+        detector = _Detector()
+        _run_detector(detector, buffer, .01, 30)
+        self.assertEqual(
+            list(np.concatenate(detector.samples)), list(range(10)))
+
+
+class _RacingBuffer(_JitterBuffer):
+
+    def __init__(self, capacity, last_samples):
+        super().__init__(capacity)
+        self._last_samples = last_samples
+
+    def read(self, max_size):
+        samples = super().read(max_size)
+        if self._last_samples is not None:
+            self.write(self._last_samples)
+            self.close()
+            self._last_samples = None
+        return samples
+
+
+class _Detector:
+
+    def __init__(self):
+        self.samples = []
+        self.completed = False
+
+    def detect(self, samples):
+        self.samples.append(samples)
+
+    def complete_detection(self):
+        self.completed = True
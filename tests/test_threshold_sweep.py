@@ -0,0 +1,84 @@
+"""Unit tests for the `threshold_sweep` module."""
+
+
+import unittest
+
+from bunch import Bunch
+from multi_detector import DETECTOR_SETTINGS
+from old_bird_detector_redux_1_1 import _Detector
+from tests.test_parallel_detector import _SAMPLE_RATE, _create_test_signal
+from threshold_sweep import ThresholdSweepDetector
+import threshold_sweep
+
+
+class ThresholdSweepDetectorTests(unittest.TestCase):
+
+
+    def test_detect(self):
+
+        samples = _create_test_signal(30)
+
+        # Thresholds are unsorted and include a duplicate.
+        thresholds = [2, 1.3, 5, 1.01, 2.5, 2]
+
+        for name in ('Tseep', 'Thrush'):
+
+            settings = DETECTOR_SETTINGS[name]
+
+            # Compare to separate detectors that see the same chunks,
+            # since near-threshold ratios can depend on chunking.
+            for chunk_size in (5000, len(samples)):
+
+                expected = []
+                for threshold in thresholds:
+                    listener = _Listener()
+                    detector = _Detector(
+                        Bunch(settings, ratio_threshold=threshold),
+                        _SAMPLE_RATE, listener)
+                    _detect(detector, samples, chunk_size)
+                    expected.append(listener.clips)
+
+                self.assertNotEqual(len(expected[0]), 0)
+                self.assertNotEqual(expected[3], expected[0])
+
+                listener = _SweepListener(len(thresholds))
+                detector = ThresholdSweepDetector(
+                    settings, thresholds, _SAMPLE_RATE, listener)
+                _detect(detector, samples, chunk_size)
+                self.assertEqual(listener.clips, expected)
+
+            self.assertEqual(
+                threshold_sweep.detect(
+                    samples, settings, thresholds, _SAMPLE_RATE),
+                expected)
+
+
+    def test_no_thresholds(self):
+        settings = DETECTOR_SETTINGS['Tseep']
+        self.assertRaises(
+            ValueError, ThresholdSweepDetector, settings, [], _SAMPLE_RATE,
+            _SweepListener(0))
+
+
+class _Listener:
+
+    def __init__(self):
+        self.clips = []
+
+    def process_clip(self, start_index, length):
+        self.clips.append((start_index, length))
+
+
+class _SweepListener:
+
+    def __init__(self, num_thresholds):
+        self.clips = [[] for _ in range(num_thresholds)]
+
+    def process_clip(self, threshold_num, start_index, length):
+        self.clips[threshold_num].append((start_index, length))
+
+
+def _detect(detector, samples, chunk_size):
+    for i in range(0, len(samples), chunk_size):
+        detector.detect(samples[i:i + chunk_size])
+    detector.complete_detection()
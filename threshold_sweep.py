@@ -0,0 +1,195 @@
+"""
+Module containing class `ThresholdSweepDetector`, which runs a redux
+Old Bird detector with many ratio thresholds in one pass over its input.
+
+The ratio threshold of a redux detector enters only after the energy
+ratio signal is computed: the detector finds the times at which the
+ratio rises above the threshold and falls below its inverse, and the
+series processing stages that follow (the transient finder, clip
+merger, clip suppressor, and so on) turn those crossings into clips.
+A sweep detector computes the ratio signal once, finds the crossings
+of all of its thresholds at once, and runs a separate chain of series
+processing stages for each threshold. The clips it detects for a
+threshold are the same as those a redux detector with that threshold
+would detect, so a detector can be tuned by comparing the clip lists
+of many thresholds for about the cost of one detector run.
+"""
+
+
+import numpy as np
+
+from old_bird_detector_redux_1_1 import _Detector
+
+
+class ThresholdSweepDetector(_Detector):
+
+    """
+    Redux detector that detects clips for several ratio thresholds.
+
+    The `ratio_threshold` setting of `settings` is ignored in favor of
+    the thresholds of the `thresholds` sequence. The listener's
+    `process_clip` method must accept three arguments, the threshold
+    number (i.e. the index of the threshold in `thresholds`), start
+    index, and length of a detected clip.
+    """
+
+
+    def __init__(self, settings, thresholds, sample_rate, listener):
+
+        thresholds = np.array(thresholds, dtype='float')
+        if thresholds.ndim != 1 or len(thresholds) == 0:
+            raise ValueError('Thresholds must be a nonempty sequence.')
+
+        self._thresholds = thresholds
+
+        # Thresholds and their inverses in increasing order, with the
+        # threshold numbers of both. The inverses are computed just as
+        # `_Detector._get_threshold_crossings` computes them, so that
+        # crossings agree exactly.
+        self._rise_order = np.argsort(thresholds, kind='stable')
+        self._rise_thresholds = thresholds[self._rise_order]
+        inverses = 1 / thresholds
+        self._fall_order = np.argsort(inverses, kind='stable')
+        self._fall_thresholds = inverses[self._fall_order]
+
+        super().__init__(settings, sample_rate, listener)
+
+
+    @property
+    def thresholds(self):
+        return self._thresholds
+
+
+    def _create_series_processor(self):
+        create_processor = super()._create_series_processor
+        return _SweepSeriesProcessor(
+            [create_processor() for _ in self._thresholds])
+
+
+    def _get_threshold_crossings(self, ratios, offset):
+
+        # Add one to index offset to compensate for processing latency
+        # of this method.
+        offset += 1
+
+        x0 = ratios[:-1]
+        x1 = ratios[1:]
+
+        # The ratio rises above threshold `t` between two samples if
+        # `x0 <= t < x1`, i.e. for the thresholds of a range of the
+        # sorted thresholds that we find by binary search. Similarly,
+        # it falls below inverse threshold `u` if `x1 < u <= x0`.
+        rise_thresholds, rise_indices = _get_crossings(
+            self._rise_thresholds, self._rise_order, x0, x1, 'left')
+        fall_thresholds, fall_indices = _get_crossings(
+            self._fall_thresholds, self._fall_order, x1, x0, 'right')
+
+        threshold_nums = np.concatenate((rise_thresholds, fall_thresholds))
+        indices = np.concatenate((rise_indices, fall_indices)) + offset
+        rises = np.concatenate((
+            np.ones(len(rise_indices), dtype='bool'),
+            np.zeros(len(fall_indices), dtype='bool')))
+
+        # Sort crossings by threshold and then as `_Detector` does,
+        # i.e. by index with falls before rises at the same index.
+        order = np.lexsort((rises, indices, threshold_nums))
+        threshold_nums = threshold_nums[order]
+        indices = indices[order]
+        rises = rises[order]
+
+        # Split crossings by threshold.
+        bounds = np.searchsorted(
+            threshold_nums, np.arange(len(self._thresholds) + 1))
+        return [
+            list(zip(indices[start:end], rises[start:end].tolist()))
+            for start, end in zip(bounds[:-1], bounds[1:])]
+
+
+    def _notify_listener(self, clips):
+        for threshold_num, threshold_clips in enumerate(clips):
+            for start_index, length in threshold_clips:
+                self._listener.process_clip(threshold_num, start_index, length)
+
+
+    def complete_detection(self):
+
+        """
+        Completes detection after the `detect` method has been called
+        for all input.
+        """
+
+        fall = (self._num_samples_processed, False)
+        falls = [[fall] for _ in self._thresholds]
+        clips = self._series_processor.complete_processing(falls)
+        self._notify_listener(clips)
+
+
+def _get_crossings(thresholds, order, low, high, side):
+
+    """
+    Gets the threshold numbers and sample indices of the crossings of
+    sorted thresholds between consecutive samples.
+
+    A threshold `t` is crossed between samples `i` and `i + 1` if
+    `low[i] <= t < high[i]` for `side` "left", or `low[i] < t <= high[i]`
+    for `side` "right".
+    """
+
+    starts = np.searchsorted(thresholds, low, side)
+    ends = np.searchsorted(thresholds, high, side)
+
+    indices = np.where(ends > starts)[0]
+    starts = starts[indices]
+    counts = ends[indices] - starts
+
+    # Expand each sample index to one crossing per crossed threshold.
+    indices = np.repeat(indices, counts)
+    firsts = np.cumsum(counts) - counts
+    positions = np.arange(len(indices)) - np.repeat(firsts, counts)
+    threshold_nums = order[np.repeat(starts, counts) + positions]
+
+    return threshold_nums, indices
+
+
+class _SweepSeriesProcessor:
+
+    """Series processors that process the crossings of each threshold."""
+
+
+    def __init__(self, processors):
+        self._processors = processors
+
+
+    def process(self, crossings):
+        return [p.process(c) for p, c in zip(self._processors, crossings)]
+
+
+    def complete_processing(self, crossings):
+        return [
+            p.complete_processing(c)
+            for p, c in zip(self._processors, crossings)]
+
+
+def detect(samples, settings, thresholds, sample_rate):
+
+    """
+    Runs a threshold sweep detector on the specified samples.
+
+    Returns a list of clip lists, one for each threshold.
+    """
+
+    listener = _Listener(len(thresholds))
+    detector = ThresholdSweepDetector(
+        settings, thresholds, sample_rate, listener)
+    detector.detect(samples)
+    detector.complete_detection()
+    return listener.clips
+
+
+class _Listener:
+
+    def __init__(self, num_thresholds):
+        self.clips = [[] for _ in range(num_thresholds)]
+
+    def process_clip(self, threshold_num, start_index, length):
+        self.clips[threshold_num].append((start_index, length))